@@ -11,9 +11,21 @@
 #define ABCG_HPP_
 
 #include "abcg_application.hpp"
+#include "abcg_batchrenderer2d.hpp"
+#include "abcg_benchmark.hpp"
+#include "abcg_cpuprofiler.hpp"
+#include "abcg_drawlist.hpp"
 #include "abcg_elapsedtimer.hpp"
+#include "abcg_framestatistics.hpp"
+#include "abcg_geometrybuffer.hpp"
+#include "abcg_gpuprofiler.hpp"
 #include "abcg_image.hpp"
+#include "abcg_openglfunctions.hpp"
+#include "abcg_renderqueue.hpp"
+#include "abcg_samplercache.hpp"
+#include "abcg_streamingbuffer.hpp"
 #include "abcg_string.hpp"
 #include "abcg_trackball.hpp"
+#include "abcg_uniformbuffer.hpp"
 
 #endif
\ No newline at end of file
@@ -10,13 +10,59 @@
 
 #include <fmt/core.h>
 
+#include <algorithm>
+#include <charconv>
+#include <cmath>
 #include <gsl/gsl>
+#include <limits>
+#include <string_view>
 
 #include "SDL_image.h"
+#include "abcg_cpuprofiler.hpp"
 #include "abcg_exception.hpp"
 #include "abcg_openglwindow.hpp"
 #include "tiny_obj_loader.h"
 
+namespace {
+// Returns the ID of the window that received an event, or 0 if the event is
+// not related to a window
+Uint32 getEventWindowID(const SDL_Event &event) {
+  switch (event.type) {
+    case SDL_WINDOWEVENT:
+      return event.window.windowID;
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+      return event.key.windowID;
+    case SDL_TEXTEDITING:
+      return event.edit.windowID;
+    case SDL_TEXTINPUT:
+      return event.text.windowID;
+    case SDL_MOUSEMOTION:
+      return event.motion.windowID;
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:
+      return event.button.windowID;
+    case SDL_MOUSEWHEEL:
+      return event.wheel.windowID;
+    default:
+      return 0;
+  }
+}
+
+#if !defined(__EMSCRIPTEN__)
+int parseFrameCount(std::string_view option, std::string_view value) {
+  int count{};
+  const auto *const end{value.data() + value.size()};
+  if (const auto [pointer, error]{std::from_chars(value.data(), end, count)};
+      error != std::errc{} || pointer != end || count < 0) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Invalid value for {}: {}", option, value))};
+  }
+  return count;
+}
+#endif
+}  // namespace
+
 #if defined(__EMSCRIPTEN__)
 void abcg::mainLoopCallback(void *userData) {
   abcg::Application &app = *(static_cast<abcg::Application *>(userData));
@@ -31,15 +77,74 @@ void abcg::mainLoopCallback(void *userData) {
  * Constructs an abcg::Application object and initializes the SDL library and
  * SDL subsystems.
  *
+ * If the command line contains `--headless`, windows are created with SDL's
+ * offscreen video driver, which needs no display (on Linux, the context is
+ * created with EGL, e.g. Mesa's surfaceless platform). Windows are then
+ * hidden and painted to offscreen framebuffers of the size given in their
+ * settings, and no audio or input devices are opened.
+ *
+ * If the command line contains `--benchmark`, the application runs in
+ * benchmark mode: vsync, the frame rate limit and on-demand rendering are
+ * disabled, and after the warmup and measured frames, a JSON report of frame
+ * times, OpenGL counters and memory usage is written (see
+ * abcg::writeBenchmarkReport) and the application quits. Options:
+ *
+ * - `--warmup <frames>`: frames painted before measuring (default 60);
+ * - `--frames <frames>`: frames measured (default 600);
+ * - `--report <path>`: report file (default benchmark.json);
+ * - `--script <path>`: input timeline (see abcg::BenchmarkScript).
+ *
+ * Command-line options are ignored in WebAssembly builds.
+ *
  * @throw abcg::Exception if SDL failed to initialize the subsystems.
  */
-abcg::Application::Application([[maybe_unused]] int argc, char **argv) {
+abcg::Application::Application(int argc, char **argv) {
+  const gsl::span arguments{argv, static_cast<std::size_t>(argc)};
+#if !defined(__EMSCRIPTEN__)
+  BenchmarkSettings benchmark;
+  auto isBenchmark{false};
+  for (std::size_t index{1}; index < arguments.size(); ++index) {
+    const std::string_view argument{arguments[index]};
+    const auto getValue{[&]() -> std::string_view {
+      if (index + 1 >= arguments.size()) {
+        throw abcg::Exception{abcg::Exception::Runtime(
+            fmt::format("Missing value for {}", argument))};
+      }
+      return arguments[++index];
+    }};
+    if (argument == "--headless") {
+      m_headless = true;
+    } else if (argument == "--benchmark") {
+      isBenchmark = true;
+    } else if (argument == "--warmup") {
+      benchmark.warmupFrames = parseFrameCount(argument, getValue());
+    } else if (argument == "--frames") {
+      benchmark.measuredFrames =
+          std::max(parseFrameCount(argument, getValue()), 1);
+    } else if (argument == "--report") {
+      benchmark.reportPath = getValue();
+    } else if (argument == "--script") {
+      benchmark.scriptPath = getValue();
+    }
+  }
+  if (isBenchmark) {
+    benchmark.headless = m_headless;
+    m_benchmark = benchmark;
+  }
+#endif
+
   Uint32 subsystemMask{SDL_INIT_TIMER | SDL_INIT_VIDEO | SDL_INIT_AUDIO |
                        SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER |
                        SDL_INIT_EVENTS};
+  if (m_headless) {
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+    subsystemMask = SDL_INIT_TIMER | SDL_INIT_VIDEO | SDL_INIT_EVENTS;
+  }
 
   if (SDL_Init(subsystemMask) != 0) {
-    throw abcg::Exception{abcg::Exception::SDL("SDL_Init failed")};
+    throw abcg::Exception{abcg::Exception::SDL(
+        m_headless ? "SDL_Init failed (offscreen video driver)"
+                   : "SDL_Init failed")};
   }
 
 #if !defined(__EMSCRIPTEN__)
@@ -52,7 +157,7 @@ abcg::Application::Application([[maybe_unused]] int argc, char **argv) {
 #endif
 
   // Get executable relative path
-  std::string argv_str(*gsl::span{&argv, 1}[0]);
+  std::string argv_str(arguments[0]);
 #if defined(WIN32)
   if (auto n{argv_str.find_last_of('\\')}; n == std::string::npos) {
     // Called from the same directory of the executable
@@ -63,6 +168,8 @@ abcg::Application::Application([[maybe_unused]] int argc, char **argv) {
 #else
   m_basePath = argv_str.substr(0, argv_str.find_last_of('/'));
 #endif
+
+  m_frameLimiter.setTargetRate(480.0);
 }
 
 /**
@@ -72,6 +179,14 @@ abcg::Application::Application([[maybe_unused]] int argc, char **argv) {
  * subsystems.
  */
 abcg::Application::~Application() {
+  // Windows must release their contexts before the shared context
+  m_windows.clear();
+  if (m_sharedContext != nullptr) {
+    SDL_GL_DeleteContext(m_sharedContext->context);
+    if (m_sharedContext->window != nullptr) {
+      SDL_DestroyWindow(m_sharedContext->window);
+    }
+  }
 #if !defined(__EMSCRIPTEN__)
   IMG_Quit();
 #endif
@@ -81,6 +196,13 @@ abcg::Application::~Application() {
 /**
  * @brief Runs the application for a set of windows.
  *
+ * The OpenGL contexts of the windows share objects (see
+ * abcg::SharedContext), and each event is sent only to the window it refers
+ * to, or to the window with keyboard focus if it refers to none. Windows
+ * that use a render thread (see abcg::OpenGLSettings::renderThread) are
+ * painted in parallel: a window whose render thread is still busy is skipped
+ * in that iteration of the main loop instead of stalling the others.
+ *
  * @param window Vector of pointers to windows.
  *
  * @throw abcg::Exception if the vector contains a null pointer.
@@ -96,25 +218,173 @@ void abcg::Application::run(
   run();
 }
 
+/**
+ * @brief Returns whether the application was started with `--headless`.
+ *
+ * @return True if windows are painted to offscreen framebuffers.
+ */
+bool abcg::Application::isHeadless() const noexcept { return m_headless; }
+
+/**
+ * @brief Sets the maximum rate of the main loop.
+ *
+ * The loop waits before handling events, so that input is sampled right
+ * before rendering. The default rate is 480 Hz. Ignored in WebAssembly
+ * builds, where the browser paces the loop.
+ *
+ * @param framesPerSecond Number of frames per second, or 0 for no limit
+ * (e.g. when pacing is left to vsync).
+ */
+void abcg::Application::setTargetFrameRate(double framesPerSecond) {
+  m_frameLimiter.setTargetRate(framesPerSecond);
+}
+
+/**
+ * @brief Returns the maximum rate of the main loop.
+ *
+ * @return Number of frames per second, or 0 if there is no limit.
+ */
+double abcg::Application::getTargetFrameRate() const noexcept {
+  return m_frameLimiter.getTargetRate();
+}
+
+// Starts measuring the frames of the benchmark
+void abcg::Application::startBenchmarkMeasurement() {
+  for (const auto &window : m_windows) {
+    window->startMeasurement(
+        static_cast<std::size_t>(m_benchmark->measuredFrames));
+  }
+  m_benchmarkTimer.restart();
+}
+
+// Advances the benchmark to the number of frames painted by the slowest
+// window, which does not change in iterations where a window was skipped;
+// after the last measured frame, writes the report and ends the main loop
+void abcg::Application::updateBenchmark(bool &done) {
+  const auto warmupFrames{
+      static_cast<std::uint64_t>(m_benchmark->warmupFrames)};
+  const auto lastFrame{warmupFrames +
+                       static_cast<std::uint64_t>(m_benchmark->measuredFrames)};
+  const auto frame{std::ranges::min(m_benchmarkWindowFrames)};
+  if (frame == m_benchmarkFrame) return;
+  m_benchmarkFrame = frame;
+  if (m_benchmarkFrame == warmupFrames) startBenchmarkMeasurement();
+  if (m_benchmarkFrame < lastFrame) return;
+
+  for (const auto &window : m_windows) window->waitForRenderThread();
+  const auto elapsedTime{m_benchmarkTimer.elapsed()};
+  std::vector<BenchmarkResult> results;
+  for (const auto &window : m_windows) {
+    results.push_back(window->getBenchmarkResult(elapsedTime));
+  }
+  writeBenchmarkReport(m_benchmark->reportPath, *m_benchmark, results);
+
+  for (const auto &result : results) {
+    fmt::print("{}: {:.3f} ms p50, {:.3f} ms p99, {:.1f} FPS\n", result.title,
+               result.presentInterval.p50, result.presentInterval.p99,
+               static_cast<double>(result.presentInterval.count) /
+                   std::max(elapsedTime, 1e-9));
+  }
+  fmt::print("Benchmark report written to {}\n", m_benchmark->reportPath);
+  done = true;
+}
+
 void abcg::Application::mainLoopIterator([[maybe_unused]] bool &done) {
-  SDL_Event event{};
-  while (SDL_PollEvent(&event) != 0) {
 #if !defined(__EMSCRIPTEN__)
-    if (event.type == SDL_QUIT) done = true;
+  m_frameLimiter.wait();
+#endif
+  abcg::profiler::markFrame();
+  {
+    ABCG_PROFILE_SCOPE("Events");
+    const auto dispatch{[&](SDL_Event &event) {
+#if !defined(__EMSCRIPTEN__)
+      if (event.type == SDL_QUIT) done = true;
 #endif
+      // Events of no window, such as quit requests and joystick events, are
+      // handled once, by the window with keyboard focus, or by the first
+      // window if the focus is on none of the windows of the application
+      const auto windowID{getEventWindowID(event)};
+      const auto findWindow{[this](Uint32 id) {
+        return std::ranges::find_if(m_windows, [id](const auto &window) {
+          return window->m_windowID == id;
+        });
+      }};
+      auto target{findWindow(windowID)};
+      if (windowID == 0) {
+        auto *focus{SDL_GetKeyboardFocus()};
+        if (focus != nullptr) target = findWindow(SDL_GetWindowID(focus));
+        if (target == m_windows.end()) target = m_windows.begin();
+      }
+      if (target != m_windows.end()) (*target)->handleEvent(event, done);
+    }};
+
+#if !defined(__EMSCRIPTEN__)
+    if (m_benchmark) {
+      m_benchmarkScript.pushEvents(m_benchmarkFrame,
+                                   m_windows.front()->m_windowID);
+    }
+#endif
+
+    SDL_Event event{};
+#if !defined(__EMSCRIPTEN__)
+    // Block while no window has to be painted (see
+    // abcg::WindowSettings::renderOnDemand)
+    auto timeToRepaint{std::numeric_limits<double>::infinity()};
     for (const auto &window : m_windows) {
-      window->handleEvent(event, done);
+      timeToRepaint = std::min(timeToRepaint, window->getTimeToRepaint());
+    }
+    if (timeToRepaint > 0.0) {
+      const auto received{
+          std::isinf(timeToRepaint)
+              ? SDL_WaitEvent(&event)
+              : SDL_WaitEventTimeout(
+                    &event, static_cast<int>(std::ceil(timeToRepaint * 1000)))};
+      if (received != 0) dispatch(event);
+      m_frameLimiter.reset();
+    }
+#endif
+    while (SDL_PollEvent(&event) != 0) {
+      dispatch(event);
     }
   }
-  for (const auto &window : m_windows) {
+  const auto multiWindow{m_windows.size() > 1};
+  for (std::size_t index{}; index < m_windows.size(); ++index) {
+    const auto &window{m_windows.at(index)};
+    if (window->getTimeToRepaint() != 0.0) continue;
+    if (multiWindow && window->isRenderThreadBusy()) continue;
     window->paint();
+    if (m_benchmark) ++m_benchmarkWindowFrames.at(index);
   }
+  if (m_benchmark) updateBenchmark(done);
 }
 
 void abcg::Application::run() {
+  abcg::profiler::setThreadName("Main");
+  if (m_benchmark) {
+    if (!m_benchmark->scriptPath.empty()) {
+      m_benchmarkScript.loadFromFile(m_benchmark->scriptPath);
+    }
+    m_frameLimiter.setTargetRate(0.0);
+    for (const auto &w : m_windows) {
+      w->m_openGLSettings.vsync = false;
+      w->m_windowSettings.renderOnDemand = false;
+      w->m_benchmarking = true;
+    }
+    m_benchmarkWindowFrames.assign(m_windows.size(), 0);
+  }
+#if !defined(__EMSCRIPTEN__)
+  if (m_windows.size() > 1) {
+    m_sharedContext = std::make_unique<SharedContext>();
+  }
+#endif
   for (const auto &w : m_windows) {
+    w->m_headless = m_headless;
+    w->m_sharedContext = m_sharedContext.get();
     w->initialize(m_basePath);
   }
+  if (m_benchmark && m_benchmark->warmupFrames == 0) {
+    startBenchmarkMeasurement();
+  }
 
 #if defined(__EMSCRIPTEN__)
   emscripten_set_main_loop_arg(mainLoopCallback, this, 0, true);
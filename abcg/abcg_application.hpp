@@ -10,11 +10,16 @@
 #ifndef ABCG_APPLICATION_HPP_
 #define ABCG_APPLICATION_HPP_
 
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include "abcg_benchmark.hpp"
+#include "abcg_elapsedtimer.hpp"
 #include "abcg_exception.hpp"
+#include "abcg_framelimiter.hpp"
 #include "abcg_openglwindow.hpp"
 
 namespace abcg {
@@ -46,12 +51,31 @@ class abcg::Application {
   void run(std::unique_ptr<T>& window);
   void run(std::vector<std::unique_ptr<OpenGLWindow>>& windows);
 
+  void setTargetFrameRate(double framesPerSecond);
+  [[nodiscard]] double getTargetFrameRate() const noexcept;
+  [[nodiscard]] bool isHeadless() const noexcept;
+
  private:
   void mainLoopIterator(bool& done);
   void run();
+  void startBenchmarkMeasurement();
+  void updateBenchmark(bool& done);
 
   std::string m_basePath;
   std::vector<std::unique_ptr<OpenGLWindow>> m_windows;
+  FrameLimiter m_frameLimiter;
+  bool m_headless{};
+  // Set if there is more than one window
+  std::unique_ptr<SharedContext> m_sharedContext;
+
+  // Set if started with --benchmark
+  std::optional<BenchmarkSettings> m_benchmark;
+  BenchmarkScript m_benchmarkScript;
+  // Frames painted by each window since the benchmark started, and the
+  // least of them
+  std::vector<std::uint64_t> m_benchmarkWindowFrames;
+  std::uint64_t m_benchmarkFrame{};
+  ElapsedTimer m_benchmarkTimer;
 
 #if defined(__EMSCRIPTEN__)
   friend void mainLoopCallback(void* userData);
@@ -0,0 +1,153 @@
+/**
+ * @file abcg_batchrenderer2d.cpp
+ * @brief Definition of abcg::BatchRenderer2D class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_batchrenderer2d.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "abcg_openglfunctions.hpp"
+
+/**
+ * @brief Creates the vertex array and vertex buffer objects.
+ *
+ * @param program Program used to render the batch. Its attribute locations
+ * are queried once here.
+ * @param maxPrimitives Expected number of triangles, used to preallocate the
+ * buffer. The buffer grows if more triangles are added.
+ */
+void abcg::BatchRenderer2D::create(GLuint program, std::size_t maxPrimitives) {
+  destroy();
+
+  m_capacity = maxPrimitives * 3;
+  m_vertices.reserve(m_capacity);
+
+  glGenBuffers(1, &m_VBO);
+  glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+  glBufferData(GL_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(m_capacity * sizeof(Vertex)), nullptr,
+               GL_DYNAMIC_DRAW);
+
+  glGenVertexArrays(1, &m_VAO);
+  glBindVertexArray(m_VAO);
+
+  const auto stride{static_cast<GLsizei>(sizeof(Vertex))};
+  const auto positionAttribute{glGetAttribLocation(program, "inPosition")};
+  if (positionAttribute >= 0) {
+    glEnableVertexAttribArray(positionAttribute);
+    glVertexAttribPointer(positionAttribute, 2, GL_FLOAT, GL_FALSE, stride,
+                          nullptr);
+  }
+
+  const auto colorAttribute{glGetAttribLocation(program, "inColor")};
+  if (colorAttribute >= 0) {
+    glEnableVertexAttribArray(colorAttribute);
+    const auto offset{static_cast<std::uintptr_t>(offsetof(Vertex, color))};
+    glVertexAttribPointer(colorAttribute, 4, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<void *>(offset));
+  }
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief Releases the OpenGL objects and the vertices of the batch.
+ */
+void abcg::BatchRenderer2D::destroy() {
+  if (m_VAO != 0) {
+    glDeleteVertexArrays(1, &m_VAO);
+    m_VAO = 0;
+  }
+  if (m_VBO != 0) {
+    glDeleteBuffers(1, &m_VBO);
+    m_VBO = 0;
+  }
+  m_vertices.clear();
+  m_dirty = false;
+  m_capacity = 0;
+}
+
+/**
+ * @brief Removes all primitives from the batch.
+ */
+void abcg::BatchRenderer2D::clear() {
+  m_vertices.clear();
+  m_dirty = true;
+}
+
+/**
+ * @brief Adds a triangle with one color per vertex.
+ *
+ * @param positions Vertex positions in normalized device coordinates.
+ * @param colors RGBA color of each vertex.
+ */
+void abcg::BatchRenderer2D::addTriangle(
+    const std::array<glm::vec2, 3> &positions,
+    const std::array<glm::vec4, 3> &colors) {
+  for (std::size_t i{}; i < positions.size(); ++i) {
+    m_vertices.push_back({positions.at(i), colors.at(i)});
+  }
+  m_dirty = true;
+}
+
+/**
+ * @brief Adds a triangle with a single color.
+ *
+ * @param positions Vertex positions in normalized device coordinates.
+ * @param color RGBA color of the triangle.
+ */
+void abcg::BatchRenderer2D::addTriangle(
+    const std::array<glm::vec2, 3> &positions, const glm::vec4 &color) {
+  addTriangle(positions, {color, color, color});
+}
+
+/**
+ * @brief Adds an axis-aligned rectangle, as two triangles.
+ *
+ * @param min Lower-left corner in normalized device coordinates.
+ * @param max Upper-right corner in normalized device coordinates.
+ * @param color RGBA color of the rectangle.
+ */
+void abcg::BatchRenderer2D::addQuad(const glm::vec2 &min, const glm::vec2 &max,
+                                    const glm::vec4 &color) {
+  addTriangle({min, glm::vec2{max.x, min.y}, max}, color);
+  addTriangle({min, max, glm::vec2{min.x, max.y}}, color);
+}
+
+/**
+ * @brief Draws the batch.
+ *
+ * Uploads the vertices first if the batch changed since the last call. The
+ * program given to create must be in use.
+ */
+void abcg::BatchRenderer2D::render() {
+  if (m_dirty) {
+    const auto size{
+        static_cast<GLsizeiptr>(m_vertices.size() * sizeof(Vertex))};
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    if (m_vertices.size() > m_capacity) {
+      // Grow geometrically so that a growing batch is not reallocated on
+      // every change
+      m_capacity = std::max(m_vertices.size(), m_capacity * 2);
+      glBufferData(GL_ARRAY_BUFFER,
+                   static_cast<GLsizeiptr>(m_capacity * sizeof(Vertex)),
+                   nullptr, GL_DYNAMIC_DRAW);
+    }
+    if (size > 0) {
+      glBufferSubData(GL_ARRAY_BUFFER, 0, size, m_vertices.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_dirty = false;
+  }
+
+  if (m_vertices.empty()) return;
+
+  glBindVertexArray(m_VAO);
+  glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(m_vertices.size()));
+  glBindVertexArray(0);
+}
@@ -0,0 +1,76 @@
+/**
+ * @file abcg_batchrenderer2d.hpp
+ * @brief abcg::BatchRenderer2D header file.
+ *
+ * Declaration of abcg::BatchRenderer2D class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_BATCHRENDERER2D_HPP_
+#define ABCG_BATCHRENDERER2D_HPP_
+
+#include <array>
+#include <cstddef>
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <vector>
+
+#include "abcg_external.hpp"
+
+namespace abcg {
+class BatchRenderer2D;
+}  // namespace abcg
+
+/**
+ * @brief abcg::BatchRenderer2D class.
+ *
+ * Renderer of flat-colored 2D triangles and quads that draws all primitives
+ * of a batch with a single draw call.
+ *
+ * The primitives are kept in a CPU-side vertex array and uploaded to one
+ * vertex buffer only when the batch changes, so a batch that is not modified
+ * costs one glDrawArrays per frame, regardless of its size. A batch is
+ * rebuilt by calling clear and then adding every primitive again.
+ *
+ * The program given to create must declare a `vec2` attribute named
+ * `inPosition` and a `vec4` attribute named `inColor`.
+ */
+class abcg::BatchRenderer2D {
+ public:
+  /**
+   * @brief Vertex of the batch, with interleaved attributes.
+   */
+  struct Vertex {
+    glm::vec2 position{};
+    glm::vec4 color{};
+  };
+
+  void create(GLuint program, std::size_t maxPrimitives = 0);
+  void destroy();
+
+  void clear();
+  void addTriangle(const std::array<glm::vec2, 3>& positions,
+                   const std::array<glm::vec4, 3>& colors);
+  void addTriangle(const std::array<glm::vec2, 3>& positions,
+                   const glm::vec4& color);
+  void addQuad(const glm::vec2& min, const glm::vec2& max,
+               const glm::vec4& color);
+
+  void render();
+
+  // Number of vertices in the batch
+  [[nodiscard]] std::size_t size() const noexcept { return m_vertices.size(); }
+
+ private:
+  GLuint m_VAO{};
+  GLuint m_VBO{};
+
+  std::vector<Vertex> m_vertices;
+  // Whether the vertices changed since the last upload
+  bool m_dirty{};
+  // Number of vertices the buffer storage can hold
+  std::size_t m_capacity{};
+};
+
+#endif
@@ -0,0 +1,227 @@
+/**
+ * @file abcg_benchmark.cpp
+ * @brief Definition of the benchmark mode.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_benchmark.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string_view>
+
+#include "abcg_exception.hpp"
+#include "abcg_string.hpp"
+
+namespace {
+std::string toJSON(const abcg::FrameTimePercentiles &percentiles) {
+  if (percentiles.count == 0) return "null";
+  return fmt::format(
+      "{{\"p50\": {:.4f}, \"p95\": {:.4f}, \"p99\": {:.4f}, "
+      "\"max\": {:.4f}, \"count\": {}}}",
+      percentiles.p50, percentiles.p95, percentiles.p99, percentiles.max,
+      percentiles.count);
+}
+
+// Returns a field of /proc/self/status in bytes (e.g. VmRSS), if available
+std::optional<std::uint64_t> getProcessMemory(
+    [[maybe_unused]] std::string_view field) {
+#if defined(__linux__)
+  std::ifstream stream("/proc/self/status");
+  std::string line;
+  while (std::getline(stream, line)) {
+    if (line.starts_with(field) && line.size() > field.size() &&
+        line.at(field.size()) == ':') {
+      std::istringstream values{line.substr(field.size() + 1)};
+      std::uint64_t kibibytes{};
+      if (values >> kibibytes) return kibibytes * 1024;
+    }
+  }
+#endif
+  return std::nullopt;
+}
+
+std::string toJSON(const std::optional<std::uint64_t> &value) {
+  return value ? fmt::format("{}", *value) : "null";
+}
+}  // namespace
+
+/**
+ * @brief Loads an input timeline.
+ *
+ * @param path Path to the script.
+ *
+ * @throw abcg::Exception if the file cannot be read or contains an invalid
+ * line.
+ */
+void abcg::BenchmarkScript::loadFromFile(const std::filesystem::path &path) {
+  std::ifstream stream(path);
+  if (!stream) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to open benchmark script {}", path.string()))};
+  }
+
+  m_entries.clear();
+  m_next = 0;
+  std::string line;
+  for (auto lineNumber{1}; std::getline(stream, line); ++lineNumber) {
+    std::istringstream fields{line};
+    std::string type;
+    Entry entry;
+    if (!(fields >> entry.frame)) {
+      // Empty lines and comments
+      fields.clear();
+      fields.seekg(0);
+      if (!(fields >> type) || type.starts_with('#')) continue;
+    } else {
+      fields >> type;
+    }
+
+    auto &event{entry.event};
+    auto valid{true};
+    if (type == "keydown" || type == "keyup") {
+      std::string name;
+      valid = static_cast<bool>(fields >> name);
+      const auto key{SDL_GetKeyFromName(name.c_str())};
+      valid = valid && key != SDLK_UNKNOWN;
+      event.type = type == "keydown" ? SDL_KEYDOWN : SDL_KEYUP;
+      event.key.state = type == "keydown" ? SDL_PRESSED : SDL_RELEASED;
+      event.key.keysym.sym = key;
+      event.key.keysym.scancode = SDL_GetScancodeFromKey(key);
+    } else if (type == "mousemotion") {
+      event.type = SDL_MOUSEMOTION;
+      valid = static_cast<bool>(fields >> event.motion.x >> event.motion.y);
+    } else if (type == "mousebuttondown" || type == "mousebuttonup") {
+      int button{};
+      valid = static_cast<bool>(fields >> button >> event.button.x >>
+                                event.button.y) &&
+              button >= 1 && button <= 3;
+      event.type =
+          type == "mousebuttondown" ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+      event.button.state =
+          type == "mousebuttondown" ? SDL_PRESSED : SDL_RELEASED;
+      event.button.button = static_cast<Uint8>(button);
+      event.button.clicks = 1;
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      throw abcg::Exception{abcg::Exception::Runtime(
+          fmt::format("Invalid benchmark script line {}:{}: {}",
+                      path.string(), lineNumber, line))};
+    }
+    m_entries.push_back(entry);
+  }
+
+  std::stable_sort(
+      m_entries.begin(), m_entries.end(),
+      [](const auto &lhs, const auto &rhs) { return lhs.frame < rhs.frame; });
+}
+
+/**
+ * @brief Sends the events of a frame to the SDL event queue.
+ *
+ * Must be called once per frame, before the events are polled, with
+ * increasing frame numbers.
+ *
+ * @param frame Frame number, counted from the first warmup frame.
+ * @param windowID ID of the window that receives the events.
+ */
+void abcg::BenchmarkScript::pushEvents(std::uint64_t frame, Uint32 windowID) {
+  while (m_next < m_entries.size() && m_entries.at(m_next).frame <= frame) {
+    auto event{m_entries.at(m_next).event};
+    // All event structures start with type, timestamp and windowID
+    event.window.windowID = windowID;
+    event.window.timestamp = SDL_GetTicks();
+    SDL_PushEvent(&event);
+    ++m_next;
+  }
+}
+
+/**
+ * @brief Writes a benchmark report in JSON format.
+ *
+ * Frame times are in milliseconds. OpenGL counters are averages per frame,
+ * present only if ABCG_GL_STATS is defined. Memory usage is the resident set
+ * size of the process, available only on Linux.
+ *
+ * @param path Path to the JSON file.
+ * @param settings Settings of the benchmark.
+ * @param results Results of each window.
+ *
+ * @throw abcg::Exception if the file cannot be created.
+ */
+void abcg::writeBenchmarkReport(const std::filesystem::path &path,
+                                const BenchmarkSettings &settings,
+                                const std::vector<BenchmarkResult> &results) {
+  std::ofstream stream(path);
+  if (!stream) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to create benchmark report {}", path.string()))};
+  }
+
+  stream << "{\n";
+  stream << fmt::format("  \"warmupFrames\": {},\n", settings.warmupFrames);
+  stream << fmt::format("  \"measuredFrames\": {},\n",
+                        settings.measuredFrames);
+  stream << fmt::format("  \"headless\": {},\n", settings.headless);
+  stream << fmt::format("  \"script\": \"{}\",\n",
+                        abcg::escapeJSON(settings.scriptPath));
+  stream << fmt::format(
+      "  \"memory\": {{\"residentBytes\": {}, \"peakResidentBytes\": {}}},\n",
+      toJSON(getProcessMemory("VmRSS")), toJSON(getProcessMemory("VmHWM")));
+  stream << "  \"windows\": [";
+
+  auto separator{"\n"};
+  for (const auto &result : results) {
+    stream << separator << "    {\n";
+    separator = ",\n";
+    stream << fmt::format("      \"title\": \"{}\",\n",
+                          abcg::escapeJSON(result.title));
+    stream << fmt::format("      \"renderer\": \"{}\",\n",
+                          abcg::escapeJSON(result.renderer));
+    stream << fmt::format("      \"renderThread\": {},\n",
+                          result.renderThread);
+    stream << fmt::format("      \"elapsedSeconds\": {:.4f},\n",
+                          result.elapsedTime);
+    const auto frames{result.presentInterval.count};
+    stream << fmt::format(
+        "      \"averageFPS\": {:.2f},\n",
+        result.elapsedTime > 0.0
+            ? static_cast<double>(frames) / result.elapsedTime
+            : 0.0);
+    stream << fmt::format("      \"presentIntervalMs\": {},\n",
+                          toJSON(result.presentInterval));
+    stream << fmt::format("      \"cpuTimeMs\": {},\n", toJSON(result.cpuTime));
+    stream << fmt::format("      \"gpuTimeMs\": {},\n", toJSON(result.gpuTime));
+    stream << fmt::format("      \"budgetMs\": {:.4f},\n", result.budget);
+    stream << fmt::format("      \"framesOverBudget\": {},\n",
+                          result.overBudget);
+
+    if (result.glStatsFrames == 0) {
+      stream << "      \"glPerFrame\": null\n";
+    } else {
+      const auto &stats{result.glStats};
+      const auto perFrame{[&result](std::uint64_t total) {
+        return static_cast<double>(total) /
+               static_cast<double>(result.glStatsFrames);
+      }};
+      stream << fmt::format(
+          "      \"glPerFrame\": {{\"calls\": {:.1f}, \"drawCalls\": {:.1f}, "
+          "\"triangles\": {:.1f}, \"stateChanges\": {:.1f}, "
+          "\"bufferBytes\": {:.1f}, \"textureBytes\": {:.1f}, "
+          "\"filteredCalls\": {:.1f}}}\n",
+          perFrame(stats.totalCalls), perFrame(stats.drawCalls),
+          perFrame(stats.triangles), perFrame(stats.stateChanges),
+          perFrame(stats.bufferBytes), perFrame(stats.textureBytes),
+          perFrame(stats.filteredCalls));
+    }
+    stream << "    }";
+  }
+  stream << "\n  ]\n}\n";
+}
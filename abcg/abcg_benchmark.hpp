@@ -0,0 +1,99 @@
+/**
+ * @file abcg_benchmark.hpp
+ * @brief Header file of the benchmark mode.
+ *
+ * Declaration of abcg::BenchmarkSettings, abcg::BenchmarkResult and
+ * abcg::BenchmarkScript, and of the report writer.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_BENCHMARK_HPP_
+#define ABCG_BENCHMARK_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "abcg_external.hpp"
+#include "abcg_framestatistics.hpp"
+#include "abcg_openglstats.hpp"
+
+namespace abcg {
+class BenchmarkScript;
+struct BenchmarkResult;
+struct BenchmarkSettings;
+void writeBenchmarkReport(const std::filesystem::path& path,
+                          const BenchmarkSettings& settings,
+                          const std::vector<BenchmarkResult>& results);
+}  // namespace abcg
+
+/**
+ * @brief Settings of the benchmark mode of abcg::Application.
+ */
+struct abcg::BenchmarkSettings {
+  // Frames painted before the measurement starts
+  int warmupFrames{60};
+  int measuredFrames{600};
+  std::string reportPath{"benchmark.json"};
+  // Input timeline (see abcg::BenchmarkScript), or empty for no input
+  std::string scriptPath{};
+  bool headless{};
+};
+
+/**
+ * @brief Measurements of a window over the measured frames of a benchmark.
+ */
+struct abcg::BenchmarkResult {
+  std::string title;
+  std::string renderer;
+  bool renderThread{};
+  // Wall-clock time of the measured frames, in seconds
+  double elapsedTime{};
+  FrameTimePercentiles presentInterval;
+  FrameTimePercentiles cpuTime;
+  FrameTimePercentiles gpuTime;
+  double budget{};
+  std::size_t overBudget{};
+  // Sums over the measured frames, used only if ABCG_GL_STATS is defined
+  opengl::FrameStats glStats;
+  std::uint64_t glStatsFrames{};
+};
+
+/**
+ * @brief abcg::BenchmarkScript class.
+ *
+ * Input timeline replayed during a benchmark, so that the camera of an
+ * application can be driven the same way in every run. Each line of a
+ * script holds the frame at which an event is sent, counted from the first
+ * warmup frame, followed by the event:
+ *
+ *     <frame> keydown <key>
+ *     <frame> keyup <key>
+ *     <frame> mousemotion <x> <y>
+ *     <frame> mousebuttondown <button> <x> <y>
+ *     <frame> mousebuttonup <button> <x> <y>
+ *
+ * Keys are SDL key names (e.g. `W`, `Up`, `Space`) and buttons are 1 (left),
+ * 2 (middle) or 3 (right). Empty lines and lines starting with `#` are
+ * ignored.
+ */
+class abcg::BenchmarkScript {
+ public:
+  void loadFromFile(const std::filesystem::path& path);
+  void pushEvents(std::uint64_t frame, Uint32 windowID);
+
+ private:
+  struct Entry {
+    std::uint64_t frame{};
+    SDL_Event event{};
+  };
+
+  // Sorted by frame
+  std::vector<Entry> m_entries;
+  std::size_t m_next{};
+};
+
+#endif
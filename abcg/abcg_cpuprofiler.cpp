@@ -0,0 +1,188 @@
+/**
+ * @file abcg_cpuprofiler.cpp
+ * @brief Definition of the CPU profiler.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_cpuprofiler.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+#include "abcg_exception.hpp"
+#include "abcg_string.hpp"
+
+namespace {
+// Number of frame markers kept
+constexpr std::size_t maxFrames{256};
+
+struct Registry {
+  std::mutex mutex;
+  // Buffers are kept after their threads exit so that their events can
+  // still be exported
+  std::vector<std::unique_ptr<abcg::profiler::ThreadBuffer>> buffers;
+  std::vector<std::string> names;
+  std::deque<std::uint64_t> frames;
+};
+
+Registry &getRegistry() {
+  static Registry registry;
+  return registry;
+}
+}  // namespace
+
+/**
+ * @brief Copies the events still held by the buffer.
+ *
+ * Can be called from any thread, without blocking the owner thread.
+ *
+ * @param events Destination of the events, in the order they were completed.
+ */
+void abcg::profiler::ThreadBuffer::copyEvents(
+    std::vector<Event> &events) const {
+  const auto count{m_count.load(std::memory_order_acquire)};
+  const auto first{count > capacity ? count - capacity : 0};
+  events.clear();
+  events.reserve(static_cast<std::size_t>(count - first));
+  for (auto index{first}; index < count; ++index) {
+    const auto &slot{m_slots.at(index & (capacity - 1))};
+    const auto sequence{slot.sequence.load(std::memory_order_acquire)};
+    const Event event{slot.name.load(std::memory_order_relaxed),
+                      slot.begin.load(std::memory_order_relaxed),
+                      slot.end.load(std::memory_order_relaxed),
+                      slot.depth.load(std::memory_order_relaxed)};
+
+    // Drop the event if the owner thread overwrote the slot meanwhile, or
+    // is writing it
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence != 2 * index + 2 ||
+        slot.sequence.load(std::memory_order_relaxed) != sequence) {
+      continue;
+    }
+    events.push_back(event);
+  }
+}
+
+/**
+ * @brief Creates the ring buffer of the current thread.
+ *
+ * Called by abcg::profiler::getThreadBuffer on first use.
+ *
+ * @return Reference to the buffer.
+ */
+abcg::profiler::ThreadBuffer &abcg::profiler::registerThread() {
+  auto &registry{getRegistry()};
+  const std::scoped_lock lock{registry.mutex};
+  const auto id{static_cast<std::uint32_t>(registry.buffers.size())};
+  registry.buffers.push_back(std::make_unique<ThreadBuffer>(id));
+  registry.names.push_back(fmt::format("Thread {}", id));
+  return *registry.buffers.back();
+}
+
+/**
+ * @brief Marks the beginning of a frame.
+ *
+ * Called by abcg::Application at the beginning of each main loop iteration.
+ */
+void abcg::profiler::markFrame() {
+  const auto time{now()};
+  auto &registry{getRegistry()};
+  const std::scoped_lock lock{registry.mutex};
+  registry.frames.push_back(time);
+  if (registry.frames.size() > maxFrames) registry.frames.pop_front();
+}
+
+/**
+ * @brief Sets the name of the current thread, as shown in the profiler views.
+ *
+ * @param name Name of the thread.
+ */
+void abcg::profiler::setThreadName(std::string_view name) {
+  const auto id{getThreadBuffer().getId()};
+  auto &registry{getRegistry()};
+  const std::scoped_lock lock{registry.mutex};
+  registry.names.at(id) = name;
+}
+
+/**
+ * @brief Copies the events of all threads and the frame markers.
+ *
+ * @return Snapshot of the profiler state.
+ */
+abcg::profiler::Snapshot abcg::profiler::takeSnapshot() {
+  auto &registry{getRegistry()};
+  const std::scoped_lock lock{registry.mutex};
+  Snapshot snapshot;
+  snapshot.threads.resize(registry.buffers.size());
+  for (std::size_t index{}; index < registry.buffers.size(); ++index) {
+    auto &thread{snapshot.threads.at(index)};
+    thread.name = registry.names.at(index);
+    thread.id = registry.buffers.at(index)->getId();
+    registry.buffers.at(index)->copyEvents(thread.events);
+  }
+  snapshot.frames.assign(registry.frames.begin(), registry.frames.end());
+  return snapshot;
+}
+
+/**
+ * @brief Writes the recorded events in the Chrome trace event format.
+ *
+ * The file can be opened with chrome://tracing or Perfetto.
+ *
+ * @param path Path to the JSON file.
+ *
+ * @throw abcg::Exception if the file cannot be created.
+ */
+void abcg::profiler::exportChromeTrace(const std::filesystem::path &path) {
+  const auto snapshot{takeSnapshot()};
+
+  std::ofstream stream(path);
+  if (!stream) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to create trace file {}", path.string()))};
+  }
+
+  // Timestamps relative to the oldest one, in microseconds
+  auto origin{snapshot.frames.empty() ? now() : snapshot.frames.front()};
+  for (const auto &thread : snapshot.threads) {
+    for (const auto &event : thread.events) {
+      origin = std::min(origin, event.begin);
+    }
+  }
+  const auto toMicroseconds{[origin](std::uint64_t time) {
+    return static_cast<double>(time - origin) * 1e-3;
+  }};
+
+  stream << "{\"traceEvents\":[\n";
+  auto separator{""};
+  for (const auto &thread : snapshot.threads) {
+    stream << separator
+           << fmt::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                          "\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+                          thread.id, abcg::escapeJSON(thread.name));
+    separator = ",\n";
+    for (const auto &event : thread.events) {
+      stream << separator
+             << fmt::format("{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,"
+                            "\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                            abcg::escapeJSON(event.name), thread.id,
+                            toMicroseconds(event.begin),
+                            static_cast<double>(event.end - event.begin) *
+                                1e-3);
+    }
+  }
+  for (const auto frame : snapshot.frames) {
+    stream << separator
+           << fmt::format("{{\"name\":\"Frame\",\"ph\":\"i\",\"s\":\"g\","
+                          "\"pid\":1,\"tid\":0,\"ts\":{:.3f}}}",
+                          toMicroseconds(frame));
+    separator = ",\n";
+  }
+  stream << "\n]}\n";
+}
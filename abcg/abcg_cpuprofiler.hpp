@@ -0,0 +1,192 @@
+/**
+ * @file abcg_cpuprofiler.hpp
+ * @brief Declaration of the CPU profiler.
+ *
+ * Hierarchical CPU scopes recorded into per-thread ring buffers, frame
+ * markers, and export to the Chrome trace event format.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_CPUPROFILER_HPP_
+#define ABCG_CPUPROFILER_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace abcg {
+class CPUScope;
+}  // namespace abcg
+
+namespace abcg::profiler {
+class ThreadBuffer;
+struct Event;
+struct Snapshot;
+struct ThreadEvents;
+
+void markFrame();
+void setThreadName(std::string_view name);
+[[nodiscard]] Snapshot takeSnapshot();
+void exportChromeTrace(const std::filesystem::path& path);
+[[nodiscard]] ThreadBuffer& registerThread();
+}  // namespace abcg::profiler
+
+/**
+ * @brief Scope recorded by the CPU profiler.
+ */
+struct abcg::profiler::Event {
+  // Pointer to a string with static storage duration (e.g. a literal)
+  const char* name{};
+  // Timestamps in nanoseconds of std::chrono::steady_clock
+  std::uint64_t begin{};
+  std::uint64_t end{};
+  // Nesting level, 0 for top-level scopes
+  std::uint32_t depth{};
+};
+
+/**
+ * @brief Events of one thread, in the order they were completed.
+ */
+struct abcg::profiler::ThreadEvents {
+  std::string name;
+  std::uint32_t id{};
+  std::vector<Event> events;
+};
+
+/**
+ * @brief Copy of the events of all threads and of the frame markers.
+ */
+struct abcg::profiler::Snapshot {
+  std::vector<ThreadEvents> threads;
+  // Timestamps of the frame markers, oldest first
+  std::vector<std::uint64_t> frames;
+};
+
+/**
+ * @brief abcg::profiler::ThreadBuffer class.
+ *
+ * Fixed-size ring of the events completed by a thread. Only the owner thread
+ * writes to it; other threads read it without locking. Each slot has a
+ * sequence number, odd while the slot is being written, so that readers
+ * discard the events that were overwritten while being copied.
+ */
+class abcg::profiler::ThreadBuffer {
+ public:
+  static constexpr std::size_t capacity{std::size_t{1} << 14U};
+
+  explicit ThreadBuffer(std::uint32_t id) : m_id{id} {}
+
+  void push(const Event& event) noexcept {
+    const auto count{m_count.load(std::memory_order_relaxed)};
+    auto& slot{m_slots[count & (capacity - 1)]};
+    slot.sequence.store(2 * count + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(event.name, std::memory_order_relaxed);
+    slot.begin.store(event.begin, std::memory_order_relaxed);
+    slot.end.store(event.end, std::memory_order_relaxed);
+    slot.depth.store(event.depth, std::memory_order_relaxed);
+    slot.sequence.store(2 * count + 2, std::memory_order_release);
+    m_count.store(count + 1, std::memory_order_release);
+  }
+
+  [[nodiscard]] std::uint32_t getId() const noexcept { return m_id; }
+  void copyEvents(std::vector<Event>& events) const;
+
+  // Nesting level of the next scope, used only by the owner thread
+  std::uint32_t depth{};
+
+ private:
+  // Event stored as atomics, so that it can be read while it is written
+  struct Slot {
+    // 2 * n + 2 once the slot holds the n-th event of the thread
+    std::atomic<std::uint64_t> sequence{};
+    std::atomic<const char*> name{};
+    std::atomic<std::uint64_t> begin{};
+    std::atomic<std::uint64_t> end{};
+    std::atomic<std::uint32_t> depth{};
+  };
+
+  std::array<Slot, capacity> m_slots{};
+  std::atomic<std::uint64_t> m_count{};
+  std::uint32_t m_id{};
+};
+
+namespace abcg::profiler {
+// Ring buffer of the current thread, or nullptr if not registered yet
+inline thread_local ThreadBuffer* threadBuffer{};
+
+/**
+ * @brief Returns the current time of the profiler clock.
+ *
+ * @return Time in nanoseconds of std::chrono::steady_clock.
+ */
+[[nodiscard]] inline std::uint64_t now() noexcept {
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+/**
+ * @brief Returns the ring buffer of the current thread.
+ *
+ * @return Reference to the buffer, created on first use.
+ */
+[[nodiscard]] inline ThreadBuffer& getThreadBuffer() {
+  if (threadBuffer == nullptr) [[unlikely]]
+    threadBuffer = &registerThread();
+  return *threadBuffer;
+}
+}  // namespace abcg::profiler
+
+/**
+ * @brief abcg::CPUScope class.
+ *
+ * Records the CPU time between its construction and destruction. Recording
+ * a scope reads the clock twice and writes a single event, without
+ * allocations or locks. Use the ABCG_PROFILE_SCOPE and ABCG_PROFILE_FUNCTION
+ * macros.
+ */
+class abcg::CPUScope {
+ public:
+  explicit CPUScope(const char* name)
+      : m_buffer{profiler::getThreadBuffer()},
+        m_name{name},
+        m_depth{m_buffer.depth++},
+        m_begin{profiler::now()} {}
+  ~CPUScope() {
+    m_buffer.push({m_name, m_begin, profiler::now(), m_depth});
+    --m_buffer.depth;
+  }
+
+  CPUScope(const CPUScope&) = delete;
+  CPUScope(CPUScope&&) = delete;
+  CPUScope& operator=(const CPUScope&) = delete;
+  CPUScope& operator=(CPUScope&&) = delete;
+
+ private:
+  profiler::ThreadBuffer& m_buffer;
+  const char* m_name{};
+  std::uint32_t m_depth{};
+  std::uint64_t m_begin{};
+};
+
+#define ABCG_PROFILE_CONCAT_IMPL(a, b) a##b
+#define ABCG_PROFILE_CONCAT(a, b) ABCG_PROFILE_CONCAT_IMPL(a, b)
+
+// Records the rest of the enclosing block. The name must be a string with
+// static storage duration.
+#define ABCG_PROFILE_SCOPE(name) \
+  const abcg::CPUScope ABCG_PROFILE_CONCAT(abcgProfileScope, __LINE__) { name }
+
+// Records the rest of the enclosing function
+#define ABCG_PROFILE_FUNCTION() ABCG_PROFILE_SCOPE(__func__)
+
+#endif
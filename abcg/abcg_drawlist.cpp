@@ -0,0 +1,143 @@
+/**
+ * @file abcg_drawlist.cpp
+ * @brief Definition of abcg::DrawList class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_drawlist.hpp"
+
+#include <span>
+
+#include "abcg_openglfunctions.hpp"
+
+/**
+ * @brief Checks for multi-draw indirect support and creates the buffer of
+ * draw commands.
+ *
+ * @param maxDrawsPerFrame Maximum number of draws submitted in a single
+ * frame, summed over all calls of submit.
+ *
+ * @throw abcg::Exception if the buffer of draw commands cannot be mapped.
+ */
+void abcg::DrawList::create(GLsizei maxDrawsPerFrame) {
+  destroy();
+
+#if !defined(__EMSCRIPTEN__)
+  // The base instance of indirect commands is ignored without
+  // GL_ARB_base_instance (core in OpenGL 4.2)
+  m_multiDrawIndirect = GLEW_VERSION_4_3 == GL_TRUE ||
+                        (GLEW_ARB_multi_draw_indirect == GL_TRUE &&
+                         GLEW_ARB_base_instance == GL_TRUE);
+#endif
+  if (m_multiDrawIndirect) {
+    m_indirectBuffer.create(maxDrawsPerFrame *
+                            static_cast<GLsizeiptr>(sizeof(Command)));
+  }
+  m_commands.reserve(static_cast<std::size_t>(maxDrawsPerFrame));
+}
+
+/**
+ * @brief Releases the buffer of draw commands.
+ */
+void abcg::DrawList::destroy() {
+  m_indirectBuffer.destroy();
+  m_commands.clear();
+  m_multiDrawIndirect = false;
+}
+
+/**
+ * @brief Starts a new frame.
+ *
+ * Must be called once per frame, before the first submit. Draws added but
+ * not submitted in the previous frame are discarded.
+ */
+void abcg::DrawList::beginFrame() {
+  if (m_multiDrawIndirect) m_indirectBuffer.beginFrame();
+  m_commands.clear();
+}
+
+/**
+ * @brief Adds an instanced draw of a mesh.
+ *
+ * @param mesh Range of the mesh in the geometry buffer given to submit.
+ * @param instanceCount Number of instances. Nothing is drawn if zero.
+ * @param baseInstance Index of the data of the first instance in the array
+ * given to submit.
+ */
+void abcg::DrawList::add(const MeshRange &mesh, GLuint instanceCount,
+                         GLuint baseInstance) {
+  if (mesh.indexCount <= 0 || instanceCount == 0) return;
+
+  m_commands.push_back({static_cast<GLuint>(mesh.indexCount), instanceCount,
+                        mesh.firstIndex, mesh.baseVertex, baseInstance});
+}
+
+/**
+ * @brief Draws the triangles of the draws added since the last submit, and
+ * clears the list.
+ *
+ * The program, uniforms and textures used by the draws must be bound.
+ *
+ * @param geometry Buffers of the meshes of the draws.
+ * @param instanceBuffer Buffer object with the per-instance data, in the
+ * format of the instance attributes of geometry, or 0 if there are none.
+ * @param instanceOffset Offset of the first instance data in instanceBuffer.
+ *
+ * @throw abcg::Exception if the frame has more draws than given to create.
+ */
+void abcg::DrawList::submit(const GeometryBuffer &geometry,
+                            GLuint instanceBuffer, GLintptr instanceOffset) {
+  if (m_commands.empty()) return;
+
+  glBindVertexArray(geometry.getVertexArray());
+
+  if (m_multiDrawIndirect) {
+#if !defined(__EMSCRIPTEN__)
+    if (instanceBuffer != 0) {
+      geometry.bindInstances(instanceBuffer, instanceOffset);
+    }
+    const auto offset{
+        m_indirectBuffer.push(std::span<const Command>{m_commands})};
+    m_indirectBuffer.flush();
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer.getBuffer());
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                reinterpret_cast<const void *>(offset),
+                                static_cast<GLsizei>(m_commands.size()), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    for (const auto &command : m_commands) {
+      opengl::recordPrimitives(GL_TRIANGLES,
+                               static_cast<GLsizei>(command.count),
+                               static_cast<GLsizei>(command.instanceCount));
+    }
+#endif
+  } else {
+    for (const auto &command : m_commands) {
+      if (instanceBuffer != 0) {
+        geometry.bindInstances(
+            instanceBuffer,
+            instanceOffset + static_cast<GLintptr>(command.baseInstance) *
+                                 geometry.getInstanceStride());
+      }
+      const auto *indices{reinterpret_cast<const void *>(
+          static_cast<GLintptr>(command.firstIndex * sizeof(GLuint)))};
+#if defined(__EMSCRIPTEN__)
+      // Base vertices were added to the indices by GeometryBuffer::add
+      glDrawElementsInstanced(GL_TRIANGLES,
+                              static_cast<GLsizei>(command.count),
+                              GL_UNSIGNED_INT, indices,
+                              static_cast<GLsizei>(command.instanceCount));
+#else
+      glDrawElementsInstancedBaseVertex(
+          GL_TRIANGLES, static_cast<GLsizei>(command.count), GL_UNSIGNED_INT,
+          indices, static_cast<GLsizei>(command.instanceCount),
+          command.baseVertex);
+#endif
+    }
+  }
+
+  glBindVertexArray(0);
+  m_commands.clear();
+}
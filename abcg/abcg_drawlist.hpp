@@ -0,0 +1,83 @@
+/**
+ * @file abcg_drawlist.hpp
+ * @brief abcg::DrawList header file.
+ *
+ * Declaration of abcg::DrawList class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_DRAWLIST_HPP_
+#define ABCG_DRAWLIST_HPP_
+
+#include <cstddef>
+#include <vector>
+
+#include "abcg_external.hpp"
+#include "abcg_geometrybuffer.hpp"
+#include "abcg_streamingbuffer.hpp"
+
+namespace abcg {
+class DrawList;
+}  // namespace abcg
+
+/**
+ * @brief abcg::DrawList class.
+ *
+ * List of instanced draws of meshes stored in an abcg::GeometryBuffer,
+ * submitted together.
+ *
+ * If OpenGL 4.3, or GL_ARB_multi_draw_indirect with GL_ARB_base_instance, is
+ * available, the draw commands are written to a streaming
+ * GL_DRAW_INDIRECT_BUFFER and the whole list is submitted with a single
+ * glMultiDrawElementsIndirect. The base instance of each command selects the
+ * per-instance data of the draw, so that the draws read their transforms and
+ * other per-draw data from one instance array.
+ *
+ * Otherwise (e.g. OpenGL 4.1 or OpenGL ES), the commands are issued one by
+ * one, and the per-instance attributes are pointed at the data of each draw
+ * before the call. Multi-draw without indirection (glMultiDrawElements) is
+ * not used as the fallback because it cannot draw instances nor tell the
+ * shader which draw is being processed.
+ *
+ * A typical frame calls beginFrame, adds the draws that share a program and
+ * uniforms, submits them, and repeats add and submit for each other group.
+ * All members except add must be called with the OpenGL context current.
+ */
+class abcg::DrawList {
+ public:
+  /**
+   * @brief Draw command, in the layout read by glMultiDrawElementsIndirect.
+   */
+  struct Command {
+    GLuint count{};
+    GLuint instanceCount{};
+    GLuint firstIndex{};
+    GLint baseVertex{};
+    GLuint baseInstance{};
+  };
+
+  void create(GLsizei maxDrawsPerFrame);
+  void destroy();
+
+  void beginFrame();
+  void add(const MeshRange& mesh, GLuint instanceCount = 1,
+           GLuint baseInstance = 0);
+  void submit(const GeometryBuffer& geometry, GLuint instanceBuffer = 0,
+              GLintptr instanceOffset = 0);
+
+  // Whether submit uses a single glMultiDrawElementsIndirect
+  [[nodiscard]] bool isMultiDrawIndirect() const noexcept {
+    return m_multiDrawIndirect;
+  }
+  // Number of draws added since the last submit
+  [[nodiscard]] std::size_t size() const noexcept { return m_commands.size(); }
+
+ private:
+  std::vector<Command> m_commands;
+  // Commands of the current frame, if multi-draw indirect is used
+  StreamingBuffer m_indirectBuffer;
+  bool m_multiDrawIndirect{};
+};
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * @file abcg_framelimiter.cpp
+ * @brief Definition of abcg::FrameLimiter class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_framelimiter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+using namespace std::chrono;
+
+/**
+ * @brief Sets the target rate.
+ *
+ * @param framesPerSecond Number of iterations per second, or 0 for no limit.
+ */
+void abcg::FrameLimiter::setTargetRate(double framesPerSecond) {
+  if (framesPerSecond <= 0.0) {
+    m_period = clock::duration::zero();
+  } else {
+    m_period = duration_cast<clock::duration>(
+        duration<double>(1.0 / framesPerSecond));
+  }
+  reset();
+}
+
+/**
+ * @brief Returns the target rate.
+ *
+ * @return Number of iterations per second, or 0 if there is no limit.
+ */
+double abcg::FrameLimiter::getTargetRate() const noexcept {
+  if (m_period == clock::duration::zero()) return 0.0;
+  return 1.0 / duration_cast<duration<double>>(m_period).count();
+}
+
+/**
+ * @brief Blocks until the start of the next period.
+ */
+void abcg::FrameLimiter::wait() {
+  if (m_period == clock::duration::zero()) return;
+
+  auto now{clock::now()};
+  if (now > m_deadline + m_period) {
+    // First call, or too late to keep the schedule
+    m_deadline = now;
+  }
+
+  // Sleep in short steps, each shortened by the expected oversleep, until
+  // only the spin time is left
+  constexpr auto spinTime{0.0005};
+  constexpr auto maxSleep{0.001};
+  while (true) {
+    const auto remaining{
+        duration_cast<duration<double>>(m_deadline - now).count()};
+    const auto sleep{
+        std::min(maxSleep, remaining - spinTime - getSleepError())};
+    if (sleep <= 0.0) break;
+    std::this_thread::sleep_for(duration<double>(sleep));
+    const auto woken{clock::now()};
+    updateSleepEstimate(
+        duration_cast<duration<double>>(woken - now).count() - sleep);
+    now = woken;
+  }
+
+  // Spin for the rest
+  while (clock::now() < m_deadline) {
+  }
+
+  m_deadline += m_period;
+}
+
+/**
+ * @brief Restarts the schedule at the next call to wait().
+ */
+void abcg::FrameLimiter::reset() noexcept { m_deadline = {}; }
+
+// Expected oversleep of a sleep: mean plus one standard deviation, or zero
+// before the first sleep
+double abcg::FrameLimiter::getSleepError() const {
+  if (m_sleepCount == 0) return 0.0;
+  return m_sleepMean +
+         std::sqrt(m_sleepM2 / static_cast<double>(m_sleepCount));
+}
+
+// Welford's online algorithm, with the count bounded so that the estimate
+// follows changes in the system load
+void abcg::FrameLimiter::updateSleepEstimate(double oversleep) {
+  const long maxCount{1000};
+  m_sleepCount = std::min(m_sleepCount + 1, maxCount);
+  const auto delta{oversleep - m_sleepMean};
+  m_sleepMean += delta / static_cast<double>(m_sleepCount);
+  m_sleepM2 += delta * (oversleep - m_sleepMean);
+  if (m_sleepCount == maxCount) {
+    m_sleepM2 *= static_cast<double>(maxCount - 1) /
+                 static_cast<double>(maxCount);
+  }
+}
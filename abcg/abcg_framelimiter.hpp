@@ -0,0 +1,52 @@
+/**
+ * @file abcg_framelimiter.hpp
+ * @brief abcg::FrameLimiter header file.
+ *
+ * Declaration of abcg::FrameLimiter class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_FRAMELIMITER_HPP_
+#define ABCG_FRAMELIMITER_HPP_
+
+#include <chrono>
+
+namespace abcg {
+class FrameLimiter;
+}  // namespace abcg
+
+/**
+ * @brief abcg::FrameLimiter class.
+ *
+ * Paces a loop to a target rate. Each wait sleeps in steps of at most 1 ms,
+ * each shortened by the expected oversleep of the system, until less than
+ * half a millisecond is left, and then spins until the deadline, so that the
+ * loop neither burns a core nor oversleeps.
+ * Deadlines are spaced by the target period; if the loop falls behind by
+ * more than one period, the schedule restarts instead of catching up.
+ */
+class abcg::FrameLimiter {
+ public:
+  void setTargetRate(double framesPerSecond);
+  [[nodiscard]] double getTargetRate() const noexcept;
+
+  void wait();
+  void reset() noexcept;
+
+ private:
+  using clock = std::chrono::steady_clock;
+
+  clock::duration m_period{};
+  clock::time_point m_deadline{};
+
+  // Running mean and variance of the oversleep of a sleep, in seconds
+  double m_sleepMean{};
+  double m_sleepM2{};
+  long m_sleepCount{};
+
+  [[nodiscard]] double getSleepError() const;
+  void updateSleepEstimate(double oversleep);
+};
+
+#endif
@@ -0,0 +1,185 @@
+/**
+ * @file abcg_framestatistics.cpp
+ * @brief Definition of abcg::FrameStatistics class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_framestatistics.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <string>
+
+#include "abcg_exception.hpp"
+
+/**
+ * @brief Sets the number of frames kept.
+ *
+ * Recorded samples are discarded.
+ *
+ * @param capacity Number of frames.
+ */
+void abcg::FrameStatistics::setCapacity(std::size_t capacity) {
+  m_capacity = std::max(capacity, std::size_t{1});
+  m_samples.clear();
+  m_next = 0;
+}
+
+/**
+ * @brief Records the timings of a frame.
+ *
+ * The oldest sample is replaced once the capacity is reached.
+ *
+ * @param sample Timings of the frame.
+ */
+void abcg::FrameStatistics::addSample(const FrameSample &sample) {
+  if (m_samples.size() < m_capacity) {
+    m_samples.push_back(sample);
+  } else {
+    m_samples.at(m_next) = sample;
+    m_next = (m_next + 1) % m_capacity;
+  }
+
+  ++m_totalFrames;
+  if (sample.presentInterval > m_budget) ++m_totalOverBudget;
+}
+
+/**
+ * @brief Sets the GPU time of a recorded frame.
+ *
+ * GPU times are known only a few frames later. Frames no longer in the
+ * window are ignored.
+ *
+ * @param frame Number of the frame.
+ * @param milliseconds GPU time of the frame.
+ */
+void abcg::FrameStatistics::setGPUTime(std::uint64_t frame,
+                                       double milliseconds) {
+  // Search backwards, as the frame is usually among the last ones
+  for (auto index{size()}; index > 0; --index) {
+    auto &sample{m_samples.at((m_next + index - 1) % m_samples.size())};
+    if (sample.frame == frame) {
+      sample.gpuTime = milliseconds;
+      return;
+    }
+    if (sample.frame < frame) return;
+  }
+}
+
+/**
+ * @brief Discards the recorded samples and resets the totals.
+ */
+void abcg::FrameStatistics::clear() {
+  m_samples.clear();
+  m_next = 0;
+  m_totalFrames = 0;
+  m_totalOverBudget = 0;
+}
+
+/**
+ * @brief Returns a recorded sample.
+ *
+ * @param index Index of the sample, from 0 (oldest) to size() - 1 (newest).
+ * @return Sample.
+ */
+const abcg::FrameSample &abcg::FrameStatistics::at(std::size_t index) const {
+  return m_samples.at((m_next + index) % m_samples.size());
+}
+
+/**
+ * @brief Returns a timing of a recorded sample.
+ *
+ * @param index Index of the sample, from 0 (oldest) to size() - 1 (newest).
+ * @param metric Timing to be returned.
+ * @return Timing in milliseconds. Negative if not measured.
+ */
+double abcg::FrameStatistics::getValue(std::size_t index,
+                                       FrameMetric metric) const {
+  const auto &sample{at(index)};
+  switch (metric) {
+    case FrameMetric::CPUTime:
+      return sample.cpuTime;
+    case FrameMetric::GPUTime:
+      return sample.gpuTime;
+    case FrameMetric::PresentInterval:
+      return sample.presentInterval;
+  }
+  return 0.0;
+}
+
+/**
+ * @brief Computes the percentiles of a timing over the recorded samples.
+ *
+ * Uses the nearest-rank method. Samples in which the timing was not measured
+ * are ignored.
+ *
+ * @param metric Timing.
+ * @return Percentiles, all zero if there are no samples.
+ */
+abcg::FrameTimePercentiles abcg::FrameStatistics::getPercentiles(
+    FrameMetric metric) const {
+  std::vector<double> values;
+  values.reserve(size());
+  for (std::size_t index{}; index < size(); ++index) {
+    if (const auto value{getValue(index, metric)}; value >= 0.0) {
+      values.push_back(value);
+    }
+  }
+  if (values.empty()) return {};
+
+  std::sort(values.begin(), values.end());
+  const auto percentile{[&values](double fraction) {
+    const auto rank{static_cast<std::size_t>(
+        std::ceil(fraction * static_cast<double>(values.size())))};
+    return values.at(std::max(rank, std::size_t{1}) - 1);
+  }};
+  return {.p50 = percentile(0.50),
+          .p95 = percentile(0.95),
+          .p99 = percentile(0.99),
+          .max = values.back(),
+          .count = values.size()};
+}
+
+/**
+ * @brief Counts the recorded frames whose present interval exceeds the
+ * budget.
+ *
+ * @return Number of frames over budget.
+ */
+std::size_t abcg::FrameStatistics::countOverBudget() const {
+  return static_cast<std::size_t>(std::count_if(
+      m_samples.begin(), m_samples.end(), [this](const auto &sample) {
+        return sample.presentInterval > m_budget;
+      }));
+}
+
+/**
+ * @brief Writes the recorded samples to a CSV file, oldest first.
+ *
+ * GPU times not measured are left empty.
+ *
+ * @param path Path to the CSV file.
+ *
+ * @throw abcg::Exception if the file cannot be created.
+ */
+void abcg::FrameStatistics::exportCSV(const std::filesystem::path &path) const {
+  std::ofstream stream(path);
+  if (!stream) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to create CSV file {}", path.string()))};
+  }
+
+  stream << "frame,cpu_ms,gpu_ms,present_ms\n";
+  for (std::size_t index{}; index < size(); ++index) {
+    const auto &sample{at(index)};
+    const auto gpuTime{sample.gpuTime < 0.0
+                           ? std::string{}
+                           : fmt::format("{:.4f}", sample.gpuTime)};
+    stream << fmt::format("{},{:.4f},{},{:.4f}\n", sample.frame,
+                          sample.cpuTime, gpuTime, sample.presentInterval);
+  }
+}
@@ -0,0 +1,99 @@
+/**
+ * @file abcg_framestatistics.hpp
+ * @brief abcg::FrameStatistics header file.
+ *
+ * Declaration of abcg::FrameStatistics class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_FRAMESTATISTICS_HPP_
+#define ABCG_FRAMESTATISTICS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace abcg {
+class FrameStatistics;
+enum class FrameMetric;
+struct FrameSample;
+struct FrameTimePercentiles;
+}  // namespace abcg
+
+/**
+ * @brief Timings of one frame, in milliseconds.
+ */
+struct abcg::FrameSample {
+  std::uint64_t frame{};
+  // Time spent by the CPU in the frame, up to the buffer swap
+  double cpuTime{};
+  // GPU time of the frame, or a negative value if not measured
+  double gpuTime{-1.0};
+  // Time between the buffer swap of the previous frame and this one
+  double presentInterval{};
+};
+
+/**
+ * @brief Enumeration of the timings of abcg::FrameSample.
+ */
+enum class abcg::FrameMetric { CPUTime, GPUTime, PresentInterval };
+
+/**
+ * @brief Percentiles of a timing, in milliseconds.
+ */
+struct abcg::FrameTimePercentiles {
+  double p50{};
+  double p95{};
+  double p99{};
+  double max{};
+  // Number of samples used
+  std::size_t count{};
+};
+
+/**
+ * @brief abcg::FrameStatistics class.
+ *
+ * Records the timings of every frame in a fixed-size window of recent frames
+ * and computes their percentiles, so that isolated hitches are not hidden by
+ * averaging.
+ */
+class abcg::FrameStatistics {
+ public:
+  void setCapacity(std::size_t capacity);
+  [[nodiscard]] std::size_t getCapacity() const noexcept { return m_capacity; }
+  void setBudget(double milliseconds) noexcept { m_budget = milliseconds; }
+  [[nodiscard]] double getBudget() const noexcept { return m_budget; }
+
+  void addSample(const FrameSample& sample);
+  void setGPUTime(std::uint64_t frame, double milliseconds);
+  void clear();
+
+  [[nodiscard]] std::size_t size() const noexcept { return m_samples.size(); }
+  [[nodiscard]] const FrameSample& at(std::size_t index) const;
+  [[nodiscard]] double getValue(std::size_t index, FrameMetric metric) const;
+  [[nodiscard]] FrameTimePercentiles getPercentiles(FrameMetric metric) const;
+  [[nodiscard]] std::size_t countOverBudget() const;
+  [[nodiscard]] std::uint64_t getTotalFrames() const noexcept {
+    return m_totalFrames;
+  }
+  [[nodiscard]] std::uint64_t getTotalOverBudget() const noexcept {
+    return m_totalOverBudget;
+  }
+
+  void exportCSV(const std::filesystem::path& path) const;
+
+ private:
+  // Ring of samples; m_next is the position of the oldest one once full
+  std::vector<FrameSample> m_samples;
+  std::size_t m_next{};
+  std::size_t m_capacity{1024};
+  // Frame budget in milliseconds (60 Hz)
+  double m_budget{1000.0 / 60.0};
+
+  std::uint64_t m_totalFrames{};
+  std::uint64_t m_totalOverBudget{};
+};
+
+#endif
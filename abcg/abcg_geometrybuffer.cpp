@@ -0,0 +1,393 @@
+/**
+ * @file abcg_geometrybuffer.cpp
+ * @brief Definition of abcg::GeometryBuffer class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_geometrybuffer.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "abcg_openglfunctions.hpp"
+
+namespace {
+// Creates a buffer object with uninitialized storage
+GLuint createBuffer(GLsizeiptr size) {
+  GLuint buffer{};
+  abcg::glGenBuffers(1, &buffer);
+  abcg::glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+  abcg::glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
+  abcg::glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  return buffer;
+}
+
+// Copies bytes between two buffer objects
+void copyBuffer(GLuint source, GLintptr sourceOffset, GLuint destination,
+                GLintptr destinationOffset, GLsizeiptr size) {
+  if (size <= 0) return;
+
+  abcg::glBindBuffer(GL_COPY_READ_BUFFER, source);
+  abcg::glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+  abcg::glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                            sourceOffset, destinationOffset, size);
+  abcg::glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  abcg::glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+}  // namespace
+
+/**
+ * @brief Creates the vertex array object for a vertex format.
+ *
+ * The buffers are created by the first call of add.
+ *
+ * @param vertexStride Size of a vertex in bytes.
+ * @param vertexAttributes Attributes read from the vertices.
+ * @param instanceStride Size of the data of an instance in bytes.
+ * @param instanceAttributes Attributes that advance once per instance, read
+ * from the buffer given to bindInstances.
+ */
+void abcg::GeometryBuffer::create(
+    GLsizei vertexStride, std::span<const VertexAttribute> vertexAttributes,
+    GLsizei instanceStride,
+    std::span<const VertexAttribute> instanceAttributes) {
+  destroy();
+
+  m_vertexStride = vertexStride;
+  m_instanceStride = instanceStride;
+  m_vertexAttributes.assign(vertexAttributes.begin(), vertexAttributes.end());
+  m_instanceAttributes.assign(instanceAttributes.begin(),
+                              instanceAttributes.end());
+
+  glGenVertexArrays(1, &m_VAO);
+  glBindVertexArray(m_VAO);
+  for (const auto &attribute : m_vertexAttributes) {
+    glEnableVertexAttribArray(attribute.location);
+  }
+  for (const auto &attribute : m_instanceAttributes) {
+    glEnableVertexAttribArray(attribute.location);
+    glVertexAttribDivisor(attribute.location, 1);
+  }
+  glBindVertexArray(0);
+}
+
+/**
+ * @brief Releases the buffers and the vertex array object, and removes all
+ * meshes.
+ */
+void abcg::GeometryBuffer::destroy() {
+  glDeleteBuffers(1, &m_EBO);
+  glDeleteBuffers(1, &m_VBO);
+  glDeleteVertexArrays(1, &m_VAO);
+  m_EBO = 0;
+  m_VBO = 0;
+  m_VAO = 0;
+  m_vertexAttributes.clear();
+  m_instanceAttributes.clear();
+  m_vertexAllocator.reset(0);
+  m_indexAllocator.reset(0);
+  m_vertexCount = 0;
+  m_indexCount = 0;
+  m_meshes.clear();
+  m_freeMeshes.clear();
+}
+
+/**
+ * @brief Adds a mesh to the buffers.
+ *
+ * @param vertices Pointer to the vertices of the mesh, in the format given to
+ * create.
+ * @param vertexCount Number of vertices.
+ * @param indices Indices of the mesh, relative to its first vertex.
+ * @return Handle of the mesh.
+ */
+abcg::GeometryBuffer::MeshID abcg::GeometryBuffer::add(
+    const void *vertices, GLsizei vertexCount,
+    std::span<const GLuint> indices) {
+  const auto indexCount{static_cast<GLsizei>(indices.size())};
+  const auto previousVBO{m_VBO};
+  const auto previousEBO{m_EBO};
+
+  Mesh mesh;
+  mesh.used = true;
+  mesh.vertexCount = vertexCount;
+  mesh.firstVertex =
+      allocate(m_vertexAllocator, m_VBO, vertexCount, m_vertexStride);
+  mesh.range.indexCount = indexCount;
+  mesh.range.firstIndex = static_cast<GLuint>(
+      allocate(m_indexAllocator, m_EBO, indexCount, sizeof(GLuint)));
+#if !defined(__EMSCRIPTEN__)
+  mesh.range.baseVertex = mesh.firstVertex;
+#endif
+  if (m_VBO != previousVBO || m_EBO != previousEBO) bindBuffers();
+
+  if (vertexCount > 0) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_VBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER,
+                    static_cast<GLintptr>(mesh.firstVertex) * m_vertexStride,
+                    static_cast<GLsizeiptr>(vertexCount) * m_vertexStride,
+                    vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+  writeIndices(mesh, indices);
+#if defined(__EMSCRIPTEN__)
+  mesh.indices.assign(indices.begin(), indices.end());
+#endif
+
+  m_vertexCount += vertexCount;
+  m_indexCount += indexCount;
+
+  MeshID id{m_meshes.size()};
+  if (m_freeMeshes.empty()) {
+    m_meshes.push_back(std::move(mesh));
+  } else {
+    id = m_freeMeshes.back();
+    m_freeMeshes.pop_back();
+    m_meshes.at(id) = std::move(mesh);
+  }
+  return id;
+}
+
+/**
+ * @brief Removes a mesh from the buffers.
+ *
+ * Frees the slices of the mesh, and compacts the buffers if the holes left
+ * by removed meshes take more than a quarter of either buffer. The ranges of
+ * the other meshes may change.
+ *
+ * @param mesh Handle of the mesh. Its value may be returned again by add.
+ */
+void abcg::GeometryBuffer::remove(MeshID mesh) {
+  auto &removed{m_meshes.at(mesh)};
+  if (!removed.used) return;
+
+  m_vertexAllocator.free(removed.firstVertex, removed.vertexCount);
+  m_indexAllocator.free(static_cast<GLsizei>(removed.range.firstIndex),
+                        removed.range.indexCount);
+  m_vertexCount -= removed.vertexCount;
+  m_indexCount -= removed.range.indexCount;
+  removed = {};
+  m_freeMeshes.push_back(mesh);
+
+  const auto fragmented{[](const RangeAllocator &allocator) {
+    return allocator.getHoleSize() * 4 > allocator.getCapacity();
+  }};
+  if (fragmented(m_vertexAllocator) || fragmented(m_indexAllocator)) {
+    defragment();
+  }
+}
+
+/**
+ * @brief Moves all meshes to the start of the buffers, in the order of their
+ * handles, so that the free space is a single range at the end.
+ *
+ * The meshes are copied on the GPU to new buffers of the same size. The
+ * ranges of the meshes change.
+ */
+void abcg::GeometryBuffer::defragment() {
+  if (m_VBO == 0 || m_EBO == 0) return;
+
+  const auto vertexCapacity{m_vertexAllocator.getCapacity()};
+  const auto indexCapacity{m_indexAllocator.getCapacity()};
+  const auto vertexBuffer{
+      createBuffer(static_cast<GLsizeiptr>(vertexCapacity) * m_vertexStride)};
+  const auto indexBuffer{createBuffer(static_cast<GLsizeiptr>(indexCapacity) *
+                                      static_cast<GLsizeiptr>(sizeof(GLuint)))};
+
+  GLsizei nextVertex{};
+  GLsizei nextIndex{};
+  for (auto &mesh : m_meshes) {
+    if (!mesh.used) continue;
+
+    const GLintptr stride{m_vertexStride};
+    copyBuffer(m_VBO, mesh.firstVertex * stride, vertexBuffer,
+               nextVertex * stride, mesh.vertexCount * stride);
+    mesh.firstVertex = nextVertex;
+    nextVertex += mesh.vertexCount;
+
+#if !defined(__EMSCRIPTEN__)
+    const GLintptr indexSize{sizeof(GLuint)};
+    copyBuffer(m_EBO, mesh.range.firstIndex * indexSize, indexBuffer,
+               nextIndex * indexSize, mesh.range.indexCount * indexSize);
+    mesh.range.baseVertex = mesh.firstVertex;
+#endif
+    mesh.range.firstIndex = static_cast<GLuint>(nextIndex);
+    nextIndex += mesh.range.indexCount;
+  }
+
+  glDeleteBuffers(1, &m_EBO);
+  glDeleteBuffers(1, &m_VBO);
+  m_VBO = vertexBuffer;
+  m_EBO = indexBuffer;
+  m_vertexAllocator.reset(vertexCapacity, nextVertex);
+  m_indexAllocator.reset(indexCapacity, nextIndex);
+
+#if defined(__EMSCRIPTEN__)
+  // The indices are offset by the new first vertex of each mesh
+  for (const auto &mesh : m_meshes) {
+    if (mesh.used) writeIndices(mesh, mesh.indices);
+  }
+#endif
+
+  bindBuffers();
+}
+
+/**
+ * @brief Returns the range of a mesh in the buffers, to be drawn.
+ *
+ * @param mesh Handle of the mesh.
+ * @return Range of the mesh, valid until a mesh is added or removed.
+ */
+const abcg::MeshRange &abcg::GeometryBuffer::getRange(MeshID mesh) const {
+  return m_meshes.at(mesh).range;
+}
+
+/**
+ * @brief Points the per-instance attributes at an array of instance data.
+ *
+ * The vertex array object of the buffer must be bound. The attributes of
+ * instance i are read at offset + i * instanceStride, where i starts at the
+ * base instance of the draw, if any.
+ *
+ * @param buffer Buffer object with the instance data.
+ * @param offset Offset of the first instance in the buffer.
+ */
+void abcg::GeometryBuffer::bindInstances(GLuint buffer,
+                                         GLintptr offset) const {
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  for (const auto &attribute : m_instanceAttributes) {
+    glVertexAttribPointer(
+        attribute.location, attribute.size, attribute.type, GL_FALSE,
+        m_instanceStride,
+        reinterpret_cast<void *>(offset +
+                                 static_cast<GLintptr>(attribute.offset)));
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Allocates a range of elements of a buffer. If there is no free range large
+// enough, the buffer is replaced with one of at least twice the size, with
+// the same contents
+GLsizei abcg::GeometryBuffer::allocate(RangeAllocator &allocator,
+                                       GLuint &buffer, GLsizei count,
+                                       GLsizeiptr elementSize) {
+  if (const auto offset{allocator.allocate(count)}) return *offset;
+
+  const auto capacity{allocator.getCapacity()};
+  const auto newCapacity{std::max(capacity * 2, capacity + count)};
+  const auto newBuffer{createBuffer(newCapacity * elementSize)};
+  if (buffer != 0) {
+    copyBuffer(buffer, 0, newBuffer, 0, capacity * elementSize);
+    glDeleteBuffers(1, &buffer);
+  }
+  buffer = newBuffer;
+  allocator.grow(newCapacity);
+  return allocator.allocate(count).value();
+}
+
+// Writes the indices of a mesh at its range of the index buffer
+void abcg::GeometryBuffer::writeIndices(const Mesh &mesh,
+                                        std::span<const GLuint> indices) {
+  if (indices.empty()) return;
+
+  const auto offset{static_cast<GLintptr>(mesh.range.firstIndex) *
+                    static_cast<GLintptr>(sizeof(GLuint))};
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_EBO);
+#if defined(__EMSCRIPTEN__)
+  std::vector<GLuint> offsetIndices(indices.begin(), indices.end());
+  for (auto &index : offsetIndices) {
+    index += static_cast<GLuint>(mesh.firstVertex);
+  }
+  glBufferSubData(GL_COPY_WRITE_BUFFER, offset,
+                  static_cast<GLsizeiptr>(indices.size_bytes()),
+                  offsetIndices.data());
+#else
+  glBufferSubData(GL_COPY_WRITE_BUFFER, offset,
+                  static_cast<GLsizeiptr>(indices.size_bytes()),
+                  indices.data());
+#endif
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+// Points the vertex array at the current buffers, after they are replaced
+void abcg::GeometryBuffer::bindBuffers() {
+  glBindVertexArray(m_VAO);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+  glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+  for (const auto &attribute : m_vertexAttributes) {
+    glVertexAttribPointer(attribute.location, attribute.size, attribute.type,
+                          GL_FALSE, m_vertexStride,
+                          reinterpret_cast<void *>(
+                              static_cast<GLintptr>(attribute.offset)));
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+}
+
+// Makes all elements free, except the first used ones
+void abcg::GeometryBuffer::RangeAllocator::reset(GLsizei capacity,
+                                                 GLsizei used) {
+  m_free.clear();
+  m_capacity = capacity;
+  if (used < capacity) m_free.emplace(used, capacity - used);
+}
+
+// Adds free elements at the end
+void abcg::GeometryBuffer::RangeAllocator::grow(GLsizei capacity) {
+  if (capacity <= m_capacity) return;
+
+  const auto previousCapacity{std::exchange(m_capacity, capacity)};
+  free(previousCapacity, capacity - previousCapacity);
+}
+
+// Returns the offset of the smallest free range that holds count elements,
+// or nothing if there is none. The rest of the range stays free
+std::optional<GLsizei> abcg::GeometryBuffer::RangeAllocator::allocate(
+    GLsizei count) {
+  if (count <= 0) return GLsizei{};
+
+  auto best{m_free.end()};
+  for (auto it{m_free.begin()}; it != m_free.end(); ++it) {
+    if (it->second >= count &&
+        (best == m_free.end() || it->second < best->second)) {
+      best = it;
+    }
+  }
+  if (best == m_free.end()) return std::nullopt;
+
+  const auto [offset, size]{*best};
+  m_free.erase(best);
+  if (size > count) m_free.emplace(offset + count, size - count);
+  return offset;
+}
+
+// Makes a range free, merging it with the adjacent free ranges
+void abcg::GeometryBuffer::RangeAllocator::free(GLsizei offset,
+                                                GLsizei count) {
+  if (count <= 0) return;
+
+  auto next{m_free.lower_bound(offset)};
+  if (next != m_free.end() && offset + count == next->first) {
+    count += next->second;
+    next = m_free.erase(next);
+  }
+  if (next != m_free.begin()) {
+    if (auto previous{std::prev(next)};
+        previous->first + previous->second == offset) {
+      previous->second += count;
+      return;
+    }
+  }
+  m_free.emplace_hint(next, offset, count);
+}
+
+// Number of free elements that are not at the end
+GLsizei abcg::GeometryBuffer::RangeAllocator::getHoleSize() const noexcept {
+  GLsizei size{};
+  for (const auto &[offset, count] : m_free) {
+    if (offset + count != m_capacity) size += count;
+  }
+  return size;
+}
@@ -0,0 +1,180 @@
+/**
+ * @file abcg_geometrybuffer.hpp
+ * @brief abcg::GeometryBuffer header file.
+ *
+ * Declaration of abcg::GeometryBuffer class and of the vertex format and mesh
+ * range structures.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_GEOMETRYBUFFER_HPP_
+#define ABCG_GEOMETRYBUFFER_HPP_
+
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "abcg_external.hpp"
+
+namespace abcg {
+class GeometryBuffer;
+struct MeshRange;
+struct VertexAttribute;
+}  // namespace abcg
+
+/**
+ * @brief Float attribute of a vertex or instance format.
+ *
+ * Matrices take one attribute per column, at consecutive locations.
+ */
+struct abcg::VertexAttribute {
+  GLuint location{};
+  // Number of components (1 to 4)
+  GLint size{};
+  GLenum type{GL_FLOAT};
+  // Offset of the attribute in the vertex or instance structure
+  GLuint offset{};
+};
+
+/**
+ * @brief Indices of a mesh stored in an abcg::GeometryBuffer.
+ */
+struct abcg::MeshRange {
+  // Position of the first index in the index buffer
+  GLuint firstIndex{};
+  GLsizei indexCount{};
+  // Added to each index before fetching a vertex
+  GLint baseVertex{};
+};
+
+/**
+ * @brief abcg::GeometryBuffer class.
+ *
+ * Heap of vertex and index data shared by many meshes with the same vertex
+ * format, together with a single vertex array object that reads it. Each
+ * mesh takes a slice of a large vertex buffer and of a large index buffer,
+ * so that a draw of any of them needs no state change, and a whole list of
+ * draws can be submitted at once (see abcg::DrawList).
+ *
+ * Slices are sub-allocated with a best-fit free list of each buffer, whose
+ * adjacent free ranges are merged. The buffers grow as needed. Removing a
+ * mesh frees its slices, and the buffers are compacted (see defragment) when
+ * the holes left by removed meshes take more than a quarter of either
+ * buffer. Meshes are therefore addressed by a handle, and their ranges must
+ * be read again with getRange after a mesh is added or removed.
+ *
+ * Indices are 32-bit and relative to the first vertex of their mesh, which
+ * is passed to the draw as its base vertex. On OpenGL ES, which has no base
+ * vertex draws, the indices are offset when the mesh is written instead,
+ * and a copy of them is kept to write them again when the mesh is moved.
+ *
+ * Optional per-instance attributes are read from a buffer given at draw
+ * time (see bindInstances). All members except getRange must be called with
+ * the OpenGL context current.
+ */
+class abcg::GeometryBuffer {
+ public:
+  // Handle of a mesh, valid until the mesh is removed
+  using MeshID = std::size_t;
+
+  void create(GLsizei vertexStride,
+              std::span<const VertexAttribute> vertexAttributes,
+              GLsizei instanceStride = 0,
+              std::span<const VertexAttribute> instanceAttributes = {});
+  void destroy();
+
+  [[nodiscard]] MeshID add(const void* vertices, GLsizei vertexCount,
+                           std::span<const GLuint> indices);
+  template <typename T>
+  [[nodiscard]] MeshID add(std::span<const T> vertices,
+                           std::span<const GLuint> indices);
+  void remove(MeshID mesh);
+  void defragment();
+
+  [[nodiscard]] const MeshRange& getRange(MeshID mesh) const;
+  void bindInstances(GLuint buffer, GLintptr offset) const;
+
+  [[nodiscard]] GLuint getVertexArray() const noexcept { return m_VAO; }
+  [[nodiscard]] GLsizei getInstanceStride() const noexcept {
+    return m_instanceStride;
+  }
+  // Numbers of vertices and indices of the meshes in the buffers
+  [[nodiscard]] GLsizei getVertexCount() const noexcept {
+    return m_vertexCount;
+  }
+  [[nodiscard]] GLsizei getIndexCount() const noexcept { return m_indexCount; }
+
+ private:
+  // Best-fit allocator of ranges of elements of a buffer
+  class RangeAllocator {
+   public:
+    void reset(GLsizei capacity, GLsizei used = 0);
+    void grow(GLsizei capacity);
+    [[nodiscard]] std::optional<GLsizei> allocate(GLsizei count);
+    void free(GLsizei offset, GLsizei count);
+
+    [[nodiscard]] GLsizei getCapacity() const noexcept { return m_capacity; }
+    [[nodiscard]] GLsizei getHoleSize() const noexcept;
+
+   private:
+    // Size of each free range, by offset. Adjacent ranges are always merged
+    std::map<GLsizei, GLsizei> m_free;
+    GLsizei m_capacity{};
+  };
+
+  struct Mesh {
+    MeshRange range;
+    GLsizei firstVertex{};
+    GLsizei vertexCount{};
+    bool used{};
+#if defined(__EMSCRIPTEN__)
+    // Indices relative to the first vertex
+    std::vector<GLuint> indices;
+#endif
+  };
+
+  GLuint m_VAO{};
+  GLuint m_VBO{};
+  GLuint m_EBO{};
+
+  GLsizei m_vertexStride{};
+  GLsizei m_instanceStride{};
+  std::vector<VertexAttribute> m_vertexAttributes;
+  std::vector<VertexAttribute> m_instanceAttributes;
+
+  RangeAllocator m_vertexAllocator;
+  RangeAllocator m_indexAllocator;
+  GLsizei m_vertexCount{};
+  GLsizei m_indexCount{};
+
+  // Indexed by MeshID. Handles of removed meshes are reused
+  std::vector<Mesh> m_meshes;
+  std::vector<MeshID> m_freeMeshes;
+
+  GLsizei allocate(RangeAllocator& allocator, GLuint& buffer, GLsizei count,
+                   GLsizeiptr elementSize);
+  void writeIndices(const Mesh& mesh, std::span<const GLuint> indices);
+  void bindBuffers();
+};
+
+/**
+ * @brief Adds a mesh to the buffers.
+ *
+ * @tparam T Trivially copyable vertex structure, whose size is the stride
+ * given to create.
+ * @param vertices Vertices of the mesh.
+ * @param indices Indices of the mesh, relative to its first vertex.
+ * @return Handle of the mesh.
+ */
+template <typename T>
+abcg::GeometryBuffer::MeshID abcg::GeometryBuffer::add(
+    std::span<const T> vertices, std::span<const GLuint> indices) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  return add(vertices.data(), static_cast<GLsizei>(vertices.size()), indices);
+}
+
+#endif
@@ -0,0 +1,344 @@
+/**
+ * @file abcg_glcapture.cpp
+ * @brief Definition of OpenGL command capture.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_glcapture.hpp"
+
+#include <fmt/core.h>
+
+#include <atomic>
+
+#include "abcg_exception.hpp"
+
+namespace {
+constexpr std::array<char, 8> traceMagic{'A', 'B', 'C', 'G',
+                                         'T', 'R', 'C', '1'};
+
+#if defined(ABCG_GL_CAPTURE)
+abcg::opengl::CaptureWriter captureWriter;
+// Whether captureWriter is owned by a thread, which may be another one than
+// the thread that started the capture
+std::atomic<bool> captureInProgress{};
+#endif
+}  // namespace
+
+abcg::opengl::CaptureWriter::~CaptureWriter() { close(); }
+
+/**
+ * @brief Creates a trace file and writes its header.
+ *
+ * @param path Path to the trace file.
+ * @param header Context and framebuffer settings. The number of frames is
+ * the maximum number of frames to be recorded.
+ *
+ * @throw abcg::Exception if a capture is already in progress, or if the file
+ * cannot be created.
+ */
+void abcg::opengl::CaptureWriter::open(const std::filesystem::path &path,
+                                       const TraceHeader &header) {
+  close();
+  m_stream.open(path, std::ios::binary | std::ios::trunc);
+  if (!m_stream) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to create trace file {}", path.string()))};
+  }
+  m_path = path;
+  m_header = header;
+  m_framesLeft = header.frames;
+  m_header.frames = 0;
+  m_stream.write(traceMagic.data(), traceMagic.size());
+  m_stream.write(reinterpret_cast<const char *>(&m_header), sizeof(m_header));
+}
+
+/**
+ * @brief Writes the pending records and the final header, and closes the file.
+ */
+void abcg::opengl::CaptureWriter::close() {
+  if (!m_stream.is_open()) return;
+  if (!m_buffer.empty()) {
+    // Incomplete frame
+    flush();
+    ++m_header.frames;
+  }
+  m_stream.seekp(traceMagic.size());
+  m_stream.write(reinterpret_cast<const char *>(&m_header), sizeof(m_header));
+  m_stream.close();
+  fmt::print("Captured {} frames to {}\n", m_header.frames, m_path.string());
+}
+
+/**
+ * @brief Appends a payload (size followed by data) to the current record.
+ *
+ * @param data Pointer to the data. Ignored if size is zero.
+ * @param size Size of the data in bytes.
+ */
+void abcg::opengl::CaptureWriter::writePayload(const void *data,
+                                               std::size_t size) {
+  writeValue(static_cast<std::uint64_t>(size));
+  if (size == 0) return;
+  const auto *bytes{static_cast<const std::byte *>(data)};
+  m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+}
+
+/**
+ * @brief Appends a null-terminated string as a payload.
+ *
+ * @param string String to be written.
+ */
+void abcg::opengl::CaptureWriter::writeString(const char *string) {
+  writePayload(string, string == nullptr ? 0 : std::strlen(string));
+}
+
+/**
+ * @brief Appends client pixel data as a payload, with tightly packed rows.
+ *
+ * The rows are read as OpenGL reads them, following the unpack state of the
+ * current context (alignment, row length, image height and skips), so that
+ * data without row padding is not read past its end. The replay unpacks the
+ * payload with an alignment of 1. Data read from a pixel unpack buffer is
+ * not recorded.
+ *
+ * @param pixels Pointer to the pixel data, or nullptr.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param depth Depth of a 3D image, or 0 for a 2D image, which ignores the
+ * image height and skipped images.
+ * @param format Format of the pixel data.
+ * @param type Data type of the pixel data.
+ */
+void abcg::opengl::CaptureWriter::writeImage(const void *pixels,
+                                             GLsizei width, GLsizei height,
+                                             GLsizei depth, GLenum format,
+                                             GLenum type) {
+  const auto getInteger{[](GLenum pname) {
+    GLint value{};
+    ::glGetIntegerv(pname, &value);
+    return static_cast<std::size_t>(std::max(value, 0));
+  }};
+  const auto pixelSize{getPixelSize(format, type)};
+  const auto images{static_cast<std::size_t>(std::max(depth, 1))};
+  const auto rows{static_cast<std::size_t>(std::max(height, 0))};
+  const auto rowSize{static_cast<std::size_t>(std::max(width, 0)) *
+                     pixelSize};
+  if (pixels == nullptr || rowSize == 0 || rows == 0 ||
+      getInteger(GL_PIXEL_UNPACK_BUFFER_BINDING) != 0) {
+    writePayload(nullptr, 0);
+    return;
+  }
+
+  const auto alignment{std::max(getInteger(GL_UNPACK_ALIGNMENT),
+                                std::size_t{1})};
+  const auto rowLength{getInteger(GL_UNPACK_ROW_LENGTH)};
+  const auto rowPixels{rowLength > 0 ? rowLength
+                                     : static_cast<std::size_t>(width)};
+  const auto rowStride{(rowPixels * pixelSize + alignment - 1) / alignment *
+                       alignment};
+  auto offset{getInteger(GL_UNPACK_SKIP_ROWS) * rowStride +
+              getInteger(GL_UNPACK_SKIP_PIXELS) * pixelSize};
+  auto imageStride{rowStride * rows};
+  if (depth > 0) {
+    const auto imageHeight{getInteger(GL_UNPACK_IMAGE_HEIGHT)};
+    if (imageHeight > 0) imageStride = rowStride * imageHeight;
+    offset += getInteger(GL_UNPACK_SKIP_IMAGES) * imageStride;
+  }
+
+  writeValue(static_cast<std::uint64_t>(rowSize * rows * images));
+  const auto *source{static_cast<const std::byte *>(pixels) + offset};
+  for (std::size_t image{}; image < images; ++image) {
+    for (std::size_t row{}; row < rows; ++row) {
+      const auto *begin{source + image * imageStride + row * rowStride};
+      m_buffer.insert(m_buffer.end(), begin, begin + rowSize);
+    }
+  }
+}
+
+/**
+ * @brief Ends the setup section.
+ */
+void abcg::opengl::CaptureWriter::endSetup() {
+  writeValue(traceSetupEnd);
+  flush();
+}
+
+/**
+ * @brief Ends the current frame.
+ *
+ * @return True if the requested number of frames has been recorded.
+ */
+bool abcg::opengl::CaptureWriter::endFrame() {
+  writeValue(traceFrameEnd);
+  flush();
+  ++m_header.frames;
+  return --m_framesLeft <= 0;
+}
+
+void abcg::opengl::CaptureWriter::flush() {
+  m_stream.write(reinterpret_cast<const char *>(m_buffer.data()),
+                 static_cast<std::streamsize>(m_buffer.size()));
+  m_buffer.clear();
+}
+
+/**
+ * @brief Loads a trace file.
+ *
+ * @param path Path to the trace file.
+ *
+ * @throw abcg::Exception if the file cannot be read or is not a trace.
+ */
+void abcg::opengl::TraceReader::open(const std::filesystem::path &path) {
+  std::ifstream stream(path, std::ios::binary);
+  if (!stream) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to open trace file {}", path.string()))};
+  }
+  m_data.assign(std::filesystem::file_size(path), std::byte{});
+  stream.read(reinterpret_cast<char *>(m_data.data()),
+              static_cast<std::streamsize>(m_data.size()));
+  m_offset = 0;
+
+  std::array<char, traceMagic.size()> magic{};
+  readBytes(magic.data(), magic.size());
+  if (magic != traceMagic) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("{} is not an ABCg trace file", path.string()))};
+  }
+  readBytes(&m_header, sizeof(m_header));
+  m_recordsOffset = m_offset;
+}
+
+/**
+ * @brief Reads a payload of the current record.
+ *
+ * @return View of the payload data, valid while the reader exists.
+ *
+ * @throw abcg::Exception if the trace is truncated.
+ */
+std::span<const std::byte> abcg::opengl::TraceReader::readPayload() {
+  const auto size{static_cast<std::size_t>(read<std::uint64_t>())};
+  if (size > m_data.size() - m_offset) {
+    throw abcg::Exception{abcg::Exception::Runtime("Truncated trace file")};
+  }
+  std::span<const std::byte> payload{m_data.data() + m_offset, size};
+  m_offset += size;
+  return payload;
+}
+
+/**
+ * @brief Reads a string payload of the current record.
+ *
+ * @return View of the string, valid while the reader exists.
+ *
+ * @throw abcg::Exception if the trace is truncated.
+ */
+std::string_view abcg::opengl::TraceReader::readString() {
+  const auto payload{readPayload()};
+  return {reinterpret_cast<const char *>(payload.data()), payload.size()};
+}
+
+void abcg::opengl::TraceReader::readBytes(void *destination,
+                                          std::size_t size) {
+  if (size > m_data.size() - m_offset) {
+    throw abcg::Exception{abcg::Exception::Runtime("Truncated trace file")};
+  }
+  std::memcpy(destination, m_data.data() + m_offset, size);
+  m_offset += size;
+}
+
+/**
+ * @brief Starts recording the calls made through the OpenGL wrappers.
+ *
+ * Called by abcg::OpenGLWindow before initializeGL when
+ * abcg::OpenGLSettings::captureFile is set. Only the calls of the calling
+ * thread are recorded, until the capture is moved to another thread with
+ * setCurrentCapture. This is a no-op unless ABCG_GL_CAPTURE is defined.
+ *
+ * @param path Path to the trace file.
+ * @param header Context and framebuffer settings, and number of frames to be
+ * recorded.
+ *
+ * @throw abcg::Exception if the file cannot be created.
+ */
+void abcg::opengl::beginCapture(
+    [[maybe_unused]] const std::filesystem::path &path,
+    [[maybe_unused]] const TraceHeader &header) {
+#if defined(ABCG_GL_CAPTURE)
+  if (captureInProgress.exchange(true)) {
+    throw abcg::Exception{
+        abcg::Exception::Runtime("A capture is already in progress")};
+  }
+  try {
+    captureWriter.open(path, header);
+  } catch (...) {
+    captureInProgress = false;
+    throw;
+  }
+  activeCapture = &captureWriter;
+#endif
+}
+
+/**
+ * @brief Stops recording and closes the trace file.
+ *
+ * This is a no-op unless the calling thread owns the capture.
+ */
+void abcg::opengl::endCapture() {
+#if defined(ABCG_GL_CAPTURE)
+  if (activeCapture == nullptr) return;
+  activeCapture = nullptr;
+  captureWriter.close();
+  captureInProgress = false;
+#endif
+}
+
+/**
+ * @brief Makes a capture the one recorded by the calling thread.
+ *
+ * Used to move a capture to the thread that makes the OpenGL calls, such as
+ * a render thread. The previous owner must release it first by setting
+ * nullptr. This is a no-op unless ABCG_GL_CAPTURE is defined.
+ *
+ * @param capture Capture returned by getCurrentCapture on the previous owner,
+ * or nullptr to stop recording on the calling thread.
+ */
+void abcg::opengl::setCurrentCapture(
+    [[maybe_unused]] CaptureWriter *capture) {
+#if defined(ABCG_GL_CAPTURE)
+  activeCapture = capture;
+#endif
+}
+
+/**
+ * @brief Returns the capture recorded by the calling thread.
+ *
+ * @return Capture owned by the calling thread, or nullptr.
+ */
+abcg::opengl::CaptureWriter *abcg::opengl::getCurrentCapture() {
+#if defined(ABCG_GL_CAPTURE)
+  return activeCapture;
+#else
+  return nullptr;
+#endif
+}
+
+/**
+ * @brief Marks the end of the setup section of the capture in progress.
+ */
+void abcg::opengl::captureSetupEnd() {
+#if defined(ABCG_GL_CAPTURE)
+  if (activeCapture != nullptr) activeCapture->endSetup();
+#endif
+}
+
+/**
+ * @brief Marks the end of a frame of the capture in progress.
+ *
+ * The capture ends after the requested number of frames.
+ */
+void abcg::opengl::captureFrameEnd() {
+#if defined(ABCG_GL_CAPTURE)
+  if (activeCapture != nullptr && activeCapture->endFrame()) endCapture();
+#endif
+}
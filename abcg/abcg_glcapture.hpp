@@ -0,0 +1,309 @@
+/**
+ * @file abcg_glcapture.hpp
+ * @brief Declaration of OpenGL command capture.
+ *
+ * Recording of the calls made through the OpenGL function wrappers into a
+ * binary trace, and reading of such traces.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_GLCAPTURE_HPP_
+#define ABCG_GLCAPTURE_HPP_
+
+// Calls are recorded only if ABCG_GL_CAPTURE is defined (enabled with the
+// CMake option of the same name, also in release builds)
+#if defined(__EMSCRIPTEN__) || defined(__APPLE__)
+#undef ABCG_GL_CAPTURE
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "abcg_external.hpp"
+#include "abcg_openglstats.hpp"
+
+namespace abcg::opengl {
+class CaptureWriter;
+class TraceReader;
+struct TraceHeader;
+
+// Record identifiers that are not OpenGL functions
+constexpr std::uint16_t traceSetupEnd{0xFFFE};
+constexpr std::uint16_t traceFrameEnd{0xFFFF};
+
+void beginCapture(const std::filesystem::path& path, const TraceHeader& header);
+void endCapture();
+void setCurrentCapture(CaptureWriter* capture);
+[[nodiscard]] CaptureWriter* getCurrentCapture();
+void captureSetupEnd();
+void captureFrameEnd();
+}  // namespace abcg::opengl
+
+/**
+ * @brief Context and framebuffer settings of a trace.
+ */
+struct abcg::opengl::TraceHeader {
+  // abcg::OpenGLProfile as an integer
+  std::int32_t profile{};
+  std::int32_t majorVersion{};
+  std::int32_t minorVersion{};
+  std::int32_t width{};
+  std::int32_t height{};
+  // Number of frames after the setup section, including an incomplete last
+  // frame
+  std::int32_t frames{};
+};
+
+/**
+ * @brief abcg::opengl::CaptureWriter class.
+ *
+ * Writes a binary trace of OpenGL calls. A trace is a header followed by
+ * records. Each record is the identifier of the function (see
+ * abcg::opengl::GLFunction), the arguments passed to the wrapper, and then the
+ * payloads written by the wrapper (buffer and texture data, strings, object
+ * names returned by OpenGL). Pointer arguments are written as 64-bit integers.
+ *
+ * The setup section (everything up to the end of initializeGL) is followed by
+ * one section per frame. Records are buffered and written to the file at the
+ * end of each section. Traces are not portable across platforms.
+ */
+class abcg::opengl::CaptureWriter {
+ public:
+  CaptureWriter() = default;
+  ~CaptureWriter();
+
+  CaptureWriter(const CaptureWriter&) = delete;
+  CaptureWriter(CaptureWriter&&) = delete;
+  CaptureWriter& operator=(const CaptureWriter&) = delete;
+  CaptureWriter& operator=(CaptureWriter&&) = delete;
+
+  void open(const std::filesystem::path& path, const TraceHeader& header);
+  void close();
+  [[nodiscard]] bool isOpen() const noexcept { return m_stream.is_open(); }
+
+  template <typename... TArgs>
+  void writeCall(GLFunction function, const TArgs&... args);
+  template <typename T>
+  void writeValue(const T& value);
+  void writePayload(const void* data, std::size_t size);
+  void writeString(const char* string);
+  void writeImage(const void* pixels, GLsizei width, GLsizei height,
+                  GLsizei depth, GLenum format, GLenum type);
+
+  void endSetup();
+  [[nodiscard]] bool endFrame();
+
+ private:
+  std::filesystem::path m_path;
+  std::ofstream m_stream;
+  std::vector<std::byte> m_buffer;
+  TraceHeader m_header{};
+  int m_framesLeft{};
+
+  void flush();
+};
+
+/**
+ * @brief abcg::opengl::TraceReader class.
+ *
+ * Reads a trace written by abcg::opengl::CaptureWriter. The whole trace is
+ * loaded in memory so that replay is not bound by file I/O.
+ */
+class abcg::opengl::TraceReader {
+ public:
+  void open(const std::filesystem::path& path);
+
+  [[nodiscard]] const TraceHeader& getHeader() const noexcept {
+    return m_header;
+  }
+  [[nodiscard]] bool atEnd() const noexcept {
+    return m_offset >= m_data.size();
+  }
+  // Position in the trace, used to replay a range of records again
+  [[nodiscard]] std::size_t tell() const noexcept { return m_offset; }
+  void seek(std::size_t offset) noexcept {
+    m_offset = std::max(offset, m_recordsOffset);
+  }
+
+  [[nodiscard]] std::uint16_t readRecord() { return read<std::uint16_t>(); }
+  template <typename T>
+  [[nodiscard]] T read();
+  [[nodiscard]] std::span<const std::byte> readPayload();
+  [[nodiscard]] std::string_view readString();
+
+ private:
+  std::vector<std::byte> m_data;
+  std::size_t m_offset{};
+  std::size_t m_recordsOffset{};
+  TraceHeader m_header{};
+
+  void readBytes(void* destination, std::size_t size);
+};
+
+namespace abcg::opengl {
+#if defined(ABCG_GL_CAPTURE)
+// Writer of the capture recorded by the calling thread, or nullptr. Only the
+// thread that owns the capture records calls (see setCurrentCapture)
+inline thread_local CaptureWriter* activeCapture{};
+#endif
+
+/**
+ * @brief Records a call of a wrapped function, if a capture is in progress.
+ *
+ * @param function Function called.
+ * @param args Arguments passed to the wrapper.
+ */
+template <typename... TArgs>
+inline void captureCall([[maybe_unused]] GLFunction function,
+                        [[maybe_unused]] const TArgs&... args) {
+#if defined(ABCG_GL_CAPTURE)
+  if (activeCapture != nullptr) [[unlikely]]
+    activeCapture->writeCall(function, args...);
+#endif
+}
+
+/**
+ * @brief Records a value produced by the last call (e.g. an object name).
+ *
+ * @param value Value to be recorded.
+ */
+template <typename T>
+inline void captureValue([[maybe_unused]] const T& value) {
+#if defined(ABCG_GL_CAPTURE)
+  if (activeCapture != nullptr) [[unlikely]]
+    activeCapture->writeValue(value);
+#endif
+}
+
+/**
+ * @brief Records data referenced by the last call.
+ *
+ * @param data Pointer to the data, or nullptr.
+ * @param size Size of the data in bytes.
+ */
+inline void capturePayload([[maybe_unused]] const void* data,
+                           [[maybe_unused]] std::size_t size) {
+#if defined(ABCG_GL_CAPTURE)
+  if (activeCapture != nullptr) [[unlikely]]
+    activeCapture->writePayload(data, data == nullptr ? 0 : size);
+#endif
+}
+
+/**
+ * @brief Records the client pixel data read by the last texture upload.
+ *
+ * @param pixels Pointer to the pixel data, or nullptr.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param depth Depth of a 3D image, or 0 for a 2D image.
+ * @param format Format of the pixel data.
+ * @param type Data type of the pixel data.
+ */
+inline void captureImage([[maybe_unused]] const void* pixels,
+                         [[maybe_unused]] GLsizei width,
+                         [[maybe_unused]] GLsizei height,
+                         [[maybe_unused]] GLsizei depth,
+                         [[maybe_unused]] GLenum format,
+                         [[maybe_unused]] GLenum type) {
+#if defined(ABCG_GL_CAPTURE)
+  if (activeCapture != nullptr) [[unlikely]]
+    activeCapture->writeImage(pixels, width, height, depth, format, type);
+#endif
+}
+
+/**
+ * @brief Records a null-terminated string referenced by the last call.
+ *
+ * @param string String to be recorded.
+ */
+inline void captureString([[maybe_unused]] const char* string) {
+#if defined(ABCG_GL_CAPTURE)
+  if (activeCapture != nullptr) [[unlikely]]
+    activeCapture->writeString(string);
+#endif
+}
+
+/**
+ * @brief Records the shader sources passed to glShaderSource.
+ *
+ * @param count Number of strings.
+ * @param strings Array of strings.
+ * @param lengths Array of string lengths, or nullptr if null-terminated.
+ */
+inline void captureSources([[maybe_unused]] GLsizei count,
+                           [[maybe_unused]] const GLchar* const* strings,
+                           [[maybe_unused]] const GLint* lengths) {
+#if defined(ABCG_GL_CAPTURE)
+  if (activeCapture == nullptr) [[likely]]
+    return;
+  for (GLsizei index{}; index < count; ++index) {
+    const auto* source{strings[index]};
+    const auto size{lengths != nullptr && lengths[index] >= 0
+                        ? static_cast<std::size_t>(lengths[index])
+                        : std::strlen(source)};
+    activeCapture->writePayload(source, size);
+  }
+#endif
+}
+}  // namespace abcg::opengl
+
+/**
+ * @brief Appends a function call record.
+ *
+ * @param function Function identifier.
+ * @param args Arguments passed to the wrapper.
+ */
+template <typename... TArgs>
+void abcg::opengl::CaptureWriter::writeCall(GLFunction function,
+                                            const TArgs&... args) {
+  writeValue(static_cast<std::uint16_t>(function));
+  (writeValue(args), ...);
+}
+
+/**
+ * @brief Appends a value to the current record.
+ *
+ * @tparam T Arithmetic, enumeration or pointer type.
+ * @param value Value to be written. Pointers are written as their address.
+ */
+template <typename T>
+void abcg::opengl::CaptureWriter::writeValue(const T& value) {
+  if constexpr (std::is_pointer_v<T>) {
+    writeValue(static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(
+        reinterpret_cast<const void*>(value))));
+  } else {
+    static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+    std::array<std::byte, sizeof(T)> bytes{};
+    std::memcpy(bytes.data(), &value, sizeof(T));
+    m_buffer.insert(m_buffer.end(), bytes.begin(), bytes.end());
+  }
+}
+
+/**
+ * @brief Reads a value of the current record.
+ *
+ * @tparam T Type of the value as written by abcg::opengl::CaptureWriter.
+ * Pointers must be read as std::uint64_t.
+ * @return Value read.
+ *
+ * @throw abcg::Exception if the trace is truncated.
+ */
+template <typename T>
+T abcg::opengl::TraceReader::read() {
+  static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+  T value{};
+  readBytes(&value, sizeof(T));
+  return value;
+}
+
+#endif
@@ -0,0 +1,203 @@
+/**
+ * @file abcg_gpuprofiler.cpp
+ * @brief Definition of abcg::GPUProfiler and abcg::GPUScope class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_gpuprofiler.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Creates the profiler.
+ *
+ * Must be called with a current OpenGL context.
+ *
+ * @param framesInFlight Number of frames recorded before the results of a
+ * frame are read. Timings are thus available framesInFlight - 1 frames late.
+ */
+void abcg::GPUProfiler::create(int framesInFlight) {
+  destroy();
+
+  m_hasTimerQueries = false;
+#if !defined(__EMSCRIPTEN__)
+  if (GLEW_ARB_timer_query == GL_TRUE || GLEW_VERSION_3_3 == GL_TRUE) {
+    GLint counterBits{};
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counterBits);
+    m_hasTimerQueries = counterBits > 0;
+  }
+#endif
+
+  m_frames.resize(static_cast<std::size_t>(std::max(framesInFlight, 1)));
+  m_frameIndex = 0;
+}
+
+/**
+ * @brief Releases the query objects.
+ */
+void abcg::GPUProfiler::destroy() {
+  for (auto &frame : m_frames) {
+    if (!frame.queries.empty()) {
+      glDeleteQueries(static_cast<GLsizei>(frame.queries.size()),
+                      frame.queries.data());
+    }
+  }
+  m_frames.clear();
+  m_openScopes.clear();
+  m_timings.clear();
+  m_inFrame = false;
+}
+
+/**
+ * @brief Starts recording a frame.
+ *
+ * Reads the results of the frame previously recorded with the same set of
+ * queries.
+ *
+ * @param number Number that identifies the frame in getTimingsFrame().
+ */
+void abcg::GPUProfiler::beginFrame(std::uint64_t number) {
+  if (!isCreated()) return;
+
+  auto &frame{m_frames.at(m_frameIndex)};
+  if (frame.pending) collect(frame);
+  frame.number = number;
+  frame.scopes.clear();
+  m_openScopes.clear();
+  m_inFrame = true;
+}
+
+/**
+ * @brief Ends the frame being recorded.
+ *
+ * Scopes still open are closed.
+ */
+void abcg::GPUProfiler::endFrame() {
+  if (!m_inFrame) return;
+
+  while (!m_openScopes.empty()) endScope();
+  m_inFrame = false;
+
+  auto &frame{m_frames.at(m_frameIndex)};
+  if (m_hasTimerQueries) {
+    frame.pending = !frame.scopes.empty();
+  } else {
+    setTimings(frame);
+  }
+  m_frameIndex = (m_frameIndex + 1) % m_frames.size();
+}
+
+/**
+ * @brief Opens a scope.
+ *
+ * Scopes opened outside beginFrame/endFrame are ignored, as are all scopes in
+ * WebAssembly builds.
+ *
+ * @param name Name of the scope.
+ */
+void abcg::GPUProfiler::beginScope([[maybe_unused]] std::string_view name) {
+#if !defined(__EMSCRIPTEN__)
+  if (!m_inFrame) return;
+
+  auto &frame{m_frames.at(m_frameIndex)};
+  const auto index{frame.scopes.size()};
+  auto &scope{frame.scopes.emplace_back()};
+  scope.name = name;
+  scope.depth = static_cast<int>(m_openScopes.size());
+  m_openScopes.push_back(index);
+
+  if (m_hasTimerQueries) {
+    glQueryCounter(getQuery(frame, 2 * index), GL_TIMESTAMP);
+  } else {
+    scope.begin = finishAndGetTime();
+  }
+#endif
+}
+
+/**
+ * @brief Closes the innermost open scope.
+ */
+void abcg::GPUProfiler::endScope() {
+#if !defined(__EMSCRIPTEN__)
+  if (!m_inFrame || m_openScopes.empty()) return;
+
+  auto &frame{m_frames.at(m_frameIndex)};
+  const auto index{m_openScopes.back()};
+  m_openScopes.pop_back();
+
+  if (m_hasTimerQueries) {
+    frame.lastQuery = getQuery(frame, 2 * index + 1);
+    glQueryCounter(frame.lastQuery, GL_TIMESTAMP);
+  } else {
+    frame.scopes.at(index).end = finishAndGetTime();
+  }
+#endif
+}
+
+void abcg::GPUProfiler::collect(Frame &frame) {
+  frame.pending = false;
+
+#if !defined(__EMSCRIPTEN__)
+  // Queries complete in submission order, so all results are available if
+  // the last one is
+  GLint available{};
+  glGetQueryObjectiv(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+  if (available == GL_FALSE) {
+    ++m_droppedFrames;
+    return;
+  }
+
+  for (std::size_t index{}; index < frame.scopes.size(); ++index) {
+    auto &scope{frame.scopes.at(index)};
+    glGetQueryObjectui64v(frame.queries.at(2 * index), GL_QUERY_RESULT,
+                          &scope.begin);
+    glGetQueryObjectui64v(frame.queries.at(2 * index + 1), GL_QUERY_RESULT,
+                          &scope.end);
+  }
+  setTimings(frame);
+#endif
+}
+
+void abcg::GPUProfiler::setTimings(const Frame &frame) {
+  m_timings.resize(frame.scopes.size());
+  m_timingsFrame = frame.number;
+  if (frame.scopes.empty()) return;
+
+  const auto origin{frame.scopes.front().begin};
+  for (std::size_t index{}; index < frame.scopes.size(); ++index) {
+    const auto &scope{frame.scopes.at(index)};
+    auto &timing{m_timings.at(index)};
+    timing.name = scope.name;
+    timing.depth = scope.depth;
+    timing.start = static_cast<double>(scope.begin - origin) * 1e-6;
+    timing.duration =
+        static_cast<double>(std::max(scope.end, scope.begin) - scope.begin) *
+        1e-6;
+  }
+}
+
+GLuint abcg::GPUProfiler::getQuery(Frame &frame, std::size_t index) {
+  if (index >= frame.queries.size()) {
+    const auto first{frame.queries.size()};
+    frame.queries.resize(std::max(index + 1, 2 * first));
+    glGenQueries(static_cast<GLsizei>(frame.queries.size() - first),
+                 frame.queries.data() + first);
+  }
+  return frame.queries.at(index);
+}
+
+std::uint64_t abcg::GPUProfiler::finishAndGetTime() {
+  glFinish();
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          clock::now().time_since_epoch())
+          .count());
+}
+
+abcg::GPUScope::GPUScope(GPUProfiler &profiler, std::string_view name)
+    : m_profiler{profiler} {
+  m_profiler.beginScope(name);
+}
+
+abcg::GPUScope::~GPUScope() { m_profiler.endScope(); }
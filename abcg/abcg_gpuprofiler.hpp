@@ -0,0 +1,142 @@
+/**
+ * @file abcg_gpuprofiler.hpp
+ * @brief abcg::GPUProfiler header file.
+ *
+ * Declaration of abcg::GPUProfiler and abcg::GPUScope classes.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_GPUPROFILER_HPP_
+#define ABCG_GPUPROFILER_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "abcg_external.hpp"
+
+namespace abcg {
+class GPUProfiler;
+class GPUScope;
+struct GPUTiming;
+}  // namespace abcg
+
+/**
+ * @brief GPU time of a profiler scope.
+ */
+struct abcg::GPUTiming {
+  std::string name;
+  // Nesting level, 0 for top-level scopes
+  int depth{};
+  // Start time relative to the start of the first scope of the frame, in
+  // milliseconds
+  double start{};
+  // Duration in milliseconds
+  double duration{};
+};
+
+/**
+ * @brief abcg::GPUProfiler class.
+ *
+ * Measures the GPU time of named, possibly nested scopes with GL_TIMESTAMP
+ * queries. Each frame in flight has its own set of query objects, and the
+ * results of a frame are read when its set is reused, so that reading them
+ * does not stall the pipeline. Results of frames whose queries are still
+ * pending at that point are dropped.
+ *
+ * If timer queries are not available (drivers that report a zero-bit
+ * timestamp counter, as some software implementations do), scopes are timed
+ * on the CPU after a glFinish at each boundary. Results are then available
+ * right away, but the pipeline is drained at every scope. In WebAssembly
+ * builds, where WebGL has no timestamp queries and glFinish does not wait for
+ * the GPU, scopes are not timed and there are no timings.
+ */
+class abcg::GPUProfiler {
+ public:
+  void create(int framesInFlight = 4);
+  void destroy();
+
+  void beginFrame(std::uint64_t number = 0);
+  void endFrame();
+  void beginScope(std::string_view name);
+  void endScope();
+
+  [[nodiscard]] bool isCreated() const noexcept {
+    return !m_frames.empty();
+  }
+  [[nodiscard]] bool hasTimerQueries() const noexcept {
+    return m_hasTimerQueries;
+  }
+  // Timings of the last frame whose results are available
+  [[nodiscard]] const std::vector<GPUTiming>& getTimings() const noexcept {
+    return m_timings;
+  }
+  // Number passed to beginFrame for the frame of getTimings()
+  [[nodiscard]] std::uint64_t getTimingsFrame() const noexcept {
+    return m_timingsFrame;
+  }
+  [[nodiscard]] std::uint64_t getDroppedFrames() const noexcept {
+    return m_droppedFrames;
+  }
+
+ private:
+  using clock = std::chrono::steady_clock;
+
+  struct Scope {
+    std::string name;
+    int depth{};
+    // Timestamps in nanoseconds, used only without timer queries
+    std::uint64_t begin{};
+    std::uint64_t end{};
+  };
+  struct Frame {
+    std::uint64_t number{};
+    std::vector<Scope> scopes;
+    // Two timestamp queries per scope
+    std::vector<GLuint> queries;
+    // Last query issued in the frame
+    GLuint lastQuery{};
+    bool pending{};
+  };
+
+  std::vector<Frame> m_frames;
+  std::size_t m_frameIndex{};
+  bool m_inFrame{};
+  bool m_hasTimerQueries{};
+  // Indices of the open scopes of the current frame
+  std::vector<std::size_t> m_openScopes;
+
+  std::vector<GPUTiming> m_timings;
+  std::uint64_t m_timingsFrame{};
+  std::uint64_t m_droppedFrames{};
+
+  void collect(Frame& frame);
+  void setTimings(const Frame& frame);
+  [[nodiscard]] GLuint getQuery(Frame& frame, std::size_t index);
+  [[nodiscard]] static std::uint64_t finishAndGetTime();
+};
+
+/**
+ * @brief abcg::GPUScope class.
+ *
+ * Measures the GPU time of the commands issued during its lifetime.
+ */
+class abcg::GPUScope {
+ public:
+  GPUScope(GPUProfiler& profiler, std::string_view name);
+  ~GPUScope();
+
+  GPUScope(const GPUScope&) = delete;
+  GPUScope(GPUScope&&) = delete;
+  GPUScope& operator=(const GPUScope&) = delete;
+  GPUScope& operator=(GPUScope&&) = delete;
+
+ private:
+  GPUProfiler& m_profiler;
+};
+
+#endif
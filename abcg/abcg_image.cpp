@@ -17,6 +17,7 @@
 #include "SDL_image.h"
 #include "abcg_exception.hpp"
 #include "abcg_external.hpp"
+#include "abcg_openglfunctions.hpp"
 
 void flipY(gsl::not_null<SDL_Surface*> surface) {
   auto width{static_cast<size_t>(surface->w * surface->format->BytesPerPixel)};
@@ -101,6 +102,8 @@ GLuint abcg::opengl::loadTexture(std::string_view path, bool generateMipmaps) {
 
   glBindTexture(GL_TEXTURE_2D, 0);
 
+  abcg::opengl::setObjectLabel(GL_TEXTURE, textureID, path);
+
   return textureID;
 }
 
@@ -162,3 +165,92 @@ GLuint abcg::opengl::loadCubemap(std::array<std::string_view, 6> paths,
 
   return textureID;
 }
+
+/**
+ * @brief Loads a set of images into the layers of a 2D array texture.
+ *
+ * Each image is stored in the layer of same index, as RGBA. Images of a
+ * different size are scaled to the size of the layers, so that textures of
+ * several objects can be bound at once and selected per draw or per
+ * instance with the layer index.
+ *
+ * @param paths Paths to the image files, one per layer.
+ * @param width Width of the layers.
+ * @param height Height of the layers.
+ * @param generateMipmaps Whether to generate the mipmap levels.
+ * @return ID of the GL_TEXTURE_2D_ARRAY texture object.
+ *
+ * @throw abcg::Exception if an image cannot be loaded.
+ */
+GLuint abcg::opengl::loadTextureArray(std::span<const std::string> paths,
+                                      GLsizei width, GLsizei height,
+                                      bool generateMipmaps) {
+  GLuint textureID{};
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height,
+               static_cast<GLsizei>(paths.size()), 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, nullptr);
+
+  for (auto&& [layer, path] : iter::enumerate(paths)) {
+    SDL_Surface* surface{IMG_Load(path.c_str())};
+    if (surface == nullptr) {
+      glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+      glDeleteTextures(1, &textureID);
+      throw abcg::Exception{abcg::Exception::Runtime(
+          fmt::format("Failed to load texture file {}", path))};
+    }
+
+    // Enforce RGBA
+    SDL_Surface* formattedSurface{
+        SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0)};
+    SDL_FreeSurface(surface);
+
+    // Scale to the size of the layers
+    if (formattedSurface->w != width || formattedSurface->h != height) {
+      SDL_Surface* scaledSurface{SDL_CreateRGBSurfaceWithFormat(
+          0, width, height, 32, SDL_PIXELFORMAT_RGBA32)};
+      // Copy the alpha channel instead of blending
+      SDL_SetSurfaceBlendMode(formattedSurface, SDL_BLENDMODE_NONE);
+      SDL_BlitScaled(formattedSurface, nullptr, scaledSurface, nullptr);
+      SDL_FreeSurface(formattedSurface);
+      formattedSurface = scaledSurface;
+    }
+
+    // Flip horizontally
+    flipY(formattedSurface);
+
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(layer),
+                    width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                    formattedSurface->pixels);
+
+    SDL_FreeSurface(formattedSurface);
+  }
+
+  // Set texture filtering
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  // Generate the mipmap levels
+  if (generateMipmaps) {
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+    // Override minifying filtering
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                    GL_LINEAR_MIPMAP_LINEAR);
+  }
+
+  // Set texture wrapping
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  if (!paths.empty()) {
+    abcg::opengl::setObjectLabel(GL_TEXTURE, textureID,
+                                 fmt::format("{} (+{} layers)", paths.front(),
+                                             paths.size() - 1));
+  }
+
+  return textureID;
+}
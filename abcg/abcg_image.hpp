@@ -10,6 +10,8 @@
 
 #include <abcg_external.hpp>
 #include <array>
+#include <span>
+#include <string>
 #include <string_view>
 
 namespace abcg::opengl {
@@ -17,6 +19,9 @@ namespace abcg::opengl {
                                  bool generateMipmaps = true);
 [[nodiscard]] GLuint loadCubemap(std::array<std::string_view, 6> paths,
                                  bool generateMipmaps = true);
+[[nodiscard]] GLuint loadTextureArray(std::span<const std::string> paths,
+                                      GLsizei width, GLsizei height,
+                                      bool generateMipmaps = true);
 }  // namespace abcg::opengl
 
 #endif
\ No newline at end of file
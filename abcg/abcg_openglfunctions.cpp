@@ -7,10 +7,16 @@
 
 #include "abcg_openglfunctions.hpp"
 
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include "abcg_exception.hpp"
 #include "abcg_external.hpp"
 
-#if !defined(NDEBUG) && !defined(__EMSCRIPTEN__) && !defined(__APPLE__)
+#if defined(ABCG_GL_ERROR_CHECK)
 /**
  * @brief Checks OpenGL error status and throws on error with a log message.
  *
@@ -27,4 +33,237 @@ void abcg::checkGLError(
         abcg::Exception::OpenGL(prefix, status, sourceLocation)};
   }
 }
-#endif
\ No newline at end of file
+#endif
+
+/**
+ * @brief Sets the policy of the glGetError checks done by the wrappers.
+ *
+ * The policy applies to all threads, each of which samples its own calls.
+ * This is a no-op unless ABCG_GL_ERROR_CHECK is defined.
+ *
+ * @param policy Check policy.
+ * @param interval Number of calls between checks, for
+ * GLErrorCheckPolicy::EveryNthCall.
+ */
+void abcg::setGLErrorCheckPolicy([[maybe_unused]] GLErrorCheckPolicy policy,
+                                 [[maybe_unused]] unsigned int interval) {
+#if defined(ABCG_GL_ERROR_CHECK)
+  glErrorCheckState.interval.store(std::max(interval, 1U),
+                                   std::memory_order_relaxed);
+  glErrorCheckState.policy.store(policy, std::memory_order_relaxed);
+  glErrorCheckCounter = 0;
+#endif
+}
+
+/**
+ * @brief Returns the policy of the glGetError checks done by the wrappers.
+ *
+ * @return Check policy.
+ */
+abcg::GLErrorCheckPolicy abcg::getGLErrorCheckPolicy() {
+#if defined(ABCG_GL_ERROR_CHECK)
+  return glErrorCheckState.policy.load(std::memory_order_relaxed);
+#else
+  return GLErrorCheckPolicy::EveryCall;
+#endif
+}
+
+/**
+ * @brief Clears all OpenGL error flags.
+ *
+ * @return First error found, or GL_NO_ERROR.
+ */
+GLenum abcg::pollGLErrors() {
+  GLenum first{GL_NO_ERROR};
+  // glGetError returns one flag per call; bounded in case of a lost context
+  for (auto count{0}; count < 16; ++count) {
+    const auto error{::glGetError()};
+    if (error == GL_NO_ERROR) break;
+    if (first == GL_NO_ERROR) first = error;
+  }
+  return first;
+}
+
+#if defined(ABCG_GL_DEBUG_OUTPUT)
+namespace {
+// Names of the debug groups pushed by the current thread
+thread_local std::vector<std::string> debugGroups;
+// Message of the last error reported synchronously
+thread_local std::string pendingErrorMessage;
+
+// Mode of the debug output of a context, passed to the callback as its user
+// parameter since contexts of different windows may use different modes
+struct DebugOutputMode {
+  bool synchronous{};
+};
+constexpr DebugOutputMode synchronousMode{true};
+constexpr DebugOutputMode asynchronousMode{false};
+
+std::string_view debugSourceString(GLenum source) {
+  switch (source) {
+    case GL_DEBUG_SOURCE_API:
+      return "API";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM:
+      return "window system";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER:
+      return "shader compiler";
+    case GL_DEBUG_SOURCE_THIRD_PARTY:
+      return "third party";
+    case GL_DEBUG_SOURCE_APPLICATION:
+      return "application";
+    default:
+      return "other";
+  }
+}
+
+std::string_view debugTypeString(GLenum type) {
+  switch (type) {
+    case GL_DEBUG_TYPE_ERROR:
+      return "error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+      return "deprecated behavior";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+      return "undefined behavior";
+    case GL_DEBUG_TYPE_PORTABILITY:
+      return "portability";
+    case GL_DEBUG_TYPE_PERFORMANCE:
+      return "performance";
+    default:
+      return "other";
+  }
+}
+
+void GLAPIENTRY debugMessageCallback(GLenum source, GLenum type,
+                                     [[maybe_unused]] GLuint id,
+                                     GLenum severity, GLsizei length,
+                                     const GLchar *message,
+                                     const void *userParam) {
+  if (type == GL_DEBUG_TYPE_PUSH_GROUP || type == GL_DEBUG_TYPE_POP_GROUP) {
+    return;
+  }
+
+  std::string_view text{message, static_cast<std::size_t>(length)};
+  const auto *mode{static_cast<const DebugOutputMode *>(userParam)};
+  if (mode == nullptr || !mode->synchronous) {
+    // The callback may run on a driver thread, which knows neither the call
+    // site nor the debug groups of the offending call, and where a pending
+    // error would never be seen, so all messages are only logged
+    fmt::print(stderr, "OpenGL {} {}: {}\n", debugSourceString(source),
+               debugTypeString(type), text);
+    return;
+  }
+
+  // The callback runs inside the offending call, on the thread that made it
+  std::string group;
+  if (!debugGroups.empty()) {
+    group = fmt::format(" [group {}]", debugGroups.back());
+  }
+
+  if (type == GL_DEBUG_TYPE_ERROR && severity == GL_DEBUG_SEVERITY_HIGH) {
+    // Exceptions must not cross the driver, so the wrapper throws after the
+    // call returns, with its call site
+    pendingErrorMessage = fmt::format("OpenGL {} error ({}){}",
+                                      debugSourceString(source), text, group);
+    abcg::glDebugErrorPending = true;
+    return;
+  }
+
+  const auto &site{abcg::glCallSite};
+  fmt::print(stderr, "OpenGL {} {}: {} in {}:{}:{}{}\n",
+             debugSourceString(source), debugTypeString(type), text,
+             site.file_name(), site.function_name(), site.line(), group);
+}
+}  // namespace
+
+/**
+ * @brief Throws the error reported by the debug message callback.
+ *
+ * @param sourceLocation Information about the source code, used for logging.
+ *
+ * @throw abcg::Exception with a log message.
+ */
+void abcg::throwGLDebugError(
+    const std::experimental::source_location &sourceLocation) {
+  glDebugErrorPending = false;
+#if !defined(NDEBUG)
+  throw abcg::Exception{
+      abcg::Exception::Runtime(pendingErrorMessage, sourceLocation)};
+#else
+  throw abcg::Exception{abcg::Exception::Runtime(
+      fmt::format("{} in {}:{}:{}", pendingErrorMessage,
+                  sourceLocation.file_name(), sourceLocation.function_name(),
+                  sourceLocation.line()))};
+#endif
+}
+#endif
+
+/**
+ * @brief Installs a GL_KHR_debug message callback.
+ *
+ * Requires a debug context (requested by abcg::OpenGLWindow when
+ * ABCG_GL_DEBUG_OUTPUT is defined). In synchronous mode, messages are
+ * reported from within the offending call and high severity errors are thrown
+ * as exceptions with the call site, and messages are tagged with the
+ * innermost debug group. In asynchronous mode, messages, including errors,
+ * are only logged. The mode applies to the current context only. This is a
+ * no-op unless ABCG_GL_DEBUG_OUTPUT is defined.
+ *
+ * @param synchronous Whether messages are generated synchronously.
+ */
+void abcg::opengl::enableDebugOutput([[maybe_unused]] bool synchronous) {
+#if defined(ABCG_GL_DEBUG_OUTPUT)
+  if (GLEW_KHR_debug == GL_FALSE) {
+    fmt::print(stderr, "GL_KHR_debug is not available\n");
+    return;
+  }
+  glEnable(GL_DEBUG_OUTPUT);
+  if (synchronous) {
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  } else {
+    glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  }
+  glDebugMessageCallback(debugMessageCallback,
+                         synchronous ? &synchronousMode : &asynchronousMode);
+  // Ignore notifications (e.g. buffer usage hints)
+  glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE,
+                        GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+#endif
+}
+
+/**
+ * @brief Sets a label for an OpenGL object.
+ *
+ * The label is used in debug messages and by external OpenGL debuggers. This
+ * is a no-op unless ABCG_GL_DEBUG_OUTPUT is defined.
+ *
+ * @param identifier Namespace of the object (e.g. GL_TEXTURE, GL_PROGRAM).
+ * @param name Object name.
+ * @param label Label.
+ */
+void abcg::opengl::setObjectLabel([[maybe_unused]] GLenum identifier,
+                                  [[maybe_unused]] GLuint name,
+                                  [[maybe_unused]] std::string_view label) {
+#if defined(ABCG_GL_DEBUG_OUTPUT)
+  if (GLEW_KHR_debug == GL_FALSE) return;
+  glObjectLabel(identifier, name, static_cast<GLsizei>(label.size()),
+                label.data());
+#endif
+}
+
+abcg::opengl::DebugGroup::DebugGroup([[maybe_unused]] std::string_view name) {
+#if defined(ABCG_GL_DEBUG_OUTPUT)
+  if (GLEW_KHR_debug == GL_FALSE) return;
+  debugGroups.emplace_back(name);
+  glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0,
+                   static_cast<GLsizei>(name.size()), name.data());
+  m_pushed = true;
+#endif
+}
+
+abcg::opengl::DebugGroup::~DebugGroup() {
+#if defined(ABCG_GL_DEBUG_OUTPUT)
+  if (!m_pushed) return;
+  glPopDebugGroup();
+  debugGroups.pop_back();
+#endif
+}
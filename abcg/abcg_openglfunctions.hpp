@@ -3,7 +3,10 @@
  * @brief Declaration of OpenGL-related error checking functions.
  *
  * Error checking wrappers for OpenGL functions are defined here as inline
- * functions.
+ * functions, together with GL_KHR_debug helpers. The wrappers also collect
+ * the statistics declared in abcg_openglstats.hpp, record the calls
+ * captured by abcg_glcapture.hpp, and skip the redundant state changes found
+ * by the cache declared in abcg_openglstate.hpp.
  *
  * This project is released under the MIT License.
  */
@@ -11,325 +14,830 @@
 #ifndef ABCG_OPENGLFUNCTIONS_HPP_
 #define ABCG_OPENGLFUNCTIONS_HPP_
 
-#if !defined(NDEBUG) && !defined(__EMSCRIPTEN__) && !defined(__APPLE__)
+// Error reporting mode of the wrappers:
+// - ABCG_GL_ERROR_CHECK: glGetError before and after each call (debug builds);
+// - ABCG_GL_DEBUG_OUTPUT: GL_KHR_debug message callback, without glGetError
+//   (enabled with the CMake option of the same name, also in release builds);
+// - Neither: GL functions are called directly, unless ABCG_GL_STATS,
+//   ABCG_GL_CAPTURE or ABCG_GL_STATE_CACHE is defined, in which case the
+//   wrappers only collect statistics, record calls or filter redundant state
+//   changes.
+// Without wrappers, abcg::glX names the OpenGL function itself.
+#if !defined(__EMSCRIPTEN__) && !defined(__APPLE__)
+#if !defined(ABCG_GL_DEBUG_OUTPUT) && !defined(NDEBUG)
+#define ABCG_GL_ERROR_CHECK
+#endif
+#if defined(ABCG_GL_ERROR_CHECK) || defined(ABCG_GL_DEBUG_OUTPUT) || \
+    defined(ABCG_GL_STATS) || defined(ABCG_GL_CAPTURE) ||                 \
+    defined(ABCG_GL_STATE_CACHE)
+#define ABCG_GL_WRAPPERS
+#endif
+#else
+#undef ABCG_GL_DEBUG_OUTPUT
+#endif
+
+#if defined(ABCG_GL_WRAPPERS)
+#include <atomic>
 #include <experimental/source_location>
 #endif
 
 #include <string_view>
+#include <type_traits>
 
 #include "abcg_external.hpp"
+#include "abcg_glcapture.hpp"
+#include "abcg_openglstate.hpp"
+#include "abcg_openglstats.hpp"
+
+namespace abcg {
+/**
+ * @brief Policy of the glGetError checks done by the wrappers.
+ *
+ * - EveryCall: check before and after each wrapped call;
+ * - EveryNthCall: check after one in every N wrapped calls, and at the end of
+ *   each frame;
+ * - EveryFrame: check only at the end of each frame, in
+ *   abcg::OpenGLWindow::paint;
+ * - Bisect: as EveryFrame, but when an error is found the frame is painted
+ *   again with checks on every call to find the offending call site.
+ *
+ * Used only if ABCG_GL_ERROR_CHECK is defined (debug builds).
+ */
+enum class GLErrorCheckPolicy { EveryCall, EveryNthCall, EveryFrame, Bisect };
+
+void setGLErrorCheckPolicy(GLErrorCheckPolicy policy,
+                           unsigned int interval = 64);
+[[nodiscard]] GLErrorCheckPolicy getGLErrorCheckPolicy();
+[[nodiscard]] GLenum pollGLErrors();
+}  // namespace abcg
+
+namespace abcg::opengl {
+class DebugGroup;
+
+void enableDebugOutput(bool synchronous);
+void setObjectLabel(GLenum identifier, GLuint name, std::string_view label);
+}  // namespace abcg::opengl
+
+/**
+ * @brief RAII scope that names a group of OpenGL commands.
+ *
+ * Pushes a GL_KHR_debug debug group on construction and pops it on
+ * destruction. Debug messages are tagged with the name of the innermost group,
+ * and the groups are shown by external OpenGL debuggers. This is a no-op
+ * unless ABCG_GL_DEBUG_OUTPUT is defined.
+ */
+class abcg::opengl::DebugGroup {
+ public:
+  explicit DebugGroup(std::string_view name);
+  ~DebugGroup();
+
+  DebugGroup(const DebugGroup&) = delete;
+  DebugGroup(DebugGroup&&) = delete;
+  DebugGroup& operator=(const DebugGroup&) = delete;
+  DebugGroup& operator=(DebugGroup&&) = delete;
+
+#if defined(ABCG_GL_DEBUG_OUTPUT)
+ private:
+  bool m_pushed{};
+#endif
+};
 
 namespace abcg {
-#if !defined(NDEBUG) && !defined(__EMSCRIPTEN__) && !defined(__APPLE__)
+#if defined(ABCG_GL_WRAPPERS)
+#if defined(ABCG_GL_ERROR_CHECK)
 void checkGLError(const std::experimental::source_location& sourceLocation,
                   std::string_view prefix);
 
+// Policy shared by all threads, read with relaxed ordering since it only
+// selects how often to check
+struct GLErrorCheckState {
+  std::atomic<GLErrorCheckPolicy> policy{GLErrorCheckPolicy::EveryCall};
+  std::atomic<unsigned int> interval{64};
+};
+inline GLErrorCheckState glErrorCheckState{};
+// Wrapped calls made by the current thread, for sampled checks
+inline thread_local unsigned int glErrorCheckCounter{};
+
 /**
- * @brief Check for OpenGL errors before and after a function call.
+ * @brief Returns whether the current wrapped call must be checked.
+ *
+ * @return True if glGetError must be called around the current call.
+ */
+inline bool shouldCheckGLError() {
+  const auto& state{glErrorCheckState};
+  switch (state.policy.load(std::memory_order_relaxed)) {
+    case GLErrorCheckPolicy::EveryCall:
+      return true;
+    case GLErrorCheckPolicy::EveryNthCall:
+      return ++glErrorCheckCounter %
+                 state.interval.load(std::memory_order_relaxed) ==
+             0;
+    default:
+      return false;
+  }
+}
+#endif
+
+#if defined(ABCG_GL_DEBUG_OUTPUT)
+// Call site of the OpenGL function being executed by the current thread,
+// reported by the debug message callback
+inline thread_local std::experimental::source_location glCallSite{};
+// Set by the debug message callback when an error is reported synchronously
+inline thread_local bool glDebugErrorPending{};
+
+[[noreturn]] void throwGLDebugError(
+    const std::experimental::source_location& sourceLocation);
+#endif
+
+using GLFunction = opengl::GLFunction;
+
+/**
+ * @brief Calls an OpenGL function and reports errors.
+ *
+ * With ABCG_GL_ERROR_CHECK, checks for OpenGL errors before and after the
+ * function call, as set by abcg::setGLErrorCheckPolicy. With
+ * ABCG_GL_DEBUG_OUTPUT, records the call site for the debug message callback
+ * and throws if the callback reported an error during the call. With
+ * ABCG_GL_STATS, counts the call in the statistics of the current frame. With
+ * ABCG_GL_CAPTURE, records the call and its arguments if a capture is in
+ * progress.
  *
  * @tparam TFun Function typename.
  * @tparam TArgs Variadic arguments typename.
  * @param sourceLocation Information about the source code, used for logging.
+ * @param id Identifier of the function, used for statistics.
  * @param function Function to be called.
  * @param args Variadic template arguments for the function.
  * @return Value returned from function, or void.
  */
 template <typename TFun, typename... TArgs>
-auto callGL(const std::experimental::source_location& sourceLocation,
-            TFun&& function, TArgs&&... args) {
-  checkGLError(sourceLocation, "BEFORE function call");
+auto callGL([[maybe_unused]] const std::experimental::source_location&
+                sourceLocation,
+            GLFunction id, TFun&& function, TArgs&&... args) {
+  opengl::recordCall(id);
+  opengl::captureCall(id, args...);
+#if defined(ABCG_GL_ERROR_CHECK)
+  // Sampled checks only look after the call, since an error found before it
+  // may come from any call since the previous sample
+  const bool check{shouldCheckGLError()};
+  const bool everyCall{
+      glErrorCheckState.policy.load(std::memory_order_relaxed) ==
+      GLErrorCheckPolicy::EveryCall};
+  if (everyCall) checkGLError(sourceLocation, "BEFORE function call");
+  if constexpr (!std::is_void<
+                    typename std::result_of<TFun(TArgs...)>::type>::value) {
+    // Specialization for functions that do not return void
+    auto&& res = std::forward<TFun>(function)(std::forward<TArgs>(args)...);
+    if (check) {
+      checkGLError(sourceLocation, everyCall ? "AFTER function call"
+                                             : "AT OR BEFORE function call");
+    }
+    return res;
+  }
+  // Specialization for functions that return void
+  std::forward<TFun>(function)(std::forward<TArgs>(args)...);
+  if (check) {
+    checkGLError(sourceLocation, everyCall ? "AFTER function call"
+                                           : "AT OR BEFORE function call");
+  }
+#elif defined(ABCG_GL_DEBUG_OUTPUT)
+  glCallSite = sourceLocation;
   if constexpr (!std::is_void<
                     typename std::result_of<TFun(TArgs...)>::type>::value) {
     // Specialization for functions that do not return void
     auto&& res = std::forward<TFun>(function)(std::forward<TArgs>(args)...);
-    checkGLError(sourceLocation, "AFTER function call");
+    if (glDebugErrorPending) [[unlikely]]
+      throwGLDebugError(sourceLocation);
     return res;
   }
   // Specialization for functions that return void
   std::forward<TFun>(function)(std::forward<TArgs>(args)...);
-  checkGLError(sourceLocation, "AFTER function call");
+  if (glDebugErrorPending) [[unlikely]]
+    throwGLDebugError(sourceLocation);
+#else
+  return std::forward<TFun>(function)(std::forward<TArgs>(args)...);
+#endif
 }
 
 using sl = std::experimental::source_location;
 
 inline void glActiveTexture(GLenum texture,
                             const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glActiveTexture, texture);
+  if (opengl::isRedundant(GLFunction::ActiveTexture,
+                          &opengl::StateCache::activeTexture, texture)) {
+    return;
+  }
+  callGL(sourceLocation, GLFunction::ActiveTexture, ::glActiveTexture, texture);
 }
 inline void glAttachShader(GLuint program, GLuint shader,
                            const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glAttachShader, program, shader);
+  callGL(sourceLocation, GLFunction::AttachShader, ::glAttachShader, program,
+         shader);
 }
 inline void glBindBuffer(GLenum target, GLuint buffer,
                          const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glBindBuffer, target, buffer);
+  if (opengl::isRedundant(GLFunction::BindBuffer,
+                          &opengl::StateCache::bindBuffer, target, buffer)) {
+    return;
+  }
+  callGL(sourceLocation, GLFunction::BindBuffer, ::glBindBuffer, target,
+         buffer);
 }
 inline void glBindBufferBase(GLenum target, GLuint index, GLuint buffer,
                              const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glBindBufferBase, target, index, buffer);
+  callGL(sourceLocation, GLFunction::BindBufferBase, ::glBindBufferBase, target,
+         index, buffer);
+  opengl::updateStateCache(&opengl::StateCache::bindBufferBase, target, buffer);
+}
+inline void glBindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                              GLintptr offset, GLsizeiptr size,
+                              const sl& sourceLocation = sl::current()) {
+  callGL(sourceLocation, GLFunction::BindBufferRange, ::glBindBufferRange,
+         target, index, buffer, offset, size);
+  opengl::updateStateCache(&opengl::StateCache::bindBufferBase, target, buffer);
 }
 inline void glBindFragDataLocation(GLuint program, GLuint colorNumber,
                                    const char* name,
                                    const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glBindFragDataLocation, program, colorNumber, name);
+  callGL(sourceLocation, GLFunction::BindFragDataLocation,
+         ::glBindFragDataLocation, program, colorNumber, name);
+  opengl::captureString(name);
 }
 inline void glBindFramebuffer(GLenum target, GLuint framebuffer,
                               const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glBindFramebuffer, target, framebuffer);
+  callGL(sourceLocation, GLFunction::BindFramebuffer, ::glBindFramebuffer,
+         target, framebuffer);
 }
 inline void glBindRenderbuffer(GLenum target, GLuint renderbuffer,
                                const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glBindRenderbuffer, target, renderbuffer);
+  callGL(sourceLocation, GLFunction::BindRenderbuffer, ::glBindRenderbuffer,
+         target, renderbuffer);
+}
+inline void glBindSampler(GLuint unit, GLuint sampler,
+                          const sl& sourceLocation = sl::current()) {
+  if (opengl::isRedundant(GLFunction::BindSampler,
+                          &opengl::StateCache::bindSampler, unit, sampler)) {
+    return;
+  }
+  callGL(sourceLocation, GLFunction::BindSampler, ::glBindSampler, unit,
+         sampler);
 }
 inline void glBindTexture(GLenum target, GLuint texture,
                           const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glBindTexture, target, texture);
+  if (opengl::isRedundant(GLFunction::BindTexture,
+                          &opengl::StateCache::bindTexture, target, texture)) {
+    return;
+  }
+  callGL(sourceLocation, GLFunction::BindTexture, ::glBindTexture, target,
+         texture);
 }
 inline void glBindVertexArray(GLuint array,
                               const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glBindVertexArray, array);
+  if (opengl::isRedundant(GLFunction::BindVertexArray,
+                          &opengl::StateCache::bindVertexArray, array)) {
+    return;
+  }
+  callGL(sourceLocation, GLFunction::BindVertexArray, ::glBindVertexArray,
+         array);
 }
 inline void glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1,
                               GLint srcY1, GLint dstX0, GLint dstY0,
                               GLint dstX1, GLint dstY1, GLbitfield mask,
                               GLenum filter,
                               const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glBlitFramebuffer, srcX0, srcY0, srcX1, srcY1, dstX0,
-         dstY0, dstX1, dstY1, mask, filter);
+  callGL(sourceLocation, GLFunction::BlitFramebuffer, ::glBlitFramebuffer,
+         srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
 }
 inline void glBufferData(GLenum target, GLsizeiptr size, const void* data,
                          GLenum usage,
                          const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glBufferData, target, size, data, usage);
+  opengl::recordBufferUpload(size, data);
+  callGL(sourceLocation, GLFunction::BufferData, ::glBufferData, target, size,
+         data, usage);
+  opengl::capturePayload(data, static_cast<std::size_t>(size));
+}
+inline void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size,
+                            const void* data,
+                            const sl& sourceLocation = sl::current()) {
+  opengl::recordBufferUpload(size, data);
+  callGL(sourceLocation, GLFunction::BufferSubData, ::glBufferSubData, target,
+         offset, size, data);
+  opengl::capturePayload(data, static_cast<std::size_t>(size));
 }
 inline void glClear(GLbitfield mask, const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glClear, mask);
+  callGL(sourceLocation, GLFunction::Clear, ::glClear, mask);
 }
 inline void glClearColor(GLclampf red, GLclampf green, GLclampf blue,
                          GLclampf alpha,
                          const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glClearColor, red, green, blue, alpha);
+  callGL(sourceLocation, GLFunction::ClearColor, ::glClearColor, red, green,
+         blue, alpha);
 }
 inline GLuint glCreateProgram(const sl& sourceLocation = sl::current()) {
-  return callGL(sourceLocation, ::glCreateProgram);
+  const auto program{
+      callGL(sourceLocation, GLFunction::CreateProgram, ::glCreateProgram)};
+  opengl::captureValue(program);
+  return program;
 }
 inline GLuint glCreateShader(GLenum shaderType,
                              const sl& sourceLocation = sl::current()) {
-  return callGL(sourceLocation, ::glCreateShader, shaderType);
+  const auto shader{callGL(sourceLocation, GLFunction::CreateShader,
+                           ::glCreateShader, shaderType)};
+  opengl::captureValue(shader);
+  return shader;
 }
 inline GLenum glCheckFramebufferStatus(
     GLenum target, const sl& sourceLocation = sl::current()) {
-  return callGL(sourceLocation, ::glCheckFramebufferStatus, target);
+  return callGL(sourceLocation, GLFunction::CheckFramebufferStatus,
+                ::glCheckFramebufferStatus, target);
 }
 inline void glCompileShader(GLuint shader,
                             const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glCompileShader, shader);
+  callGL(sourceLocation, GLFunction::CompileShader, ::glCompileShader, shader);
+}
+inline void glCopyBufferSubData(GLenum readTarget, GLenum writeTarget,
+                                GLintptr readOffset, GLintptr writeOffset,
+                                GLsizeiptr size,
+                                const sl& sourceLocation = sl::current()) {
+  callGL(sourceLocation, GLFunction::CopyBufferSubData, ::glCopyBufferSubData,
+         readTarget, writeTarget, readOffset, writeOffset, size);
 }
 inline void glDeleteBuffers(GLsizei n, const GLuint* buffers,
                             const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glDeleteBuffers, n, buffers);
+  callGL(sourceLocation, GLFunction::DeleteBuffers, ::glDeleteBuffers, n,
+         buffers);
+  opengl::forgetObjects(&opengl::StateCache::deleteBuffers, n, buffers);
+  opengl::capturePayload(buffers, static_cast<std::size_t>(n) * sizeof(GLuint));
 }
 inline void glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers,
                                  const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glDeleteFramebuffers, n, framebuffers);
+  callGL(sourceLocation, GLFunction::DeleteFramebuffers, ::glDeleteFramebuffers,
+         n, framebuffers);
+  opengl::capturePayload(framebuffers,
+                         static_cast<std::size_t>(n) * sizeof(GLuint));
 }
 inline void glDeleteProgram(GLuint program,
                             const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glDeleteProgram, program);
+  callGL(sourceLocation, GLFunction::DeleteProgram, ::glDeleteProgram, program);
 }
 inline void glDeleteRenderbuffers(GLsizei n, GLuint* renderbuffers,
                                   const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glDeleteRenderbuffers, n, renderbuffers);
+  callGL(sourceLocation, GLFunction::DeleteRenderbuffers,
+         ::glDeleteRenderbuffers, n, renderbuffers);
+  opengl::capturePayload(renderbuffers,
+                         static_cast<std::size_t>(n) * sizeof(GLuint));
+}
+inline void glDeleteSamplers(GLsizei n, const GLuint* samplers,
+                             const sl& sourceLocation = sl::current()) {
+  callGL(sourceLocation, GLFunction::DeleteSamplers, ::glDeleteSamplers, n,
+         samplers);
+  opengl::forgetObjects(&opengl::StateCache::deleteSamplers, n, samplers);
+  opengl::capturePayload(samplers,
+                         static_cast<std::size_t>(n) * sizeof(GLuint));
 }
 inline void glDeleteShader(GLuint shader,
                            const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glDeleteShader, shader);
+  callGL(sourceLocation, GLFunction::DeleteShader, ::glDeleteShader, shader);
 }
 inline void glDeleteTextures(GLsizei n, const GLuint* textures,
                              const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glDeleteTextures, n, textures);
+  callGL(sourceLocation, GLFunction::DeleteTextures, ::glDeleteTextures, n,
+         textures);
+  opengl::forgetObjects(&opengl::StateCache::deleteTextures, n, textures);
+  opengl::capturePayload(textures,
+                         static_cast<std::size_t>(n) * sizeof(GLuint));
 }
 inline void glDeleteVertexArrays(GLsizei n, const GLuint* arrays,
                                  const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glDeleteVertexArrays, n, arrays);
+  callGL(sourceLocation, GLFunction::DeleteVertexArrays, ::glDeleteVertexArrays,
+         n, arrays);
+  opengl::forgetObjects(&opengl::StateCache::deleteVertexArrays, n, arrays);
+  opengl::capturePayload(arrays, static_cast<std::size_t>(n) * sizeof(GLuint));
+}
+inline void glDisable(GLenum cap, const sl& sourceLocation = sl::current()) {
+  if (opengl::isRedundant(GLFunction::Disable, &opengl::StateCache::enable, cap,
+                          false)) {
+    return;
+  }
+  callGL(sourceLocation, GLFunction::Disable, ::glDisable, cap);
 }
 inline void glDrawBuffers(GLsizei n, const GLenum* bufs,
                           const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glDrawBuffers, n, bufs);
+  callGL(sourceLocation, GLFunction::DrawBuffers, ::glDrawBuffers, n, bufs);
+  opengl::capturePayload(bufs, static_cast<std::size_t>(n) * sizeof(GLenum));
 }
 inline void glDrawElements(GLenum mode, GLsizei count, GLenum type,
                            const void* indices,
                            const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glDrawElements, mode, count, type, indices);
+  opengl::recordDraw(mode, count);
+  callGL(sourceLocation, GLFunction::DrawElements, ::glDrawElements, mode,
+         count, type, indices);
+}
+inline void glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type,
+                                    const void* indices, GLsizei instancecount,
+                                    const sl& sourceLocation = sl::current()) {
+  opengl::recordDraw(mode, count, instancecount);
+  callGL(sourceLocation, GLFunction::DrawElementsInstanced,
+         ::glDrawElementsInstanced, mode, count, type, indices, instancecount);
+}
+inline void glDrawElementsInstancedBaseVertex(
+    GLenum mode, GLsizei count, GLenum type, const void* indices,
+    GLsizei instancecount, GLint basevertex,
+    const sl& sourceLocation = sl::current()) {
+  opengl::recordDraw(mode, count, instancecount);
+  callGL(sourceLocation, GLFunction::DrawElementsInstancedBaseVertex,
+         ::glDrawElementsInstancedBaseVertex, mode, count, type, indices,
+         instancecount, basevertex);
 }
 inline void glDrawArrays(GLenum mode, GLint first, GLsizei count,
                          const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glDrawArrays, mode, first, count);
+  opengl::recordDraw(mode, count);
+  callGL(sourceLocation, GLFunction::DrawArrays, ::glDrawArrays, mode, first,
+         count);
 }
 inline void glEnable(GLenum cap, const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glEnable, cap);
+  if (opengl::isRedundant(GLFunction::Enable, &opengl::StateCache::enable, cap,
+                          true)) {
+    return;
+  }
+  callGL(sourceLocation, GLFunction::Enable, ::glEnable, cap);
 }
 inline void glEnableVertexAttribArray(
     GLuint index, const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glEnableVertexAttribArray, index);
+  callGL(sourceLocation, GLFunction::EnableVertexAttribArray,
+         ::glEnableVertexAttribArray, index);
 }
 inline void glFramebufferRenderbuffer(
     GLenum target, GLenum attachment, GLenum renderbuffertarget,
     GLuint renderbuffer, const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glFramebufferRenderbuffer, target, attachment,
-         renderbuffertarget, renderbuffer);
+  callGL(sourceLocation, GLFunction::FramebufferRenderbuffer,
+         ::glFramebufferRenderbuffer, target, attachment, renderbuffertarget,
+         renderbuffer);
 }
 inline void glFramebufferTexture(GLenum target, GLenum attachment,
                                  GLuint texture, GLint level,
                                  const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glFramebufferTexture, target, attachment, texture,
-         level);
+  callGL(sourceLocation, GLFunction::FramebufferTexture, ::glFramebufferTexture,
+         target, attachment, texture, level);
 }
 inline void glGenerateMipmap(GLenum target,
                              const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glGenerateMipmap, target);
+  callGL(sourceLocation, GLFunction::GenerateMipmap, ::glGenerateMipmap,
+         target);
 }
 inline void glGenBuffers(GLsizei n, GLuint* buffers,
                          const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glGenBuffers, n, buffers);
+  callGL(sourceLocation, GLFunction::GenBuffers, ::glGenBuffers, n, buffers);
+  opengl::capturePayload(buffers, static_cast<std::size_t>(n) * sizeof(GLuint));
 }
 inline void glGenFramebuffers(GLsizei n, GLuint* ids,
                               const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glGenFramebuffers, n, ids);
+  callGL(sourceLocation, GLFunction::GenFramebuffers, ::glGenFramebuffers, n,
+         ids);
+  opengl::capturePayload(ids, static_cast<std::size_t>(n) * sizeof(GLuint));
 }
 inline void glGenRenderbuffers(GLsizei n, GLuint* renderbuffers,
                                const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glGenRenderbuffers, n, renderbuffers);
+  callGL(sourceLocation, GLFunction::GenRenderbuffers, ::glGenRenderbuffers, n,
+         renderbuffers);
+  opengl::capturePayload(renderbuffers,
+                         static_cast<std::size_t>(n) * sizeof(GLuint));
+}
+inline void glGenSamplers(GLsizei n, GLuint* samplers,
+                          const sl& sourceLocation = sl::current()) {
+  callGL(sourceLocation, GLFunction::GenSamplers, ::glGenSamplers, n, samplers);
+  opengl::capturePayload(samplers,
+                         static_cast<std::size_t>(n) * sizeof(GLuint));
 }
 inline void glGenTextures(GLsizei n, GLuint* textures,
                           const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glGenTextures, n, textures);
+  callGL(sourceLocation, GLFunction::GenTextures, ::glGenTextures, n, textures);
+  opengl::capturePayload(textures,
+                         static_cast<std::size_t>(n) * sizeof(GLuint));
 }
 inline void glGenVertexArrays(GLsizei n, GLuint* arrays,
                               const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glGenVertexArrays, n, arrays);
+  callGL(sourceLocation, GLFunction::GenVertexArrays, ::glGenVertexArrays, n,
+         arrays);
+  opengl::capturePayload(arrays, static_cast<std::size_t>(n) * sizeof(GLuint));
+}
+inline void glGetActiveUniformBlockiv(
+    GLuint program, GLuint uniformBlockIndex, GLenum pname, GLint* params,
+    const sl& sourceLocation = sl::current()) {
+  callGL(sourceLocation, GLFunction::GetActiveUniformBlockiv,
+         ::glGetActiveUniformBlockiv, program, uniformBlockIndex, pname,
+         params);
 }
 inline GLint glGetAttribLocation(GLuint program, const GLchar* name,
                                  const sl& sourceLocation = sl::current()) {
-  return callGL(sourceLocation, ::glGetAttribLocation, program, name);
+  const auto location{callGL(sourceLocation, GLFunction::GetAttribLocation,
+                             ::glGetAttribLocation, program, name)};
+  opengl::captureString(name);
+  opengl::captureValue(location);
+  return location;
 }
 inline void glGetBooleanv(GLenum pname, GLboolean* params,
                           const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glGetBooleanv, pname, params);
+  callGL(sourceLocation, GLFunction::GetBooleanv, ::glGetBooleanv, pname,
+         params);
 }
 inline void glGetDoublev(GLenum pname, GLdouble* params,
                          const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glGetDoublev, pname, params);
+  callGL(sourceLocation, GLFunction::GetDoublev, ::glGetDoublev, pname, params);
 }
 inline void glGetFloatv(GLenum pname, GLfloat* params,
                         const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glGetFloatv, pname, params);
+  callGL(sourceLocation, GLFunction::GetFloatv, ::glGetFloatv, pname, params);
 }
 inline void glGetIntegerv(GLenum pname, GLint* params,
                           const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glGetIntegerv, pname, params);
+  callGL(sourceLocation, GLFunction::GetIntegerv, ::glGetIntegerv, pname,
+         params);
 }
 inline void glGetShaderiv(GLuint shader, GLenum pname, GLint* params,
                           const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glGetShaderiv, shader, pname, params);
+  callGL(sourceLocation, GLFunction::GetShaderiv, ::glGetShaderiv, shader,
+         pname, params);
 }
 inline const GLubyte* glGetString(GLenum name,
                                   const sl& sourceLocation = sl::current()) {
-  return callGL(sourceLocation, ::glGetString, name);
+  return callGL(sourceLocation, GLFunction::GetString, ::glGetString, name);
 }
 inline void glGetProgramiv(GLuint program, GLenum pname, GLint* params,
                            const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glGetProgramiv, program, pname, params);
+  callGL(sourceLocation, GLFunction::GetProgramiv, ::glGetProgramiv, program,
+         pname, params);
 }
 inline GLuint glGetUniformBlockIndex(GLuint program,
                                      const GLchar* uniformBlockName,
                                      const sl& sourceLocation = sl::current()) {
-  return callGL(sourceLocation, ::glGetUniformBlockIndex, program,
-                uniformBlockName);
+  const auto index{callGL(sourceLocation, GLFunction::GetUniformBlockIndex,
+                          ::glGetUniformBlockIndex, program, uniformBlockName)};
+  opengl::captureString(uniformBlockName);
+  opengl::captureValue(index);
+  return index;
 }
 inline GLint glGetUniformLocation(GLuint program, const GLchar* name,
                                   const sl& sourceLocation = sl::current()) {
-  return callGL(sourceLocation, ::glGetUniformLocation, program, name);
+  const auto location{callGL(sourceLocation, GLFunction::GetUniformLocation,
+                             ::glGetUniformLocation, program, name)};
+  opengl::captureString(name);
+  opengl::captureValue(location);
+  return location;
 }
 inline void glLinkProgram(GLuint program,
                           const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glLinkProgram, program);
+  callGL(sourceLocation, GLFunction::LinkProgram, ::glLinkProgram, program);
+}
+inline void glMultiDrawElementsIndirect(
+    GLenum mode, GLenum type, const void* indirect, GLsizei drawcount,
+    GLsizei stride, const sl& sourceLocation = sl::current()) {
+  // The draw commands are read from a buffer object, so their triangles are
+  // counted by the caller (see abcg::opengl::recordPrimitives)
+  opengl::recordDraw(mode, 0);
+  callGL(sourceLocation, GLFunction::MultiDrawElementsIndirect,
+         ::glMultiDrawElementsIndirect, mode, type, indirect, drawcount,
+         stride);
 }
 inline void glRenderbufferStorage(GLenum target, GLenum internalformat,
                                   GLsizei width, GLsizei height,
                                   const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glRenderbufferStorage, target, internalformat, width,
-         height);
+  callGL(sourceLocation, GLFunction::RenderbufferStorage,
+         ::glRenderbufferStorage, target, internalformat, width, height);
+}
+inline void glSamplerParameterf(GLuint sampler, GLenum pname, GLfloat param,
+                                const sl& sourceLocation = sl::current()) {
+  callGL(sourceLocation, GLFunction::SamplerParameterf, ::glSamplerParameterf,
+         sampler, pname, param);
+}
+inline void glSamplerParameteri(GLuint sampler, GLenum pname, GLint param,
+                                const sl& sourceLocation = sl::current()) {
+  callGL(sourceLocation, GLFunction::SamplerParameteri, ::glSamplerParameteri,
+         sampler, pname, param);
 }
 inline void glShaderSource(GLuint shader, GLsizei count, const GLchar** string,
                            const GLint* length,
                            const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glShaderSource, shader, count, string, length);
+  callGL(sourceLocation, GLFunction::ShaderSource, ::glShaderSource, shader,
+         count, string, length);
+  opengl::captureSources(count, string, length);
 }
 inline void glTexImage2D(GLenum target, GLint level, GLint internalformat,
                          GLsizei width, GLsizei height, GLint border,
                          GLenum format, GLenum type, const void* data,
                          const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glTexImage2D, target, level, internalformat, width,
-         height, border, format, type, data);
+  if (data != nullptr) {
+    opengl::recordTextureUpload(width, height, format, type);
+  }
+  callGL(sourceLocation, GLFunction::TexImage2D, ::glTexImage2D, target, level,
+         internalformat, width, height, border, format, type, data);
+  opengl::captureImage(data, width, height, 0, format, type);
 }
 inline void glTexImage2DMultisample(GLenum target, GLsizei samples,
                                     GLenum internalformat, GLsizei width,
                                     GLsizei height,
                                     GLboolean fixedsamplelocations,
                                     const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glTexImage2DMultisample, target, samples,
-         internalformat, width, height, fixedsamplelocations);
+  callGL(sourceLocation, GLFunction::TexImage2DMultisample,
+         ::glTexImage2DMultisample, target, samples, internalformat, width,
+         height, fixedsamplelocations);
+}
+inline void glTexImage3D(GLenum target, GLint level, GLint internalformat,
+                         GLsizei width, GLsizei height, GLsizei depth,
+                         GLint border, GLenum format, GLenum type,
+                         const void* data,
+                         const sl& sourceLocation = sl::current()) {
+  if (data != nullptr) {
+    opengl::recordTextureUpload(width, height * depth, format, type);
+  }
+  callGL(sourceLocation, GLFunction::TexImage3D, ::glTexImage3D, target, level,
+         internalformat, width, height, depth, border, format, type, data);
+  opengl::captureImage(data, width, height, depth, format, type);
 }
 inline void glTexParameteri(GLenum target, GLenum pname, GLint param,
                             const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glTexParameteri, target, pname, param);
+  callGL(sourceLocation, GLFunction::TexParameteri, ::glTexParameteri, target,
+         pname, param);
+}
+inline void glTexSubImage3D(GLenum target, GLint level, GLint xoffset,
+                            GLint yoffset, GLint zoffset, GLsizei width,
+                            GLsizei height, GLsizei depth, GLenum format,
+                            GLenum type, const void* pixels,
+                            const sl& sourceLocation = sl::current()) {
+  opengl::recordTextureUpload(width, height * depth, format, type);
+  callGL(sourceLocation, GLFunction::TexSubImage3D, ::glTexSubImage3D, target,
+         level, xoffset, yoffset, zoffset, width, height, depth, format, type,
+         pixels);
+  opengl::captureImage(pixels, width, height, depth, format, type);
 }
 inline void glUniform1f(GLint location, GLfloat v0,
                         const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glUniform1f, location, v0);
+  callGL(sourceLocation, GLFunction::Uniform1f, ::glUniform1f, location, v0);
 }
 inline void glUniform1i(GLint location, GLint v0,
                         const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glUniform1i, location, v0);
+  callGL(sourceLocation, GLFunction::Uniform1i, ::glUniform1i, location, v0);
 }
 inline void glUniform3fv(GLint location, GLsizei count, const GLfloat* value,
                          const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glUniform3fv, location, count, value);
+  callGL(sourceLocation, GLFunction::Uniform3fv, ::glUniform3fv, location,
+         count, value);
+  opengl::capturePayload(value,
+                         static_cast<std::size_t>(count) * 3 * sizeof(GLfloat));
+}
+inline void glUniform4fv(GLint location, GLsizei count, const GLfloat* value,
+                         const sl& sourceLocation = sl::current()) {
+  callGL(sourceLocation, GLFunction::Uniform4fv, ::glUniform4fv, location,
+         count, value);
+  opengl::capturePayload(value,
+                         static_cast<std::size_t>(count) * 4 * sizeof(GLfloat));
 }
 inline void glUniformMatrix3fv(GLint location, GLsizei count,
                                GLboolean transpose, const GLfloat* value,
                                const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glUniformMatrix3fv, location, count, transpose,
-         value);
+  callGL(sourceLocation, GLFunction::UniformMatrix3fv, ::glUniformMatrix3fv,
+         location, count, transpose, value);
+  opengl::capturePayload(value,
+                         static_cast<std::size_t>(count) * 9 * sizeof(GLfloat));
 }
 inline void glUniformMatrix4fv(GLint location, GLsizei count,
                                GLboolean transpose, const GLfloat* value,
                                const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glUniformMatrix4fv, location, count, transpose,
-         value);
+  callGL(sourceLocation, GLFunction::UniformMatrix4fv, ::glUniformMatrix4fv,
+         location, count, transpose, value);
+  opengl::capturePayload(value,
+                         static_cast<std::size_t>(count) * 16 *
+                             sizeof(GLfloat));
 }
 inline void glUniformBlockBinding(GLuint program, GLuint uniformBlockIndex,
                                   GLuint uniformBlockBinding,
                                   const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glUniformBlockBinding, program, uniformBlockIndex,
+  callGL(sourceLocation, GLFunction::UniformBlockBinding,
+         ::glUniformBlockBinding, program, uniformBlockIndex,
          uniformBlockBinding);
 }
 inline void glUseProgram(GLuint program,
                          const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glUseProgram, program);
+  if (opengl::isRedundant(GLFunction::UseProgram,
+                          &opengl::StateCache::useProgram, program)) {
+    return;
+  }
+  callGL(sourceLocation, GLFunction::UseProgram, ::glUseProgram, program);
+}
+inline void glVertexAttribDivisor(GLuint index, GLuint divisor,
+                                  const sl& sourceLocation = sl::current()) {
+  callGL(sourceLocation, GLFunction::VertexAttribDivisor,
+         ::glVertexAttribDivisor, index, divisor);
 }
 inline void glVertexAttribPointer(GLuint index, GLint size, GLenum type,
                                   GLboolean normalized, GLsizei stride,
                                   const void* pointer,
                                   const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glVertexAttribPointer, index, size, type, normalized,
-         stride, pointer);
+  callGL(sourceLocation, GLFunction::VertexAttribPointer,
+         ::glVertexAttribPointer, index, size, type, normalized, stride,
+         pointer);
 }
 inline void glViewport(GLint x, GLint y, GLsizei width, GLsizei height,
                        const sl& sourceLocation = sl::current()) {
-  callGL(sourceLocation, ::glViewport, x, y, width, height);
+  if (opengl::isRedundant(GLFunction::Viewport, &opengl::StateCache::viewport,
+                          x, y, width, height)) {
+    return;
+  }
+  callGL(sourceLocation, GLFunction::Viewport, ::glViewport, x, y, width,
+         height);
 }
+#else
+using ::glActiveTexture;
+using ::glAttachShader;
+using ::glBindBuffer;
+using ::glBindBufferBase;
+using ::glBindBufferRange;
+#if !defined(__EMSCRIPTEN__)
+using ::glBindFragDataLocation;
+#endif
+using ::glBindFramebuffer;
+using ::glBindRenderbuffer;
+using ::glBindSampler;
+using ::glBindTexture;
+using ::glBindVertexArray;
+using ::glBlitFramebuffer;
+using ::glBufferData;
+using ::glBufferSubData;
+using ::glCheckFramebufferStatus;
+using ::glClear;
+using ::glClearColor;
+using ::glCompileShader;
+using ::glCopyBufferSubData;
+using ::glCreateProgram;
+using ::glCreateShader;
+using ::glDeleteBuffers;
+using ::glDeleteFramebuffers;
+using ::glDeleteProgram;
+using ::glDeleteRenderbuffers;
+using ::glDeleteSamplers;
+using ::glDeleteShader;
+using ::glDeleteTextures;
+using ::glDeleteVertexArrays;
+using ::glDisable;
+using ::glDrawArrays;
+using ::glDrawBuffers;
+using ::glDrawElements;
+using ::glDrawElementsInstanced;
+#if !defined(__EMSCRIPTEN__)
+using ::glDrawElementsInstancedBaseVertex;
+#endif
+using ::glEnable;
+using ::glEnableVertexAttribArray;
+using ::glFramebufferRenderbuffer;
+#if !defined(__EMSCRIPTEN__)
+using ::glFramebufferTexture;
+#endif
+using ::glGenBuffers;
+using ::glGenerateMipmap;
+using ::glGenFramebuffers;
+using ::glGenRenderbuffers;
+using ::glGenSamplers;
+using ::glGenTextures;
+using ::glGenVertexArrays;
+using ::glGetActiveUniformBlockiv;
+using ::glGetAttribLocation;
+using ::glGetBooleanv;
+#if !defined(__EMSCRIPTEN__)
+using ::glGetDoublev;
+#endif
+using ::glGetFloatv;
+using ::glGetIntegerv;
+using ::glGetProgramiv;
+using ::glGetShaderiv;
+using ::glGetString;
+using ::glGetUniformBlockIndex;
+using ::glGetUniformLocation;
+using ::glLinkProgram;
+#if !defined(__EMSCRIPTEN__)
+using ::glMultiDrawElementsIndirect;
+#endif
+using ::glRenderbufferStorage;
+using ::glSamplerParameterf;
+using ::glSamplerParameteri;
+using ::glShaderSource;
+using ::glTexImage2D;
+#if !defined(__EMSCRIPTEN__)
+using ::glTexImage2DMultisample;
+#endif
+using ::glTexImage3D;
+using ::glTexParameteri;
+using ::glTexSubImage3D;
+using ::glUniform1f;
+using ::glUniform1i;
+using ::glUniform3fv;
+using ::glUniform4fv;
+using ::glUniformBlockBinding;
+using ::glUniformMatrix3fv;
+using ::glUniformMatrix4fv;
+using ::glUseProgram;
+using ::glVertexAttribDivisor;
+using ::glVertexAttribPointer;
+using ::glViewport;
 #endif
 }  // namespace abcg
 
@@ -0,0 +1,324 @@
+/**
+ * @file abcg_openglstate.cpp
+ * @brief Definition of abcg::opengl::StateCache class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_openglstate.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+// Buffer targets tracked by the cache, or -1
+int getBufferTargetIndex(GLenum target) {
+  switch (target) {
+    case GL_ARRAY_BUFFER:
+      return 0;
+    case GL_ELEMENT_ARRAY_BUFFER:
+      return 1;
+    case GL_UNIFORM_BUFFER:
+      return 2;
+    case GL_COPY_READ_BUFFER:
+      return 3;
+    case GL_COPY_WRITE_BUFFER:
+      return 4;
+    case GL_PIXEL_PACK_BUFFER:
+      return 5;
+    case GL_PIXEL_UNPACK_BUFFER:
+      return 6;
+#if !defined(__EMSCRIPTEN__)
+    case GL_TEXTURE_BUFFER:
+      return 7;
+    case GL_DRAW_INDIRECT_BUFFER:
+      return 8;
+    case GL_SHADER_STORAGE_BUFFER:
+      return 9;
+#endif
+    default:
+      return -1;
+  }
+}
+
+int getTextureTargetIndex(GLenum target) {
+  switch (target) {
+    case GL_TEXTURE_2D:
+      return 0;
+    case GL_TEXTURE_CUBE_MAP:
+      return 1;
+    case GL_TEXTURE_2D_ARRAY:
+      return 2;
+    case GL_TEXTURE_3D:
+      return 3;
+    default:
+      return -1;
+  }
+}
+
+int getCapabilityIndex(GLenum cap) {
+  switch (cap) {
+    case GL_BLEND:
+      return 0;
+    case GL_CULL_FACE:
+      return 1;
+    case GL_DEPTH_TEST:
+      return 2;
+    case GL_SCISSOR_TEST:
+      return 3;
+    case GL_STENCIL_TEST:
+      return 4;
+    case GL_POLYGON_OFFSET_FILL:
+      return 5;
+#if !defined(__EMSCRIPTEN__)
+    case GL_MULTISAMPLE:
+      return 6;
+    case GL_FRAMEBUFFER_SRGB:
+      return 7;
+    case GL_PROGRAM_POINT_SIZE:
+      return 8;
+    case GL_PRIMITIVE_RESTART:
+      return 9;
+#endif
+    default:
+      return -1;
+  }
+}
+}  // namespace
+
+/**
+ * @brief Makes a cache the current one of the calling thread.
+ *
+ * Must be called whenever the OpenGL context owning the cache is made
+ * current. This is a no-op unless ABCG_GL_STATE_CACHE is defined.
+ *
+ * @param cache Cache of the context, or nullptr to disable filtering.
+ */
+void abcg::opengl::setCurrentStateCache([[maybe_unused]] StateCache *cache) {
+#if defined(ABCG_GL_STATE_CACHE)
+  currentStateCache = cache;
+#endif
+}
+
+/**
+ * @brief Returns the current cache of the calling thread.
+ *
+ * @return Cache of the current context, or nullptr.
+ */
+abcg::opengl::StateCache *abcg::opengl::getCurrentStateCache() {
+#if defined(ABCG_GL_STATE_CACHE)
+  return currentStateCache;
+#else
+  return nullptr;
+#endif
+}
+
+/**
+ * @brief Constructs a cache with all values unknown.
+ */
+abcg::opengl::StateCache::StateCache() { invalidate(); }
+
+/**
+ * @brief Marks all values as unknown.
+ *
+ * Must be called after the state is changed without the wrappers, such as by
+ * the ImGui renderer.
+ */
+void abcg::opengl::StateCache::invalidate() noexcept {
+  m_program = unknownName;
+  m_vertexArray = unknownName;
+  m_buffers.fill(unknownName);
+  m_activeTexture = numTextureUnits;
+  for (auto &unit : m_textures) unit.fill(unknownName);
+  m_samplers.fill(unknownName);
+  m_capabilities.fill(-1);
+  m_viewport.fill(unknownValue);
+}
+
+/**
+ * @brief Updates the current program.
+ *
+ * @param program Program name passed to glUseProgram.
+ * @return True if the state changed.
+ */
+bool abcg::opengl::StateCache::useProgram(GLuint program) noexcept {
+  return std::exchange(m_program, program) != program;
+}
+
+/**
+ * @brief Updates the vertex array binding.
+ *
+ * The element array buffer binding is part of the vertex array state, so it
+ * becomes unknown when the vertex array changes.
+ *
+ * @param array Vertex array name passed to glBindVertexArray.
+ * @return True if the state changed.
+ */
+bool abcg::opengl::StateCache::bindVertexArray(GLuint array) noexcept {
+  if (std::exchange(m_vertexArray, array) == array) return false;
+  m_buffers.at(1) = unknownName;
+  return true;
+}
+
+/**
+ * @brief Updates the buffer binding of a target.
+ *
+ * @param target Target passed to glBindBuffer.
+ * @param buffer Buffer name passed to glBindBuffer.
+ * @return True if the state changed or the target is not tracked.
+ */
+bool abcg::opengl::StateCache::bindBuffer(GLenum target,
+                                          GLuint buffer) noexcept {
+  const auto index{getBufferTargetIndex(target)};
+  if (index < 0) return true;
+  return std::exchange(m_buffers.at(static_cast<std::size_t>(index)),
+                       buffer) != buffer;
+}
+
+/**
+ * @brief Updates the generic buffer binding of a target after
+ * glBindBufferBase or glBindBufferRange, which also set it.
+ *
+ * @param target Target passed to glBindBufferBase or glBindBufferRange.
+ * @param buffer Buffer name.
+ */
+void abcg::opengl::StateCache::bindBufferBase(GLenum target,
+                                              GLuint buffer) noexcept {
+  if (const auto index{getBufferTargetIndex(target)}; index >= 0) {
+    m_buffers.at(static_cast<std::size_t>(index)) = buffer;
+  }
+}
+
+/**
+ * @brief Updates the active texture unit.
+ *
+ * @param texture Unit passed to glActiveTexture (e.g. GL_TEXTURE0).
+ * @return True if the state changed or the unit is not tracked.
+ */
+bool abcg::opengl::StateCache::activeTexture(GLenum texture) noexcept {
+  const auto unit{static_cast<std::size_t>(texture - GL_TEXTURE0)};
+  if (texture < GL_TEXTURE0 || unit >= numTextureUnits) {
+    m_activeTexture = numTextureUnits;
+    return true;
+  }
+  return std::exchange(m_activeTexture, unit) != unit;
+}
+
+/**
+ * @brief Updates the texture binding of a target of the active unit.
+ *
+ * @param target Target passed to glBindTexture.
+ * @param texture Texture name passed to glBindTexture.
+ * @return True if the state changed or the target or unit is not tracked.
+ */
+bool abcg::opengl::StateCache::bindTexture(GLenum target,
+                                           GLuint texture) noexcept {
+  auto *binding{getTextureBinding(target)};
+  if (binding == nullptr) return true;
+  return std::exchange(*binding, texture) != texture;
+}
+
+/**
+ * @brief Updates the sampler binding of a texture unit.
+ *
+ * @param unit Unit index passed to glBindSampler (e.g. 0).
+ * @param sampler Sampler name passed to glBindSampler.
+ * @return True if the state changed or the unit is not tracked.
+ */
+bool abcg::opengl::StateCache::bindSampler(GLuint unit,
+                                           GLuint sampler) noexcept {
+  if (unit >= numTextureUnits) return true;
+  return std::exchange(m_samplers.at(unit), sampler) != sampler;
+}
+
+/**
+ * @brief Updates the enable flag of a capability.
+ *
+ * @param cap Capability passed to glEnable or glDisable.
+ * @param enabled True for glEnable, false for glDisable.
+ * @return True if the state changed or the capability is not tracked.
+ */
+bool abcg::opengl::StateCache::enable(GLenum cap, bool enabled) noexcept {
+  const auto index{getCapabilityIndex(cap)};
+  if (index < 0) return true;
+  const std::int8_t value{enabled ? std::int8_t{1} : std::int8_t{0}};
+  return std::exchange(m_capabilities.at(static_cast<std::size_t>(index)),
+                       value) != value;
+}
+
+/**
+ * @brief Updates the viewport.
+ *
+ * @param x Left coordinate passed to glViewport.
+ * @param y Bottom coordinate passed to glViewport.
+ * @param width Width passed to glViewport.
+ * @param height Height passed to glViewport.
+ * @return True if the state changed.
+ */
+bool abcg::opengl::StateCache::viewport(GLint x, GLint y, GLsizei width,
+                                        GLsizei height) noexcept {
+  const std::array<GLint, 4> viewport{x, y, width, height};
+  return std::exchange(m_viewport, viewport) != viewport;
+}
+
+/**
+ * @brief Removes deleted buffers from the bindings.
+ *
+ * OpenGL binds 0 to the targets of the current context that were bound to a
+ * deleted buffer.
+ *
+ * @param buffers Names passed to glDeleteBuffers.
+ */
+void abcg::opengl::StateCache::deleteBuffers(
+    std::span<const GLuint> buffers) noexcept {
+  for (const auto buffer : buffers) {
+    std::replace(m_buffers.begin(), m_buffers.end(), buffer, GLuint{});
+  }
+}
+
+/**
+ * @brief Removes deleted textures from the bindings.
+ *
+ * @param textures Names passed to glDeleteTextures.
+ */
+void abcg::opengl::StateCache::deleteTextures(
+    std::span<const GLuint> textures) noexcept {
+  for (const auto texture : textures) {
+    for (auto &unit : m_textures) {
+      std::replace(unit.begin(), unit.end(), texture, GLuint{});
+    }
+  }
+}
+
+/**
+ * @brief Removes deleted vertex arrays from the binding.
+ *
+ * @param arrays Names passed to glDeleteVertexArrays.
+ */
+void abcg::opengl::StateCache::deleteVertexArrays(
+    std::span<const GLuint> arrays) noexcept {
+  if (std::find(arrays.begin(), arrays.end(), m_vertexArray) != arrays.end()) {
+    m_vertexArray = 0;
+    m_buffers.at(1) = unknownName;
+  }
+}
+
+/**
+ * @brief Removes deleted samplers from the bindings.
+ *
+ * @param samplers Names passed to glDeleteSamplers.
+ */
+void abcg::opengl::StateCache::deleteSamplers(
+    std::span<const GLuint> samplers) noexcept {
+  for (const auto sampler : samplers) {
+    std::replace(m_samplers.begin(), m_samplers.end(), sampler, GLuint{});
+  }
+}
+
+// Returns the binding of a target of the active unit, or nullptr if the
+// target or the unit is not tracked
+GLuint *abcg::opengl::StateCache::getTextureBinding(GLenum target) noexcept {
+  const auto index{getTextureTargetIndex(target)};
+  if (index < 0 || m_activeTexture >= numTextureUnits) return nullptr;
+  return &m_textures.at(m_activeTexture).at(static_cast<std::size_t>(index));
+}
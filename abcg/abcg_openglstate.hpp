@@ -0,0 +1,169 @@
+/**
+ * @file abcg_openglstate.hpp
+ * @brief Declaration of the OpenGL state cache.
+ *
+ * Tracking of the context state set through the OpenGL function wrappers, so
+ * that calls that would not change it are not sent to the driver.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGLSTATE_HPP_
+#define ABCG_OPENGLSTATE_HPP_
+
+// Redundant calls are filtered only if ABCG_GL_STATE_CACHE is defined
+// (enabled with the CMake option of the same name, also in release builds)
+#if defined(__EMSCRIPTEN__) || defined(__APPLE__)
+#undef ABCG_GL_STATE_CACHE
+#endif
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+#include "abcg_external.hpp"
+#include "abcg_openglstats.hpp"
+
+namespace abcg::opengl {
+class StateCache;
+
+void setCurrentStateCache(StateCache* cache);
+[[nodiscard]] StateCache* getCurrentStateCache();
+}  // namespace abcg::opengl
+
+/**
+ * @brief abcg::opengl::StateCache class.
+ *
+ * Shadow copy of part of the state of an OpenGL context: the current
+ * program, the vertex array, the buffers bound to each target, the active
+ * texture unit and the textures and samplers bound to each unit, the enable
+ * flags of the common capabilities, and the viewport. The parameters of
+ * texture objects are not tracked: objects may be shared with other contexts,
+ * whose caches would not see their changes.
+ *
+ * Each setter updates the copy and returns whether the state changed, that
+ * is, whether the corresponding OpenGL call must be made. Values are unknown
+ * until first set, so the first call is always made. Targets, units and
+ * parameters that are not tracked are always reported as changed.
+ *
+ * abcg::OpenGLWindow owns one cache per context and makes it current (see
+ * abcg::opengl::setCurrentStateCache) together with the context. The cache
+ * must be invalidated after the state is changed without the wrappers, e.g.
+ * by calling the OpenGL functions directly.
+ */
+class abcg::opengl::StateCache {
+ public:
+  StateCache();
+
+  void invalidate() noexcept;
+
+  [[nodiscard]] bool useProgram(GLuint program) noexcept;
+  [[nodiscard]] bool bindVertexArray(GLuint array) noexcept;
+  [[nodiscard]] bool bindBuffer(GLenum target, GLuint buffer) noexcept;
+  void bindBufferBase(GLenum target, GLuint buffer) noexcept;
+  [[nodiscard]] bool activeTexture(GLenum texture) noexcept;
+  [[nodiscard]] bool bindTexture(GLenum target, GLuint texture) noexcept;
+  [[nodiscard]] bool bindSampler(GLuint unit, GLuint sampler) noexcept;
+  [[nodiscard]] bool enable(GLenum cap, bool enabled) noexcept;
+  [[nodiscard]] bool viewport(GLint x, GLint y, GLsizei width,
+                              GLsizei height) noexcept;
+
+  void deleteBuffers(std::span<const GLuint> buffers) noexcept;
+  void deleteTextures(std::span<const GLuint> textures) noexcept;
+  void deleteVertexArrays(std::span<const GLuint> arrays) noexcept;
+  void deleteSamplers(std::span<const GLuint> samplers) noexcept;
+
+ private:
+  static constexpr GLuint unknownName{std::numeric_limits<GLuint>::max()};
+  static constexpr GLint unknownValue{std::numeric_limits<GLint>::min()};
+  static constexpr std::size_t numBufferTargets{10};
+  static constexpr std::size_t numTextureTargets{4};
+  static constexpr std::size_t numTextureUnits{32};
+  static constexpr std::size_t numCapabilities{10};
+
+  GLuint m_program{unknownName};
+  GLuint m_vertexArray{unknownName};
+  std::array<GLuint, numBufferTargets> m_buffers{};
+  // Index of the active texture unit, or numTextureUnits if unknown or not
+  // tracked
+  std::size_t m_activeTexture{numTextureUnits};
+  std::array<std::array<GLuint, numTextureTargets>, numTextureUnits>
+      m_textures{};
+  std::array<GLuint, numTextureUnits> m_samplers{};
+  // -1 if unknown, otherwise 0 or 1
+  std::array<std::int8_t, numCapabilities> m_capabilities{};
+  std::array<GLint, 4> m_viewport{};
+
+  [[nodiscard]] GLuint* getTextureBinding(GLenum target) noexcept;
+};
+
+namespace abcg::opengl {
+#if defined(ABCG_GL_STATE_CACHE)
+// Cache of the context that is current in the calling thread, or nullptr
+inline thread_local StateCache* currentStateCache{};
+#endif
+
+/**
+ * @brief Updates the state cache of the current context with a state change.
+ *
+ * @param function Function that makes the change, used for statistics.
+ * @param setter Member function of abcg::opengl::StateCache that updates the
+ * cache.
+ * @param args Arguments of the setter.
+ * @return True if the change is redundant and the call must be skipped.
+ */
+template <typename TSetter, typename... TArgs>
+inline bool isRedundant([[maybe_unused]] GLFunction function,
+                        [[maybe_unused]] TSetter setter,
+                        [[maybe_unused]] TArgs... args) {
+#if defined(ABCG_GL_STATE_CACHE)
+  if (auto* cache{currentStateCache};
+      cache != nullptr && !(cache->*setter)(args...)) {
+    recordFilteredCall(function);
+    return true;
+  }
+#endif
+  return false;
+}
+
+/**
+ * @brief Updates the state cache of the current context after a call that is
+ * never skipped.
+ *
+ * @param updater Member function of abcg::opengl::StateCache that updates
+ * the cache.
+ * @param args Arguments of the updater.
+ */
+template <typename TUpdater, typename... TArgs>
+inline void updateStateCache([[maybe_unused]] TUpdater updater,
+                             [[maybe_unused]] TArgs... args) {
+#if defined(ABCG_GL_STATE_CACHE)
+  if (auto* cache{currentStateCache}; cache != nullptr) {
+    (cache->*updater)(args...);
+  }
+#endif
+}
+
+/**
+ * @brief Removes deleted objects from the state cache of the current context.
+ *
+ * @param remover Member function of abcg::opengl::StateCache that removes
+ * the objects.
+ * @param n Number of objects.
+ * @param names Array of object names.
+ */
+template <typename TRemover>
+inline void forgetObjects([[maybe_unused]] TRemover remover,
+                          [[maybe_unused]] GLsizei n,
+                          [[maybe_unused]] const GLuint* names) {
+#if defined(ABCG_GL_STATE_CACHE)
+  if (auto* cache{currentStateCache}; cache != nullptr && n > 0) {
+    (cache->*remover)(std::span{names, static_cast<std::size_t>(n)});
+  }
+#endif
+}
+}  // namespace abcg::opengl
+
+#endif
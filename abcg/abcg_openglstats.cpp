@@ -0,0 +1,288 @@
+/**
+ * @file abcg_openglstats.cpp
+ * @brief Definition of OpenGL call statistics.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_openglstats.hpp"
+
+#include <numeric>
+
+namespace {
+constexpr std::array<std::string_view, abcg::opengl::numGLFunctions>
+    functionNames{
+    "glActiveTexture",
+    "glAttachShader",
+    "glBindBuffer",
+    "glBindBufferBase",
+    "glBindBufferRange",
+#if !defined(__EMSCRIPTEN__)
+    "glBindFragDataLocation",
+#endif
+    "glBindFramebuffer",
+    "glBindRenderbuffer",
+    "glBindSampler",
+    "glBindTexture",
+    "glBindVertexArray",
+    "glBlitFramebuffer",
+    "glBufferData",
+    "glBufferSubData",
+    "glCheckFramebufferStatus",
+    "glClear",
+    "glClearColor",
+    "glCompileShader",
+    "glCopyBufferSubData",
+    "glCreateProgram",
+    "glCreateShader",
+    "glDeleteBuffers",
+    "glDeleteFramebuffers",
+    "glDeleteProgram",
+    "glDeleteRenderbuffers",
+    "glDeleteSamplers",
+    "glDeleteShader",
+    "glDeleteTextures",
+    "glDeleteVertexArrays",
+    "glDisable",
+    "glDrawArrays",
+    "glDrawBuffers",
+    "glDrawElements",
+    "glDrawElementsInstanced",
+    "glDrawElementsInstancedBaseVertex",
+    "glEnable",
+    "glEnableVertexAttribArray",
+    "glFramebufferRenderbuffer",
+#if !defined(__EMSCRIPTEN__)
+    "glFramebufferTexture",
+#endif
+    "glGenBuffers",
+    "glGenFramebuffers",
+    "glGenRenderbuffers",
+    "glGenSamplers",
+    "glGenTextures",
+    "glGenVertexArrays",
+    "glGenerateMipmap",
+    "glGetActiveUniformBlockiv",
+    "glGetAttribLocation",
+    "glGetBooleanv",
+#if !defined(__EMSCRIPTEN__)
+    "glGetDoublev",
+#endif
+    "glGetFloatv",
+    "glGetIntegerv",
+    "glGetProgramiv",
+    "glGetShaderiv",
+    "glGetString",
+    "glGetUniformBlockIndex",
+    "glGetUniformLocation",
+    "glLinkProgram",
+    "glMultiDrawElementsIndirect",
+    "glRenderbufferStorage",
+    "glSamplerParameterf",
+    "glSamplerParameteri",
+    "glShaderSource",
+    "glTexImage2D",
+#if !defined(__EMSCRIPTEN__)
+    "glTexImage2DMultisample",
+#endif
+    "glTexImage3D",
+    "glTexParameteri",
+    "glTexSubImage3D",
+    "glUniform1f",
+    "glUniform1i",
+    "glUniform3fv",
+    "glUniform4fv",
+    "glUniformBlockBinding",
+    "glUniformMatrix3fv",
+    "glUniformMatrix4fv",
+    "glUseProgram",
+    "glVertexAttribDivisor",
+    "glVertexAttribPointer",
+    "glViewport"};
+
+// Statistics of the last complete frame of the current thread
+thread_local abcg::opengl::FrameStats lastFrameStats{};
+
+}  // namespace
+
+/**
+ * @brief Returns the name of a wrapped function.
+ *
+ * @param function Function identifier.
+ * @return Function name, e.g. `glBindBuffer`.
+ */
+std::string_view abcg::opengl::getFunctionName(GLFunction function) {
+  return functionNames.at(static_cast<std::size_t>(function));
+}
+
+/**
+ * @brief Returns whether a function binds objects or sets context state.
+ *
+ * @param function Function identifier.
+ * @return True if calls of the function are counted as state changes.
+ */
+bool abcg::opengl::isStateChange(GLFunction function) {
+  switch (function) {
+    case GLFunction::ActiveTexture:
+    case GLFunction::BindBuffer:
+    case GLFunction::BindBufferBase:
+    case GLFunction::BindBufferRange:
+    case GLFunction::BindFramebuffer:
+    case GLFunction::BindRenderbuffer:
+    case GLFunction::BindSampler:
+    case GLFunction::BindTexture:
+    case GLFunction::BindVertexArray:
+    case GLFunction::ClearColor:
+    case GLFunction::Disable:
+    case GLFunction::DrawBuffers:
+    case GLFunction::Enable:
+    case GLFunction::EnableVertexAttribArray:
+    case GLFunction::SamplerParameterf:
+    case GLFunction::SamplerParameteri:
+    case GLFunction::TexParameteri:
+    case GLFunction::Uniform1f:
+    case GLFunction::Uniform1i:
+    case GLFunction::Uniform3fv:
+    case GLFunction::Uniform4fv:
+    case GLFunction::UniformBlockBinding:
+    case GLFunction::UniformMatrix3fv:
+    case GLFunction::UniformMatrix4fv:
+    case GLFunction::UseProgram:
+    case GLFunction::VertexAttribDivisor:
+    case GLFunction::VertexAttribPointer:
+    case GLFunction::Viewport:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/**
+ * @brief Returns the statistics of the last complete frame.
+ *
+ * Statistics are per thread. All counters are zero unless ABCG_GL_STATS is
+ * defined.
+ *
+ * @return Statistics of the frame ended by the last call to endStatsFrame.
+ */
+const abcg::opengl::FrameStats &abcg::opengl::getFrameStats() {
+  return lastFrameStats;
+}
+
+/**
+ * @brief Ends the frame being recorded and starts a new one.
+ *
+ * Called by abcg::OpenGLWindow after painting each frame.
+ */
+void abcg::opengl::endStatsFrame() {
+#if defined(ABCG_GL_STATS)
+  auto &stats{currentFrameStats};
+  stats.totalCalls =
+      std::accumulate(stats.calls.begin(), stats.calls.end(), std::uint64_t{});
+  stats.stateChanges = 0;
+  for (std::size_t index{}; index < numGLFunctions; ++index) {
+    if (isStateChange(static_cast<GLFunction>(index))) {
+      stats.stateChanges += stats.calls.at(index);
+    }
+  }
+  stats.filteredCalls = std::accumulate(stats.filtered.begin(),
+                                        stats.filtered.end(), std::uint64_t{});
+  lastFrameStats = stats;
+  stats = {};
+#endif
+}
+
+/**
+ * @brief Counts bytes uploaded to a texture.
+ *
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param format Format of the pixel data.
+ * @param type Data type of the pixel data.
+ */
+void abcg::opengl::recordTextureUpload([[maybe_unused]] GLsizei width,
+                                       [[maybe_unused]] GLsizei height,
+                                       [[maybe_unused]] GLenum format,
+                                       [[maybe_unused]] GLenum type) {
+#if defined(ABCG_GL_STATS)
+  currentFrameStats.textureBytes += getImageSize(width, height, format, type);
+#endif
+}
+
+/**
+ * @brief Returns the size of a pixel of client pixel data.
+ *
+ * @param format Format of the pixel data.
+ * @param type Data type of the pixel data.
+ * @return Size in bytes.
+ */
+std::size_t abcg::opengl::getPixelSize(GLenum format, GLenum type) {
+  std::size_t components{4};
+  switch (format) {
+    case GL_RED:
+    case GL_RED_INTEGER:
+    case GL_DEPTH_COMPONENT:
+      components = 1;
+      break;
+    case GL_RG:
+    case GL_RG_INTEGER:
+    case GL_DEPTH_STENCIL:
+      components = 2;
+      break;
+    case GL_RGB:
+    case GL_RGB_INTEGER:
+      components = 3;
+      break;
+    default:
+      break;
+  }
+  switch (type) {
+    case GL_UNSIGNED_BYTE:
+    case GL_BYTE:
+      return components;
+    case GL_UNSIGNED_SHORT:
+    case GL_SHORT:
+    case GL_HALF_FLOAT:
+      return components * 2;
+    case GL_UNSIGNED_INT_24_8:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+      return 4;
+    default:
+      return components * 4;
+  }
+}
+
+/**
+ * @brief Returns the size of the pixels of a 2D image, tightly packed.
+ *
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param format Format of the pixel data.
+ * @param type Data type of the pixel data.
+ * @return Size in bytes, without row padding.
+ */
+std::size_t abcg::opengl::getImageSize(GLsizei width, GLsizei height,
+                                       GLenum format, GLenum type) {
+  return static_cast<std::size_t>(width) * static_cast<std::size_t>(height) *
+         getPixelSize(format, type);
+}
+
+/**
+ * @brief Adds the counters of a frame to a running total.
+ *
+ * @param total Sum of the counters of several frames.
+ * @param stats Counters of one frame.
+ */
+void abcg::opengl::addFrameStats(FrameStats &total, const FrameStats &stats) {
+  for (std::size_t index{}; index < numGLFunctions; ++index) {
+    total.calls.at(index) += stats.calls.at(index);
+    total.filtered.at(index) += stats.filtered.at(index);
+  }
+  total.totalCalls += stats.totalCalls;
+  total.drawCalls += stats.drawCalls;
+  total.triangles += stats.triangles;
+  total.stateChanges += stats.stateChanges;
+  total.bufferBytes += stats.bufferBytes;
+  total.textureBytes += stats.textureBytes;
+  total.filteredCalls += stats.filteredCalls;
+}
@@ -0,0 +1,244 @@
+/**
+ * @file abcg_openglstats.hpp
+ * @brief Declaration of OpenGL call statistics.
+ *
+ * Per-frame counters collected by the OpenGL function wrappers.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGLSTATS_HPP_
+#define ABCG_OPENGLSTATS_HPP_
+
+// Statistics are collected only if ABCG_GL_STATS is defined (enabled with the
+// CMake option of the same name, also in release builds)
+#if defined(__EMSCRIPTEN__) || defined(__APPLE__)
+#undef ABCG_GL_STATS
+#endif
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "abcg_external.hpp"
+
+namespace abcg::opengl {
+/**
+ * @brief Enumeration of the OpenGL functions that have wrappers.
+ */
+enum class GLFunction : std::uint8_t {
+  ActiveTexture,
+  AttachShader,
+  BindBuffer,
+  BindBufferBase,
+  BindBufferRange,
+#if !defined(__EMSCRIPTEN__)
+  BindFragDataLocation,
+#endif
+  BindFramebuffer,
+  BindRenderbuffer,
+  BindSampler,
+  BindTexture,
+  BindVertexArray,
+  BlitFramebuffer,
+  BufferData,
+  BufferSubData,
+  CheckFramebufferStatus,
+  Clear,
+  ClearColor,
+  CompileShader,
+  CopyBufferSubData,
+  CreateProgram,
+  CreateShader,
+  DeleteBuffers,
+  DeleteFramebuffers,
+  DeleteProgram,
+  DeleteRenderbuffers,
+  DeleteSamplers,
+  DeleteShader,
+  DeleteTextures,
+  DeleteVertexArrays,
+  Disable,
+  DrawArrays,
+  DrawBuffers,
+  DrawElements,
+  DrawElementsInstanced,
+  DrawElementsInstancedBaseVertex,
+  Enable,
+  EnableVertexAttribArray,
+  FramebufferRenderbuffer,
+#if !defined(__EMSCRIPTEN__)
+  FramebufferTexture,
+#endif
+  GenBuffers,
+  GenFramebuffers,
+  GenRenderbuffers,
+  GenSamplers,
+  GenTextures,
+  GenVertexArrays,
+  GenerateMipmap,
+  GetActiveUniformBlockiv,
+  GetAttribLocation,
+  GetBooleanv,
+#if !defined(__EMSCRIPTEN__)
+  GetDoublev,
+#endif
+  GetFloatv,
+  GetIntegerv,
+  GetProgramiv,
+  GetShaderiv,
+  GetString,
+  GetUniformBlockIndex,
+  GetUniformLocation,
+  LinkProgram,
+  MultiDrawElementsIndirect,
+  RenderbufferStorage,
+  SamplerParameterf,
+  SamplerParameteri,
+  ShaderSource,
+  TexImage2D,
+#if !defined(__EMSCRIPTEN__)
+  TexImage2DMultisample,
+#endif
+  TexImage3D,
+  TexParameteri,
+  TexSubImage3D,
+  Uniform1f,
+  Uniform1i,
+  Uniform3fv,
+  Uniform4fv,
+  UniformBlockBinding,
+  UniformMatrix3fv,
+  UniformMatrix4fv,
+  UseProgram,
+  VertexAttribDivisor,
+  VertexAttribPointer,
+  Viewport,
+  Count
+};
+
+constexpr auto numGLFunctions{static_cast<std::size_t>(GLFunction::Count)};
+
+struct FrameStats;
+
+[[nodiscard]] std::string_view getFunctionName(GLFunction function);
+[[nodiscard]] bool isStateChange(GLFunction function);
+[[nodiscard]] const FrameStats& getFrameStats();
+void endStatsFrame();
+void addFrameStats(FrameStats& total, const FrameStats& stats);
+void recordTextureUpload(GLsizei width, GLsizei height, GLenum format,
+                         GLenum type);
+[[nodiscard]] std::size_t getPixelSize(GLenum format, GLenum type);
+[[nodiscard]] std::size_t getImageSize(GLsizei width, GLsizei height,
+                                       GLenum format, GLenum type);
+}  // namespace abcg::opengl
+
+/**
+ * @brief OpenGL usage counters of one frame.
+ */
+struct abcg::opengl::FrameStats {
+  // Number of calls of each wrapped function
+  std::array<std::uint32_t, numGLFunctions> calls{};
+  std::uint64_t totalCalls{};
+  std::uint64_t drawCalls{};
+  std::uint64_t triangles{};
+  // Number of calls that bind objects or set context state
+  std::uint64_t stateChanges{};
+  std::uint64_t bufferBytes{};
+  std::uint64_t textureBytes{};
+  // Number of redundant calls of each wrapped function filtered by the state
+  // cache (see abcg::opengl::StateCache), not included in calls
+  std::array<std::uint32_t, numGLFunctions> filtered{};
+  std::uint64_t filteredCalls{};
+};
+
+#if defined(ABCG_GL_STATS)
+namespace abcg::opengl {
+// Counters of the frame being recorded by the current thread
+inline thread_local FrameStats currentFrameStats{};
+}  // namespace abcg::opengl
+#endif
+
+namespace abcg::opengl {
+/**
+ * @brief Counts a call of a wrapped function.
+ *
+ * @param function Function called.
+ */
+inline void recordCall([[maybe_unused]] GLFunction function) {
+#if defined(ABCG_GL_STATS)
+  ++currentFrameStats.calls[static_cast<std::size_t>(function)];
+#endif
+}
+
+/**
+ * @brief Counts a call of a wrapped function that was filtered as redundant.
+ *
+ * @param function Function called.
+ */
+inline void recordFilteredCall([[maybe_unused]] GLFunction function) {
+#if defined(ABCG_GL_STATS)
+  ++currentFrameStats.filtered[static_cast<std::size_t>(function)];
+#endif
+}
+
+/**
+ * @brief Counts the triangles submitted by a draw, without counting a call.
+ *
+ * Used for draws whose parameters are not passed to the call, such as the
+ * commands of glMultiDrawElementsIndirect, which are read from a buffer.
+ *
+ * @param mode Primitive type.
+ * @param count Number of vertices or indices.
+ * @param instanceCount Number of instances.
+ */
+inline void recordPrimitives([[maybe_unused]] GLenum mode,
+                             [[maybe_unused]] GLsizei count,
+                             [[maybe_unused]] GLsizei instanceCount = 1) {
+#if defined(ABCG_GL_STATS)
+  std::uint64_t triangles{};
+  if (mode == GL_TRIANGLES) {
+    triangles = static_cast<std::uint64_t>(count / 3);
+  } else if ((mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) &&
+             count > 2) {
+    triangles = static_cast<std::uint64_t>(count - 2);
+  }
+  currentFrameStats.triangles +=
+      triangles * static_cast<std::uint64_t>(instanceCount);
+#endif
+}
+
+/**
+ * @brief Counts a draw call and the triangles it submits.
+ *
+ * @param mode Primitive type.
+ * @param count Number of vertices or indices.
+ * @param instanceCount Number of instances.
+ */
+inline void recordDraw([[maybe_unused]] GLenum mode,
+                       [[maybe_unused]] GLsizei count,
+                       [[maybe_unused]] GLsizei instanceCount = 1) {
+#if defined(ABCG_GL_STATS)
+  ++currentFrameStats.drawCalls;
+  recordPrimitives(mode, count, instanceCount);
+#endif
+}
+
+/**
+ * @brief Counts bytes uploaded to a buffer object.
+ *
+ * @param size Number of bytes.
+ * @param data Pointer to the data. Nothing is uploaded if null.
+ */
+inline void recordBufferUpload([[maybe_unused]] GLsizeiptr size,
+                               [[maybe_unused]] const void* data) {
+#if defined(ABCG_GL_STATS)
+  if (data != nullptr) {
+    currentFrameStats.bufferBytes += static_cast<std::uint64_t>(size);
+  }
+#endif
+}
+}  // namespace abcg::opengl
+
+#endif
@@ -13,17 +13,21 @@
 #include <imgui_impl_sdl.h>
 
 #include <algorithm>
-#include <fstream>
-#include <regex>
-#include <sstream>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <gsl/gsl>
+#include <numeric>
+#include <optional>
 #include <string_view>
+#include <utility>
 
 #include "SDL_events.h"
+#include "SDL_image.h"
 #include "SDL_video.h"
 #include "abcg_application.hpp"
 #include "abcg_embeddedfonts.hpp"
 #include "abcg_openglfunctions.hpp"
-#include "abcg_string.hpp"
 
 void printShaderInfoLog(GLuint shader, std::string_view prefix) {
   GLint infoLogLength{};
@@ -49,10 +53,84 @@ void printProgramInfoLog(GLuint program) {
   }
 }
 
+// Copies the contents of an ImVector, keeping the capacity of the destination
+template <typename T>
+void copyImVector(ImVector<T> &destination, const ImVector<T> &source) {
+  destination.resize(source.Size);
+  if (source.Size > 0) {
+    std::memcpy(destination.Data, source.Data,
+                static_cast<std::size_t>(source.Size) * sizeof(T));
+  }
+}
+
 ImVec4 ColorAlpha(const ImVec4 &color, float alpha) {
   return ImVec4(color.x, color.y, color.z, alpha);
 }
 
+// Draws the CPU scopes of the last complete frame, one block of rows per
+// thread and one row per nesting level
+void paintFlameGraph(const abcg::profiler::Snapshot &snapshot) {
+  if (snapshot.frames.size() < 2) {
+    ImGui::TextUnformatted("Waiting for frames");
+    return;
+  }
+  const auto frameBegin{snapshot.frames.at(snapshot.frames.size() - 2)};
+  const auto frameEnd{snapshot.frames.back()};
+  ImGui::Text("Frame: %.3f ms", static_cast<double>(frameEnd - frameBegin) *
+                                    1e-6);
+
+  const auto width{400.0f};
+  const auto rowHeight{ImGui::GetTextLineHeightWithSpacing()};
+  const auto scale{static_cast<double>(width) /
+                   static_cast<double>(frameEnd - frameBegin)};
+  auto *drawList{ImGui::GetWindowDrawList()};
+  const auto inFrame{[&](const abcg::profiler::Event &event) {
+    return event.end > frameBegin && event.begin < frameEnd;
+  }};
+
+  for (const auto &thread : snapshot.threads) {
+    std::uint32_t maxDepth{};
+    auto found{false};
+    for (const auto &event : thread.events) {
+      if (!inFrame(event)) continue;
+      maxDepth = std::max(maxDepth, event.depth);
+      found = true;
+    }
+    if (!found) continue;
+
+    ImGui::TextUnformatted(thread.name.c_str());
+    const auto origin{ImGui::GetCursorScreenPos()};
+    ImGui::Dummy(ImVec2(width, rowHeight * static_cast<float>(maxDepth + 1)));
+    for (const auto &event : thread.events) {
+      if (!inFrame(event)) continue;
+      const auto begin{std::max(event.begin, frameBegin) - frameBegin};
+      const auto end{std::min(event.end, frameEnd) - frameBegin};
+      const ImVec2 min{
+          origin.x + static_cast<float>(static_cast<double>(begin) * scale),
+          origin.y + rowHeight * static_cast<float>(event.depth)};
+      const ImVec2 max{
+          std::max(origin.x +
+                       static_cast<float>(static_cast<double>(end) * scale),
+                   min.x + 1.0f),
+          min.y + rowHeight - 1.0f};
+      // Same color for the same name
+      const auto hue{
+          static_cast<float>(std::hash<std::string_view>{}(event.name) % 64) /
+          64.0f};
+      drawList->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, 0.6f));
+      drawList->PushClipRect(min, max, true);
+      drawList->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32_WHITE,
+                        event.name);
+      drawList->PopClipRect();
+      if (ImGui::IsMouseHoveringRect(min, max)) {
+        ImGui::SetTooltip(
+            "%s: %.3f ms", event.name,
+            static_cast<double>(event.end - event.begin) * 1e-6);
+      }
+    }
+  }
+}
+
 void setupImGuiStyle(bool darkTheme, float alpha) {
   auto &style = ImGui::GetStyle();
 
@@ -164,16 +242,28 @@ EM_BOOL abcg::fullscreenchangeCallback(
 
 abcg::OpenGLWindow::~OpenGLWindow() {
   if (m_window != nullptr) {
-    if (ImGui::GetCurrentContext() != nullptr) {
+    stopRenderThread();
+    if (m_imGuiContext != nullptr) {
+      ImGui::SetCurrentContext(m_imGuiContext);
+      SDL_GL_MakeCurrent(m_window, m_GLContext);
+      abcg::opengl::setCurrentStateCache(&m_stateCache);
       terminateGL();
+      for (const auto &[key, program] : m_programVariants) {
+        glDeleteProgram(program);
+      }
+      m_programVariants.clear();
+      m_samplerCache.destroy();
+      m_gpuProfiler.destroy();
+      destroyOffscreenFramebuffer();
       ImGui_ImplOpenGL3_Shutdown();
       ImGui_ImplSDL2_Shutdown();
-      ImGui::DestroyContext();
+      ImGui::DestroyContext(m_imGuiContext);
     }
 
     if (m_GLContext != nullptr) {
       SDL_GL_DeleteContext(m_GLContext);
     }
+    abcg::opengl::setCurrentStateCache(nullptr);
     SDL_DestroyWindow(m_window);
   }
 }
@@ -205,38 +295,284 @@ void abcg::OpenGLWindow::setWindowSettings(
   m_windowSettings = windowSettings;
 }
 
+/**
+ * @brief Requests the window to be painted.
+ *
+ * Only needed if abcg::WindowSettings::renderOnDemand is set: windows are
+ * then painted only after input and window events, and when requested.
+ * Calling this in paintUI or publishFrame with no delay keeps the window
+ * animating. Must be called from the main thread.
+ *
+ * @param delay Time in seconds before the window is painted.
+ */
+void abcg::OpenGLWindow::requestRepaint(double delay) {
+  if (delay <= 0.0) {
+    m_pendingFrames = std::max(m_pendingFrames, 1);
+  } else {
+    m_repaintTime =
+        std::min(m_repaintTime, m_windowStartTime.elapsed() + delay);
+  }
+}
+
+/**
+ * @brief Requests the next painted frame to be saved to a PNG file.
+ *
+ * The frame is read after paintGL and the ImGui overlays are painted, before
+ * the buffers are swapped. In headless mode, the offscreen framebuffer is
+ * read. Must be called from the main thread.
+ *
+ * @param path Path to the PNG file.
+ */
+void abcg::OpenGLWindow::requestScreenshot(std::string_view path) {
+  m_screenshotPath = path;
+  requestRepaint();
+}
+
 void abcg::OpenGLWindow::handleEvent([[maybe_unused]] SDL_Event &event) {}
 
 void abcg::OpenGLWindow::initializeGL() { glClearColor(0, 0, 0, 1); }
 
+/**
+ * @brief Advances the simulation by a fixed time step.
+ *
+ * Called zero or more times per frame before paintGL, so that the
+ * simulation does not depend on the frame rate (see
+ * abcg::WindowSettings::fixedTimeStep). Rendering can blend the last two
+ * simulation states with getInterpolationAlpha.
+ *
+ * @param timeStep Time step in seconds.
+ */
+void abcg::OpenGLWindow::fixedUpdate([[maybe_unused]] double timeStep) {}
+
+/**
+ * @brief Copies the state read by paintGL into one of two buffers.
+ *
+ * Called once per frame on the main thread, after paintUI. If
+ * abcg::OpenGLSettings::renderThread is set, paintGL runs on the render
+ * thread while the main thread prepares the next frame, so paintGL must only
+ * read state published here, from the buffer given by getPaintSlot. Without
+ * a render thread, the slot is always 0.
+ *
+ * @param slot Index of the buffer to be written, 0 or 1.
+ */
+void abcg::OpenGLWindow::publishFrame([[maybe_unused]] int slot) {}
+
 void abcg::OpenGLWindow::paintGL() { glClear(GL_COLOR_BUFFER_BIT); }
 
 void abcg::OpenGLWindow::paintUI() {
+  // Values shown by the overlays, copied under the lock, since the render
+  // thread takes it every frame
+  std::vector<float> presentIntervals;
+  FrameTimePercentiles present{};
+  FrameTimePercentiles cpu{};
+  FrameTimePercentiles gpu{};
+  auto budget{0.0};
+  std::size_t overBudget{};
+  std::uint64_t totalFrames{};
+  std::uint64_t totalOverBudget{};
+#if defined(ABCG_GL_STATS)
+  opengl::FrameStats glStats;
+#endif
+  {
+    const std::lock_guard lock{m_statisticsMutex};
+    if (m_windowSettings.showFPS) {
+      const auto &statistics{m_frameStatistics};
+      // Present interval of each of the last frames, newest last
+      const auto count{std::min(statistics.size(), std::size_t{150})};
+      presentIntervals.reserve(count);
+      for (auto index{statistics.size() - count}; index < statistics.size();
+           ++index) {
+        presentIntervals.push_back(static_cast<float>(
+            statistics.getValue(index, FrameMetric::PresentInterval)));
+      }
+      present = statistics.getPercentiles(FrameMetric::PresentInterval);
+      cpu = statistics.getPercentiles(FrameMetric::CPUTime);
+      gpu = statistics.getPercentiles(FrameMetric::GPUTime);
+      budget = statistics.getBudget();
+      overBudget = statistics.countOverBudget();
+      totalFrames = statistics.getTotalFrames();
+      totalOverBudget = statistics.getTotalOverBudget();
+    }
+#if defined(ABCG_GL_STATS)
+    if (m_windowSettings.showGLStats) glStats = m_glStats;
+#endif
+  }
+
+  // Files are written after the overlays are built
+  std::optional<FrameStatistics> exportedStatistics;
+  auto exportTrace{false};
+
   // FPS counter
+  auto statsPosition{ImVec2(5, 5)};
   if (m_windowSettings.showFPS) {
-    float fps = ImGui::GetIO().Framerate;
+    ImGui::SetNextWindowPos(ImVec2(5, 5));
+    ImGui::Begin("FPS", nullptr,
+                 ImGuiWindowFlags_NoDecoration |
+                     ImGuiWindowFlags_AlwaysAutoResize |
+                     ImGuiWindowFlags_NoBringToFrontOnFocus |
+                     ImGuiWindowFlags_NoFocusOnAppearing);
+
+    const auto fps{present.p50 > 0.0 ? 1000.0 / present.p50 : 0.0};
+    std::string label{fmt::format("{:.2f} ms ({:.1f} FPS)", present.p50, fps)};
+    ImGui::PlotLines("", presentIntervals.data(),
+                     static_cast<int>(presentIntervals.size()), 0,
+                     label.c_str(), 0.0f,
+                     static_cast<float>(std::max(present.max, budget)),
+                     ImVec2(150, 50));
+    ImGui::Text("p95 %.2f p99 %.2f max %.2f", present.p95, present.p99,
+                present.max);
+    ImGui::Text("Over %.1f ms: %llu/%llu", budget,
+                static_cast<unsigned long long>(overBudget),
+                static_cast<unsigned long long>(present.count));
+
+    if (ImGui::TreeNode("Details")) {
+      ImGui::Text("     p50    p95    p99    max");
+      ImGui::Text("CPU %6.2f %6.2f %6.2f %6.2f", cpu.p50, cpu.p95, cpu.p99,
+                  cpu.max);
+      if (gpu.count > 0) {
+        ImGui::Text("GPU %6.2f %6.2f %6.2f %6.2f", gpu.p50, gpu.p95, gpu.p99,
+                    gpu.max);
+      } else {
+        ImGui::TextUnformatted("GPU not measured");
+      }
+      ImGui::Text("Total over budget: %llu/%llu",
+                  static_cast<unsigned long long>(totalOverBudget),
+                  static_cast<unsigned long long>(totalFrames));
+      if (ImGui::Button("Export CSV")) {
+        const std::lock_guard lock{m_statisticsMutex};
+        exportedStatistics = m_frameStatistics;
+      }
+      ImGui::TreePop();
+    }
+    statsPosition.y += ImGui::GetWindowSize().y + 5;
+    ImGui::End();
+  }
 
-    static size_t offset{0};
-    static double refreshTime = ImGui::GetTime();
-    static std::array<float, 150> frames{};
+#if defined(ABCG_GL_STATS)
+  // OpenGL statistics of the previous frame
+  if (m_windowSettings.showGLStats) {
+    const auto &stats{glStats};
 
-    while (refreshTime < ImGui::GetTime()) {
-      const auto refreshFrequency{60.0};
-      frames.at(offset) = fps;
-      offset = (offset + 1) % frames.size();
-      refreshTime += (1.0 / refreshFrequency);
+    ImGui::SetNextWindowPos(statsPosition, ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
+    ImGui::Begin("OpenGL", nullptr,
+                 ImGuiWindowFlags_AlwaysAutoResize |
+                     ImGuiWindowFlags_NoFocusOnAppearing);
+    ImGui::Text("Calls: %llu",
+                static_cast<unsigned long long>(stats.totalCalls));
+    ImGui::Text("Draw calls: %llu",
+                static_cast<unsigned long long>(stats.drawCalls));
+    ImGui::Text("Triangles: %llu",
+                static_cast<unsigned long long>(stats.triangles));
+    ImGui::Text("State changes: %llu",
+                static_cast<unsigned long long>(stats.stateChanges));
+    ImGui::Text("Redundant calls filtered: %llu",
+                static_cast<unsigned long long>(stats.filteredCalls));
+    ImGui::Text("Buffer uploads: %.1f KiB",
+                static_cast<double>(stats.bufferBytes) / 1024.0);
+    ImGui::Text("Texture uploads: %.1f KiB",
+                static_cast<double>(stats.textureBytes) / 1024.0);
+
+    if (ImGui::TreeNode("Calls per function")) {
+      std::vector<std::size_t> order(abcg::opengl::numGLFunctions);
+      std::iota(order.begin(), order.end(), 0);
+      std::sort(order.begin(), order.end(), [&](auto lhs, auto rhs) {
+        return stats.calls.at(lhs) + stats.filtered.at(lhs) >
+               stats.calls.at(rhs) + stats.filtered.at(rhs);
+      });
+      for (auto index : order) {
+        const auto filtered{stats.filtered.at(index)};
+        if (stats.calls.at(index) + filtered == 0) break;
+        const auto name{abcg::opengl::getFunctionName(
+            static_cast<abcg::opengl::GLFunction>(index))};
+        if (filtered == 0) {
+          ImGui::Text("%6u %.*s", stats.calls.at(index),
+                      static_cast<int>(name.size()), name.data());
+        } else {
+          ImGui::Text("%6u %.*s (%u filtered)", stats.calls.at(index),
+                      static_cast<int>(name.size()), name.data(), filtered);
+        }
+      }
+      ImGui::TreePop();
     }
+    ImGui::End();
+  }
+#endif
 
-    ImGui::SetNextWindowPos(ImVec2(5, 5));
-    ImGui::Begin("FPS", nullptr,
-                 ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoInputs |
-                     ImGuiWindowFlags_NoBringToFrontOnFocus |
+  // GPU time of the scopes of a previous frame
+  if (m_windowSettings.showGPUTimings) {
+    const auto &timings{m_gpuProfiler.getTimings()};
+
+    int windowWidth{};
+    SDL_GetWindowSize(m_window, &windowWidth, nullptr);
+    ImGui::SetNextWindowPos(ImVec2(static_cast<float>(windowWidth) - 5, 5),
+                            ImGuiCond_FirstUseEver, ImVec2(1, 0));
+    ImGui::Begin("GPU", nullptr,
+                 ImGuiWindowFlags_AlwaysAutoResize |
                      ImGuiWindowFlags_NoFocusOnAppearing);
-    std::string label{fmt::format("avg {:.1f} FPS", fps)};
-    ImGui::PlotLines("", &frames[0], static_cast<int>(frames.size()),
-                     static_cast<int>(offset), label.c_str(), 0.0f,
-                     *std::max_element(frames.begin(), frames.end()) * 2,
-                     ImVec2(static_cast<float>(frames.size()), 50));
+    if (!m_gpuProfiler.hasTimerQueries()) {
+      ImGui::TextUnformatted("Timer queries unavailable; using glFinish");
+    }
+
+    // Timeline with one row per nesting level
+    auto frameTime{0.0};
+    auto maxDepth{0};
+    for (const auto &timing : timings) {
+      frameTime = std::max(frameTime, timing.start + timing.duration);
+      maxDepth = std::max(maxDepth, timing.depth);
+    }
+    const auto rowHeight{ImGui::GetTextLineHeightWithSpacing()};
+    const ImVec2 timelineSize{300.0f,
+                              rowHeight * static_cast<float>(maxDepth + 1)};
+    const auto origin{ImGui::GetCursorScreenPos()};
+    ImGui::Dummy(timelineSize);
+    if (frameTime > 0.0) {
+      auto *drawList{ImGui::GetWindowDrawList()};
+      const auto scale{static_cast<double>(timelineSize.x) / frameTime};
+      for (std::size_t index{}; index < timings.size(); ++index) {
+        const auto &timing{timings.at(index)};
+        const auto width{static_cast<float>(timing.duration * scale)};
+        const ImVec2 min{
+            origin.x + static_cast<float>(timing.start * scale),
+            origin.y + rowHeight * static_cast<float>(timing.depth)};
+        const ImVec2 max{min.x + std::max(width, 1.0f),
+                         min.y + rowHeight - 1.0f};
+        const auto hue{static_cast<float>(index) * 0.17f};
+        drawList->AddRectFilled(min, max, ImColor::HSV(hue, 0.6f, 0.6f));
+        drawList->PushClipRect(min, max, true);
+        drawList->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32_WHITE,
+                          timing.name.c_str());
+        drawList->PopClipRect();
+      }
+    }
+
+    for (const auto &timing : timings) {
+      ImGui::Text("%*s%s", timing.depth * 2, "", timing.name.c_str());
+      ImGui::SameLine(160.0f);
+      ImGui::Text("%7.3f ms", timing.duration);
+    }
+    if (const auto dropped{m_gpuProfiler.getDroppedFrames()}; dropped > 0) {
+      ImGui::Text("Dropped frames: %llu",
+                  static_cast<unsigned long long>(dropped));
+    }
+    ImGui::End();
+  }
+
+  // CPU profiler flame graph
+  if (m_windowSettings.showCPUProfile) {
+    if (!m_cpuProfilePaused) m_cpuProfile = abcg::profiler::takeSnapshot();
+
+    int windowWidth{};
+    SDL_GetWindowSize(m_window, &windowWidth, nullptr);
+    ImGui::SetNextWindowPos(ImVec2(static_cast<float>(windowWidth) - 5, 200),
+                            ImGuiCond_FirstUseEver, ImVec2(1, 0));
+    ImGui::Begin("CPU", nullptr,
+                 ImGuiWindowFlags_AlwaysAutoResize |
+                     ImGuiWindowFlags_NoFocusOnAppearing);
+    ImGui::Checkbox("Pause", &m_cpuProfilePaused);
+    ImGui::SameLine();
+    if (ImGui::Button("Export trace")) exportTrace = true;
+    paintFlameGraph(m_cpuProfile);
     ImGui::End();
   }
 
@@ -274,6 +610,25 @@ void abcg::OpenGLWindow::paintUI() {
       ImGui::End();
     }
   }
+
+  if (exportedStatistics) {
+    const auto *const path{"frame_times.csv"};
+    try {
+      exportedStatistics->exportCSV(path);
+      fmt::print("Frame times written to {}\n", path);
+    } catch (const abcg::Exception &exception) {
+      fmt::print(stderr, "{}\n", exception.what());
+    }
+  }
+  if (exportTrace) {
+    const auto *const path{"cpu_trace.json"};
+    try {
+      abcg::profiler::exportChromeTrace(path);
+      fmt::print("CPU trace written to {}\n", path);
+    } catch (const abcg::Exception &exception) {
+      fmt::print(stderr, "{}\n", exception.what());
+    }
+  }
 }
 
 void abcg::OpenGLWindow::resizeGL(int width, int height) {
@@ -282,74 +637,88 @@ void abcg::OpenGLWindow::resizeGL(int width, int height) {
 
 void abcg::OpenGLWindow::terminateGL() {}
 
+/**
+ * @brief Creates a shader program from vertex and fragment shader files.
+ *
+ * `#include` directives are resolved relative to each shader file.
+ *
+ * @param pathToVertexShader Path to the vertex shader source.
+ * @param pathToFragmentShader Path to the fragment shader source.
+ * @return ID of the program object. The caller owns the program.
+ *
+ * @throw abcg::Exception on read, compile or link errors.
+ */
 GLuint abcg::OpenGLWindow::createProgramFromFile(
     std::string_view pathToVertexShader,
     std::string_view pathToFragmentShader) {
-  std::stringstream vertexShaderSource;
-  if (std::ifstream stream(pathToVertexShader.data()); stream) {
-    vertexShaderSource << stream.rdbuf();
-    stream.close();
-  } else {
-    throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
-        "Failed to read vertex shader file {}", pathToVertexShader))};
-  }
-
-  std::stringstream fragmentShaderSource;
-  if (std::ifstream stream(pathToFragmentShader.data()); stream) {
-    fragmentShaderSource << stream.rdbuf();
-    stream.close();
-  } else {
-    throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
-        "Failed to read fragment shader file {}", pathToFragmentShader))};
-  }
-
-  return createProgramFromString(vertexShaderSource.str(),
-                                 fragmentShaderSource.str());
+  const auto program{linkProgram(
+      m_vertexShaderPreprocessor.processFile(pathToVertexShader),
+      m_fragmentShaderPreprocessor.processFile(pathToFragmentShader))};
+#if !defined(__EMSCRIPTEN__)
+  abcg::opengl::setObjectLabel(GL_PROGRAM, program, pathToVertexShader);
+#endif
+  return program;
 }
 
+/**
+ * @brief Creates a shader program from vertex and fragment shader strings.
+ *
+ * `#include` directives are resolved relative to the assets path.
+ *
+ * @param vertexShaderSource Vertex shader source.
+ * @param fragmentShaderSource Fragment shader source.
+ * @return ID of the program object. The caller owns the program.
+ *
+ * @throw abcg::Exception on read, compile or link errors.
+ */
 GLuint abcg::OpenGLWindow::createProgramFromString(
     std::string_view vertexShaderSource,
     std::string_view fragmentShaderSource) {
-  using namespace std::string_literals;
-
-  std::string vsSource{abcg::trimCopy(std::string{vertexShaderSource})};
-#if defined(__EMSCRIPTEN__) || defined(__APPLE__)
-  // Remove version header, if any
-  vsSource =
-      std::regex_replace(vsSource, std::regex("#version.*[\r\n|\n|\r]"), "");
-  // Add new header
-  vsSource = m_GLSLVersion + "\n" + vsSource;
-#else
-  // Add version header only if missing
-  if (!vsSource.starts_with("#version"))
-    vsSource = m_GLSLVersion + "\n\n" + vsSource;
-#endif
+  return linkProgram(m_vertexShaderPreprocessor.processString(
+                         vertexShaderSource, {}, m_assetsPath),
+                     m_fragmentShaderPreprocessor.processString(
+                         fragmentShaderSource, {}, m_assetsPath));
+}
 
-  std::string fsSource{abcg::trimCopy(std::string{fragmentShaderSource})};
-#if defined(__EMSCRIPTEN__) || defined(__APPLE__)
-  // Remove version header, if any
-  fsSource =
-      std::regex_replace(fsSource, std::regex("#version.*[\r\n|\n|\r]"), "");
-
-  if (m_openGLSettings.profile == OpenGLProfile::ES) {
-    // c++20
-    // if (auto regex{std::regex("^precision.*float$", std::multiline)};
-    if (auto regex{std::regex("(^|\r\n|\n|\r)precision.*float")};
-        !std::regex_search(fsSource, regex)) {
-      fsSource = "precision mediump float;\n" + fsSource;
-    }
-  }
-  // Add new header
-  fsSource = m_GLSLVersion + "\n" + fsSource;
-#else
-  // Add version header only if missing
-  if (!fsSource.starts_with("#version")) {
-    if (m_openGLSettings.profile == OpenGLProfile::ES)
-      fsSource = "precision mediump float;\n\n" + fsSource;
-    fsSource = m_GLSLVersion + "\n\n" + fsSource;
+/**
+ * @brief Returns a compile-time variant of a shader program.
+ *
+ * The definitions are injected into both shaders after the version header.
+ * Programs are cached by (paths, defines) key, so requesting the same variant
+ * again does not read, preprocess or compile the shaders.
+ *
+ * @param pathToVertexShader Path to the vertex shader source.
+ * @param pathToFragmentShader Path to the fragment shader source.
+ * @param defines Set of preprocessor definitions.
+ * @return ID of the program object. The program is owned by the window and
+ * is deleted after terminateGL, so it must not be deleted by the caller.
+ *
+ * @throw abcg::Exception on read, compile or link errors.
+ */
+GLuint abcg::OpenGLWindow::getProgramVariant(
+    std::string_view pathToVertexShader, std::string_view pathToFragmentShader,
+    const ShaderDefines &defines) {
+  auto key{fmt::format("{}\n{}\n{}", pathToVertexShader, pathToFragmentShader,
+                       toCacheKey(defines))};
+  if (auto it{m_programVariants.find(key)}; it != m_programVariants.end()) {
+    return it->second;
   }
+
+  const auto program{linkProgram(
+      m_vertexShaderPreprocessor.processFile(pathToVertexShader, defines),
+      m_fragmentShaderPreprocessor.processFile(pathToFragmentShader,
+                                               defines))};
+#if !defined(__EMSCRIPTEN__)
+  abcg::opengl::setObjectLabel(
+      GL_PROGRAM, program,
+      fmt::format("{} {}", pathToVertexShader, toCacheKey(defines)));
 #endif
+  m_programVariants.emplace(std::move(key), program);
+  return program;
+}
 
+GLuint abcg::OpenGLWindow::linkProgram(const std::string &vsSource,
+                                       const std::string &fsSource) {
   GLint compileStatus{};
   GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
   const char *vsSourceConstChar = vsSource.c_str();
@@ -402,7 +771,81 @@ double abcg::OpenGLWindow::getElapsedTime() const {
   return m_windowStartTime.elapsed();
 }
 
+/**
+ * @brief Returns the interpolation factor between the last two simulation
+ * states.
+ *
+ * @return Fraction of a fixed time step elapsed since the last call to
+ * fixedUpdate, in [0, 1).
+ */
+double abcg::OpenGLWindow::getInterpolationAlpha() const noexcept {
+  return m_interpolationAlpha;
+}
+
+/**
+ * @brief Returns the buffer to be read by paintGL.
+ *
+ * @return Index of the buffer written by publishFrame for the frame being
+ * painted.
+ */
+int abcg::OpenGLWindow::getPaintSlot() const noexcept { return m_paintSlot; }
+
+/**
+ * @brief Returns the framebuffer painted by paintGL.
+ *
+ * Passes that render to textures must bind this framebuffer back, instead of
+ * framebuffer 0, before drawing the final image.
+ *
+ * @return ID of the offscreen framebuffer in headless mode, 0 otherwise.
+ */
+GLuint abcg::OpenGLWindow::getDefaultFramebuffer() const noexcept {
+  return m_offscreenFramebuffer;
+}
+
+/**
+ * @brief Returns the GPU profiler of the window.
+ *
+ * Scopes opened with abcg::GPUScope in paintGL are nested in the "paintGL"
+ * scope and shown in the GPU timings overlay
+ * (abcg::WindowSettings::showGPUTimings). With a render thread, it must only
+ * be used in paintGL.
+ *
+ * @return Reference to the profiler.
+ */
+abcg::GPUProfiler &abcg::OpenGLWindow::getGPUProfiler() noexcept {
+  return m_gpuProfiler;
+}
+
+/**
+ * @brief Returns the sampler objects of the window.
+ *
+ * Samplers are deleted after terminateGL. With a render thread, samplers
+ * must be requested in initializeGL or paintGL, where the context is
+ * current.
+ *
+ * @return Reference to the sampler cache.
+ */
+abcg::SamplerCache &abcg::OpenGLWindow::getSamplerCache() noexcept {
+  return m_samplerCache;
+}
+
+/**
+ * @brief Returns the frame time statistics of the window.
+ *
+ * Every frame records its CPU time, present interval and, when measured, GPU
+ * time. GPU times are measured if timer queries are available and the FPS
+ * overlay is shown, or while the GPU timings overlay is shown. With a render
+ * thread, statistics are recorded by the render thread, so they must only be
+ * used in paintGL.
+ *
+ * @return Reference to the statistics.
+ */
+abcg::FrameStatistics &abcg::OpenGLWindow::getFrameStatistics() noexcept {
+  return m_frameStatistics;
+}
+
 void abcg::OpenGLWindow::toggleFullscreen() {
+  if (m_headless) return;
 #if defined(__EMSCRIPTEN__)
   EM_ASM(toggleFullscreen(););
 #else
@@ -431,9 +874,14 @@ void abcg::OpenGLWindow::toggleFullscreen() {
 }
 
 void abcg::OpenGLWindow::handleEvent(SDL_Event &event, bool &done) {
+  ImGui::SetCurrentContext(m_imGuiContext);
   ImGui_ImplSDL2_ProcessEvent(&event);
 
   if (event.window.windowID == m_windowID) {
+    // ImGui needs a few frames to settle after input (e.g. hovering, popups)
+    const auto framesAfterEvent{3};
+    m_pendingFrames = std::max(m_pendingFrames, framesAfterEvent);
+
     if (event.type == SDL_WINDOWEVENT) {
       if (event.window.event == SDL_WINDOWEVENT_CLOSE) {
         done = true;
@@ -445,7 +893,8 @@ void abcg::OpenGLWindow::handleEvent(SDL_Event &event, bool &done) {
             (newWidth != m_viewportWidth || newHeight != m_viewportHeight)) {
           m_viewportWidth = newWidth;
           m_viewportHeight = newHeight;
-          resizeGL(newWidth, newHeight);
+          // The render thread calls resizeGL before painting the next frame
+          if (!m_renderThread.joinable()) resizeGL(newWidth, newHeight);
         }
       }
       if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
@@ -463,7 +912,9 @@ void abcg::OpenGLWindow::handleEvent(SDL_Event &event, bool &done) {
 #endif
         m_viewportWidth = event.window.data1;
         m_viewportHeight = event.window.data2;
-        resizeGL(event.window.data1, event.window.data2);
+        if (!m_renderThread.joinable()) {
+          resizeGL(event.window.data1, event.window.data2);
+        }
       }
     }
     if (event.type == SDL_KEYUP) {
@@ -503,6 +954,8 @@ void abcg::OpenGLWindow::handleEvent(SDL_Event &event, bool &done) {
 
 void abcg::OpenGLWindow::initialize(std::string_view basePath) {
   m_deltaTime.restart();
+  m_presentTimer.restart();
+  m_simulationTimer.restart();
   m_windowStartTime.restart();
 
   m_assetsPath = std::string(basePath) + "/assets/";
@@ -539,16 +992,24 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
   m_GLSLVersion +=
       fmt::format("#version {:d}{:02d}", majorVersion, minorVersion * 10);
 
+#if defined(ABCG_GL_DEBUG_OUTPUT)
+  // GL_KHR_debug messages are only guaranteed in a debug context
+  const int debugContextFlag{SDL_GL_CONTEXT_DEBUG_FLAG};
+#else
+  const int debugContextFlag{0};
+#endif
+
   switch (profile) {
     case OpenGLProfile::Core:
-      SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS,
-                          SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG);
+      SDL_GL_SetAttribute(
+          SDL_GL_CONTEXT_FLAGS,
+          SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG | debugContextFlag);
       SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
                           SDL_GL_CONTEXT_PROFILE_CORE);
       m_GLSLVersion += " core";
       break;
     case OpenGLProfile::Compatibility:
-      SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, 0);
+      SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, debugContextFlag);
       SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
                           SDL_GL_CONTEXT_PROFILE_COMPATIBILITY);
       m_GLSLVersion += " compatibility";
@@ -556,19 +1017,35 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
     case OpenGLProfile::ES:
       majorVersion = 3;
       minorVersion = 0;
-      SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, 0);
+      SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, debugContextFlag);
       SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
                           SDL_GL_CONTEXT_PROFILE_ES);
       m_GLSLVersion = "#version 300 es";
       break;
   }
+#if defined(__EMSCRIPTEN__) || defined(__APPLE__)
+  // Always replace the version header, if any
+  const bool keepExistingVersion{false};
+#else
+  // Add version header only if missing
+  const bool keepExistingVersion{true};
+#endif
+  m_vertexShaderPreprocessor.setVersionHeader(m_GLSLVersion,
+                                              keepExistingVersion);
+  m_fragmentShaderPreprocessor.setVersionHeader(m_GLSLVersion,
+                                                keepExistingVersion);
+  if (profile == OpenGLProfile::ES) {
+    m_fragmentShaderPreprocessor.setDefaultPrecision(
+        "precision mediump float;");
+  }
+
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, majorVersion);
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, minorVersion);
 
   SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
   SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, m_openGLSettings.depthBufferSize);
   SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, m_openGLSettings.stencilSize);
-  if (m_openGLSettings.samples > 0) {
+  if (m_openGLSettings.samples > 0 && !m_headless) {
     // Enable multisample
     SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
     // can be 2, 4, 8 or 16
@@ -577,11 +1054,14 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
     SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 0);
   }
 
-  // Create window with graphics context
+  // Create window with graphics context. In headless mode, the window of the
+  // offscreen video driver only provides the context
+  Uint32 windowFlags{SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE};
+  if (m_headless) windowFlags = SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN;
   m_window = SDL_CreateWindow(m_windowSettings.title.c_str(),
                               SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
                               m_windowSettings.width, m_windowSettings.height,
-                              SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+                              windowFlags);
   if (m_window == nullptr) {
     throw abcg::Exception{abcg::Exception::SDL("SDL_CreateWindow failed")};
   }
@@ -593,17 +1073,43 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
 #endif
 
   // Create OpenGL context
+  if (m_sharedContext != nullptr) {
+    if (m_sharedContext->context == nullptr) {
+      // Created with the attributes of the first window
+      m_sharedContext->window = SDL_CreateWindow(
+          "", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1, 1,
+          SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+      if (m_sharedContext->window == nullptr) {
+        throw abcg::Exception{abcg::Exception::SDL("SDL_CreateWindow failed")};
+      }
+      m_sharedContext->context = SDL_GL_CreateContext(m_sharedContext->window);
+      if (m_sharedContext->context == nullptr) {
+        throw abcg::Exception{
+            abcg::Exception::SDL("SDL_GL_CreateContext failed")};
+      }
+    }
+    SDL_GL_MakeCurrent(m_sharedContext->window, m_sharedContext->context);
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+  }
   m_GLContext = SDL_GL_CreateContext(m_window);
+  SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
   if (m_GLContext == nullptr) {
     throw abcg::Exception{abcg::Exception::SDL("SDL_GL_CreateContext failed")};
   }
+  abcg::opengl::setCurrentStateCache(&m_stateCache);
 
 #if !defined(__EMSCRIPTEN__)
   SDL_GL_SetSwapInterval(m_openGLSettings.vsync ? 1 : 0);  // Disable vsync
 #endif
 
 #if !defined(__EMSCRIPTEN__)
-  if (GLenum err{glewInit()}; GLEW_OK != err) {
+  GLenum err{glewInit()};
+#if defined(GLEW_ERROR_NO_GLX_DISPLAY)
+  // GLEW built for GLX loads the core functions of EGL contexts too, but
+  // fails afterwards looking for a GLX display
+  if (m_headless && err == GLEW_ERROR_NO_GLX_DISPLAY) err = GLEW_OK;
+#endif
+  if (GLEW_OK != err) {
     std::string header{"Failed to initialize OpenGL loader: "};
     const auto *const message{
         reinterpret_cast<const char *>(glewGetErrorString(err))};
@@ -612,14 +1118,22 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
   fmt::print("Using GLEW.....: {}\n", glewGetString(GLEW_VERSION));
 #endif
 
+  abcg::opengl::enableDebugOutput(m_openGLSettings.synchronousDebugOutput);
+  m_gpuProfiler.create();
+  if (m_headless) createOffscreenFramebuffer();
+
   fmt::print("OpenGL vendor..: {}\n", glGetString(GL_VENDOR));
   fmt::print("OpenGL renderer: {}\n", glGetString(GL_RENDERER));
   fmt::print("OpenGL version.: {}\n", glGetString(GL_VERSION));
+  m_renderer = fmt::format("{} / {}", glGetString(GL_RENDERER),
+                           glGetString(GL_VERSION));
   fmt::print("GLSL version...: {}\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
 
   // Setup Dear ImGui context
   IMGUI_CHECKVERSION();
-  ImGui::CreateContext();
+  m_imGuiContext = ImGui::CreateContext(
+      m_sharedContext != nullptr ? &m_sharedContext->fontAtlas : nullptr);
+  ImGui::SetCurrentContext(m_imGuiContext);
   ImGuiIO &io{ImGui::GetIO()};
   // Enable Keyboard Controls
   io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
@@ -638,18 +1152,34 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
   ImGui_ImplSDL2_InitForOpenGL(m_window, m_GLContext);
   ImGui_ImplOpenGL3_Init(m_GLSLVersion.c_str());
 
-  // Load fonts
-  io.Fonts->Clear();
+  // Load fonts, only once if the atlas is shared
+  if (m_sharedContext == nullptr || !m_sharedContext->fontsLoaded) {
+    io.Fonts->Clear();
+
+    ImFontConfig fontConfig;
+    fontConfig.FontDataOwnedByAtlas = false;
+    if (std::array ttf{INCONSOLATA_MEDIUM_TTF};
+        io.Fonts->AddFontFromMemoryTTF(ttf.data(), ttf.size(), 16.0f,
+                                       &fontConfig) == nullptr) {
+      throw abcg::Exception{
+          abcg::Exception::Runtime("Failed to load font file")};
+    }
+    if (m_sharedContext != nullptr) m_sharedContext->fontsLoaded = true;
+  }
 
-  ImFontConfig fontConfig;
-  fontConfig.FontDataOwnedByAtlas = false;
-  if (std::array ttf{INCONSOLATA_MEDIUM_TTF};
-      io.Fonts->AddFontFromMemoryTTF(ttf.data(), ttf.size(), 16.0f,
-                                     &fontConfig) == nullptr) {
-    throw abcg::Exception{abcg::Exception::Runtime("Failed to load font file")};
+  if (!m_openGLSettings.captureFile.empty()) {
+    abcg::opengl::beginCapture(
+        m_openGLSettings.captureFile,
+        {.profile = static_cast<std::int32_t>(m_openGLSettings.profile),
+         .majorVersion = m_openGLSettings.majorVersion,
+         .minorVersion = m_openGLSettings.minorVersion,
+         .width = m_windowSettings.width,
+         .height = m_windowSettings.height,
+         .frames = m_openGLSettings.captureFrames});
   }
 
   initializeGL();
+  abcg::opengl::captureSetupEnd();
 
   if (io.DisplaySize.x >= 0 && io.DisplaySize.y >= 0) {
     int width{static_cast<int>(io.DisplaySize.x)};
@@ -660,10 +1190,35 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
   } else {
     resizeGL(m_windowSettings.width, m_windowSettings.height);
   }
+
+#if !defined(__EMSCRIPTEN__)
+  if (m_openGLSettings.renderThread) {
+    // Create the ImGui device objects while the context is current here
+    ImGui_ImplOpenGL3_NewFrame();
+    m_renderWidth = m_viewportWidth;
+    m_renderHeight = m_viewportHeight;
+    SDL_GL_MakeCurrent(m_window, nullptr);
+    abcg::opengl::setCurrentStateCache(nullptr);
+    m_capture = abcg::opengl::getCurrentCapture();
+    abcg::opengl::setCurrentCapture(nullptr);
+    m_renderThread = std::thread{&OpenGLWindow::renderLoop, this};
+  }
+#endif
 }
 
 void abcg::OpenGLWindow::paint() {
-  SDL_GL_MakeCurrent(m_window, m_GLContext);
+  ABCG_PROFILE_SCOPE("OpenGLWindow::paint");
+  const ElapsedTimer cpuTimer;
+  m_pendingFrames = std::max(m_pendingFrames - 1, 0);
+  if (m_windowStartTime.elapsed() >= m_repaintTime) {
+    m_repaintTime = std::numeric_limits<double>::infinity();
+  }
+  const auto threaded{m_renderThread.joinable()};
+  ImGui::SetCurrentContext(m_imGuiContext);
+  if (!threaded) {
+    SDL_GL_MakeCurrent(m_window, m_GLContext);
+    abcg::opengl::setCurrentStateCache(&m_stateCache);
+  }
 
 #if defined(__EMSCRIPTEN__)
   // Force window size in windowed mode
@@ -675,18 +1230,438 @@ void abcg::OpenGLWindow::paint() {
   }
 #endif
 
-  ImGui_ImplOpenGL3_NewFrame();
+  advanceSimulation();
+
+  if (!threaded) ImGui_ImplOpenGL3_NewFrame();
   ImGui_ImplSDL2_NewFrame(m_window);
   ImGui::NewFrame();
-  paintUI();
-  ImGui::Render();
-  paintGL();
-  ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-  SDL_GL_SwapWindow(m_window);
-
-  // Cap to 480 Hz
-  if (m_deltaTime.elapsed() >= 1.0 / 480.0) {
-    m_lastDeltaTime = m_deltaTime.restart();
-  } else
-    m_lastDeltaTime = 0.0;
-}
\ No newline at end of file
+  {
+    ABCG_PROFILE_SCOPE("paintUI");
+    paintUI();
+    ImGui::Render();
+  }
+  if (m_windowSettings.renderOnDemand && ImGui::GetIO().WantTextInput) {
+    // Text cursor blinking
+    requestRepaint(0.5);
+  }
+
+  if (threaded) {
+    submitFrame(cpuTimer);
+  } else {
+    publishFrame(0);
+    auto &slot{m_frameSlots.at(0)};
+    prepareFrameSlot(slot, cpuTimer.elapsed());
+    presentFrame(slot, ImGui::GetDrawData());
+  }
+
+  // The frame rate is limited by abcg::Application, so every frame advances
+  m_lastDeltaTime = m_deltaTime.restart();
+}
+
+// Publishes the frame to the free slot and wakes up the render thread.
+// Waits while both slots are in use, i.e., while the render thread is more
+// than one frame behind
+void abcg::OpenGLWindow::submitFrame(const ElapsedTimer &cpuTimer) {
+  auto &slot{m_frameSlots.at(static_cast<std::size_t>(m_publishSlot))};
+  auto waitTime{0.0};
+  {
+    ABCG_PROFILE_SCOPE("Wait for render thread");
+    const ElapsedTimer waitTimer;
+    std::unique_lock lock{m_renderMutex};
+    m_renderCondition.wait(
+        lock, [&] { return !slot.ready || m_renderException != nullptr; });
+    if (m_renderException != nullptr) {
+      std::rethrow_exception(m_renderException);
+    }
+    waitTime = waitTimer.elapsed();
+  }
+
+  publishFrame(m_publishSlot);
+
+  // Deep copy of the draw data, reusing the lists of the slot
+  const auto &drawData{*ImGui::GetDrawData()};
+  const auto numLists{static_cast<std::size_t>(drawData.CmdListsCount)};
+  while (slot.drawLists.size() < numLists) {
+    slot.drawLists.push_back(
+        std::make_unique<ImDrawList>(ImGui::GetDrawListSharedData()));
+  }
+  slot.drawListPointers.clear();
+  const gsl::span sourceLists{drawData.CmdLists, numLists};
+  for (std::size_t index{}; index < numLists; ++index) {
+    const auto &source{*sourceLists[index]};
+    auto &destination{*slot.drawLists.at(index)};
+    copyImVector(destination.CmdBuffer, source.CmdBuffer);
+    copyImVector(destination.IdxBuffer, source.IdxBuffer);
+    copyImVector(destination.VtxBuffer, source.VtxBuffer);
+    destination.Flags = source.Flags;
+    slot.drawListPointers.push_back(&destination);
+  }
+  slot.drawData = drawData;
+  slot.drawData.CmdLists = slot.drawListPointers.data();
+
+  prepareFrameSlot(slot, cpuTimer.elapsed() - waitTime);
+  {
+    const std::lock_guard lock{m_renderMutex};
+    slot.ready = true;
+  }
+  m_renderCondition.notify_all();
+  m_publishSlot = 1 - m_publishSlot;
+}
+
+// Body of the render thread: paints the published frames in order until
+// stopRenderThread is called
+void abcg::OpenGLWindow::renderLoop() {
+  abcg::profiler::setThreadName("Render");
+  try {
+    if (SDL_GL_MakeCurrent(m_window, m_GLContext) != 0) {
+      throw abcg::Exception{abcg::Exception::SDL("SDL_GL_MakeCurrent failed")};
+    }
+    abcg::opengl::setCurrentStateCache(&m_stateCache);
+    abcg::opengl::setCurrentCapture(m_capture);
+    while (true) {
+      auto &slot{m_frameSlots.at(static_cast<std::size_t>(m_paintSlot))};
+      {
+        std::unique_lock lock{m_renderMutex};
+        m_renderCondition.wait(lock,
+                               [&] { return slot.ready || m_stopRendering; });
+        if (m_stopRendering) break;
+      }
+
+      if (slot.viewportWidth != m_renderWidth ||
+          slot.viewportHeight != m_renderHeight) {
+        m_renderWidth = slot.viewportWidth;
+        m_renderHeight = slot.viewportHeight;
+        resizeGL(m_renderWidth, m_renderHeight);
+      }
+      presentFrame(slot, &slot.drawData);
+
+      {
+        const std::lock_guard lock{m_renderMutex};
+        slot.ready = false;
+      }
+      m_renderCondition.notify_all();
+      m_paintSlot = 1 - m_paintSlot;
+    }
+  } catch (...) {
+    {
+      const std::lock_guard lock{m_renderMutex};
+      m_renderException = std::current_exception();
+    }
+    m_renderCondition.notify_all();
+  }
+  SDL_GL_MakeCurrent(m_window, nullptr);
+  abcg::opengl::setCurrentStateCache(nullptr);
+  abcg::opengl::endCapture();
+}
+
+// Returns whether the render thread is still painting the frame published
+// two frames ago, in which case paint would block
+bool abcg::OpenGLWindow::isRenderThreadBusy() {
+  if (!m_renderThread.joinable()) return false;
+  const std::lock_guard lock{m_renderMutex};
+  return m_frameSlots.at(static_cast<std::size_t>(m_publishSlot)).ready &&
+         m_renderException == nullptr;
+}
+
+// Waits until the render thread, if any, has painted every published frame
+void abcg::OpenGLWindow::waitForRenderThread() {
+  if (!m_renderThread.joinable()) return;
+  std::unique_lock lock{m_renderMutex};
+  m_renderCondition.wait(lock, [&] {
+    return std::none_of(m_frameSlots.begin(), m_frameSlots.end(),
+                        [](const auto &slot) { return slot.ready; }) ||
+           m_renderException != nullptr;
+  });
+  if (m_renderException != nullptr) std::rethrow_exception(m_renderException);
+}
+
+// Joins the render thread, if any. The context is left current on no thread
+void abcg::OpenGLWindow::stopRenderThread() {
+  if (!m_renderThread.joinable()) return;
+  {
+    const std::lock_guard lock{m_renderMutex};
+    m_stopRendering = true;
+  }
+  m_renderCondition.notify_all();
+  m_renderThread.join();
+}
+
+// Sets the data of the frame other than the draw data and the state
+// published by the window
+void abcg::OpenGLWindow::prepareFrameSlot(FrameSlot &slot, double cpuTime) {
+  slot.number = m_frameNumber++;
+  slot.cpuTime = cpuTime;
+  // Timer queries are cheap enough to be used for the frame statistics;
+  // the glFinish fallback is used only on request
+  slot.measureGPU = m_windowSettings.showGPUTimings ||
+                    ((m_windowSettings.showFPS || m_benchmarking) &&
+                     m_gpuProfiler.hasTimerQueries());
+  slot.viewportWidth = m_viewportWidth;
+  slot.viewportHeight = m_viewportHeight;
+  slot.screenshotPath = std::exchange(m_screenshotPath, {});
+}
+
+// Paints, presents and records the statistics of a frame, on the thread that
+// owns the context
+void abcg::OpenGLWindow::presentFrame(const FrameSlot &slot,
+                                      ImDrawData *drawData) {
+  const ElapsedTimer cpuTimer;
+  if (slot.measureGPU) {
+    // Reads the timings of an earlier frame
+    const std::lock_guard lock{m_statisticsMutex};
+    m_gpuProfiler.beginFrame(slot.number);
+  }
+  if (m_headless) glBindFramebuffer(GL_FRAMEBUFFER, m_offscreenFramebuffer);
+  render(drawData);
+  checkFrameGLErrors(drawData);
+  abcg::opengl::endStatsFrame();
+#if defined(ABCG_GL_STATS)
+  {
+    const std::lock_guard lock{m_statisticsMutex};
+    m_glStats = abcg::opengl::getFrameStats();
+    abcg::opengl::addFrameStats(m_glStatsTotal, m_glStats);
+    ++m_glStatsFrames;
+  }
+#endif
+  abcg::opengl::captureFrameEnd();
+  if (!slot.screenshotPath.empty()) saveScreenshot(slot.screenshotPath);
+  // With a render thread, the frame takes as long as the slower thread
+  const auto cpuTime{m_renderThread.joinable()
+                         ? std::max(slot.cpuTime, cpuTimer.elapsed())
+                         : slot.cpuTime + cpuTimer.elapsed()};
+  {
+    ABCG_PROFILE_SCOPE("Swap");
+    GPUScope scope{m_gpuProfiler, "Swap"};
+    if (m_headless) {
+      // Nothing to present; submit the frame as a swap would
+      glFlush();
+    } else {
+      SDL_GL_SwapWindow(m_window);
+    }
+  }
+
+  const std::lock_guard lock{m_statisticsMutex};
+  m_gpuProfiler.endFrame();
+  recordFrameStatistics(slot.number, cpuTime);
+}
+
+void abcg::OpenGLWindow::advanceSimulation() {
+  const auto elapsed{m_simulationTimer.restart() *
+                     m_windowSettings.simulationSpeed};
+  const auto timeStep{m_windowSettings.fixedTimeStep};
+  if (timeStep <= 0.0) return;
+
+  ABCG_PROFILE_SCOPE("fixedUpdate");
+  m_accumulator += elapsed;
+  auto steps{0};
+  while (m_accumulator >= timeStep && steps < m_windowSettings.maxFixedSteps) {
+    fixedUpdate(timeStep);
+    m_accumulator -= timeStep;
+    ++steps;
+  }
+  if (m_accumulator >= timeStep) {
+    m_accumulator = std::fmod(m_accumulator, timeStep);
+  }
+  m_interpolationAlpha = m_accumulator / timeStep;
+}
+
+// Returns the time in seconds until the window must be painted: 0 if it must
+// be painted now, or infinity if it waits for events
+double abcg::OpenGLWindow::getTimeToRepaint() const {
+  if (!m_windowSettings.renderOnDemand || m_pendingFrames > 0) return 0.0;
+  return std::max(m_repaintTime - m_windowStartTime.elapsed(), 0.0);
+}
+
+// Discards the statistics recorded so far and keeps the next frames,
+// including the OpenGL counters, for getBenchmarkResult
+void abcg::OpenGLWindow::startMeasurement(std::size_t frames) {
+  waitForRenderThread();
+  const std::lock_guard lock{m_statisticsMutex};
+  m_frameStatistics.setCapacity(frames);
+  m_frameStatistics.clear();
+  m_glStatsTotal = {};
+  m_glStatsFrames = 0;
+}
+
+abcg::BenchmarkResult abcg::OpenGLWindow::getBenchmarkResult(
+    double elapsedTime) {
+  waitForRenderThread();
+  const std::lock_guard lock{m_statisticsMutex};
+  const auto &statistics{m_frameStatistics};
+  return {.title = m_windowSettings.title,
+          .renderer = m_renderer,
+          .renderThread = m_renderThread.joinable(),
+          .elapsedTime = elapsedTime,
+          .presentInterval =
+              statistics.getPercentiles(FrameMetric::PresentInterval),
+          .cpuTime = statistics.getPercentiles(FrameMetric::CPUTime),
+          .gpuTime = statistics.getPercentiles(FrameMetric::GPUTime),
+          .budget = statistics.getBudget(),
+          .overBudget = statistics.countOverBudget(),
+          .glStats = m_glStatsTotal,
+          .glStatsFrames = m_glStatsFrames};
+}
+
+void abcg::OpenGLWindow::recordFrameStatistics(std::uint64_t number,
+                                               double cpuTime) {
+  m_frameStatistics.addSample(
+      {.frame = number,
+       .cpuTime = cpuTime * 1000.0,
+       .presentInterval = m_presentTimer.restart() * 1000.0});
+
+  // GPU time of an earlier frame, excluding the buffer swap
+  const auto &timings{m_gpuProfiler.getTimings()};
+  if (timings.empty()) return;
+  auto gpuTime{0.0};
+  for (const auto &timing : timings) {
+    if (timing.depth == 0 && timing.name != "Swap") gpuTime += timing.duration;
+  }
+  m_frameStatistics.setGPUTime(m_gpuProfiler.getTimingsFrame(), gpuTime);
+}
+
+void abcg::OpenGLWindow::render(ImDrawData *drawData) {
+  {
+    abcg::opengl::DebugGroup group{"paintGL"};
+    ABCG_PROFILE_SCOPE("paintGL");
+    GPUScope scope{m_gpuProfiler, "paintGL"};
+    paintGL();
+  }
+  {
+    abcg::opengl::DebugGroup group{"ImGui"};
+    ABCG_PROFILE_SCOPE("ImGui");
+    GPUScope scope{m_gpuProfiler, "ImGui"};
+    std::unique_lock<std::mutex> lock;
+    if (m_sharedContext != nullptr) {
+      lock = std::unique_lock{m_sharedContext->imGuiMutex};
+    }
+    ImGui_ImplOpenGL3_RenderDrawData(drawData);
+    // The ImGui renderer calls OpenGL directly
+    m_stateCache.invalidate();
+  }
+}
+
+// Checks the OpenGL errors raised during the frame, as set by
+// abcg::setGLErrorCheckPolicy
+void abcg::OpenGLWindow::checkFrameGLErrors(
+    [[maybe_unused]] ImDrawData *drawData) {
+#if defined(ABCG_GL_ERROR_CHECK)
+  const auto policy{abcg::getGLErrorCheckPolicy()};
+  // Wrappers already check every call
+  if (policy == GLErrorCheckPolicy::EveryCall) return;
+
+  const auto error{abcg::pollGLErrors()};
+  if (error == GL_NO_ERROR) return;
+
+  if (policy != GLErrorCheckPolicy::Bisect) {
+    throw abcg::Exception{abcg::Exception::OpenGL("AT END OF FRAME", error)};
+  }
+
+  // Paint the frame again with full checking so that the wrappers throw at
+  // the offending call. Side effects of paintGL happen twice in this frame.
+  fmt::print(stderr, "OpenGL error found at end of frame; repainting with "
+                     "full error checking\n");
+  abcg::setGLErrorCheckPolicy(GLErrorCheckPolicy::EveryCall);
+  render(drawData);
+  abcg::setGLErrorCheckPolicy(GLErrorCheckPolicy::Bisect);
+  if (const auto repeated{abcg::pollGLErrors()}; repeated != GL_NO_ERROR) {
+    // Raised by calls that do not go through the wrappers (e.g. ImGui)
+    throw abcg::Exception{
+        abcg::Exception::OpenGL("OUTSIDE WRAPPED CALLS", repeated)};
+  }
+  fmt::print(stderr, "OpenGL error could not be reproduced\n");
+#endif
+}
+
+// Creates the framebuffer painted in headless mode, with the size of the
+// window and the depth and stencil sizes of the settings. Multisampling is
+// not used
+void abcg::OpenGLWindow::createOffscreenFramebuffer() {
+  const auto width{m_windowSettings.width};
+  const auto height{m_windowSettings.height};
+
+  glGenRenderbuffers(1, &m_offscreenColorbuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, m_offscreenColorbuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+  const auto hasStencil{m_openGLSettings.stencilSize > 0};
+  if (m_openGLSettings.depthBufferSize > 0 || hasStencil) {
+    glGenRenderbuffers(1, &m_offscreenDepthbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_offscreenDepthbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER,
+                          hasStencil ? GL_DEPTH24_STENCIL8
+                                     : GL_DEPTH_COMPONENT24,
+                          width, height);
+  }
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &m_offscreenFramebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_offscreenFramebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, m_offscreenColorbuffer);
+  if (m_offscreenDepthbuffer != 0) {
+    glFramebufferRenderbuffer(
+        GL_FRAMEBUFFER,
+        hasStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+        GL_RENDERBUFFER, m_offscreenDepthbuffer);
+  }
+  if (const auto status{glCheckFramebufferStatus(GL_FRAMEBUFFER)};
+      status != GL_FRAMEBUFFER_COMPLETE) {
+    throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
+        "Offscreen framebuffer incomplete (status {:#x})", status))};
+  }
+  abcg::opengl::setObjectLabel(GL_FRAMEBUFFER, m_offscreenFramebuffer,
+                               "Offscreen framebuffer");
+  fmt::print("Headless.......: {}x{} offscreen framebuffer\n", width, height);
+}
+
+void abcg::OpenGLWindow::destroyOffscreenFramebuffer() {
+  if (m_offscreenFramebuffer != 0) {
+    glDeleteFramebuffers(1, &m_offscreenFramebuffer);
+    m_offscreenFramebuffer = 0;
+  }
+  for (auto *renderbuffer :
+       {&m_offscreenColorbuffer, &m_offscreenDepthbuffer}) {
+    if (*renderbuffer != 0) {
+      glDeleteRenderbuffers(1, renderbuffer);
+      *renderbuffer = 0;
+    }
+  }
+}
+
+// Saves the color buffer being painted to a PNG file
+void abcg::OpenGLWindow::saveScreenshot(const std::string &path) {
+  int width{m_windowSettings.width};
+  int height{m_windowSettings.height};
+  if (!m_headless) SDL_GL_GetDrawableSize(m_window, &width, &height);
+  if (width <= 0 || height <= 0) return;
+
+  const auto pitch{static_cast<std::size_t>(width) * 4};
+  std::vector<unsigned char> pixels(pitch * static_cast<std::size_t>(height));
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+  // OpenGL rows go from bottom to top
+  for (std::size_t top{}, bottom{static_cast<std::size_t>(height) - 1};
+       top < bottom; ++top, --bottom) {
+    std::swap_ranges(pixels.begin() + static_cast<std::ptrdiff_t>(top * pitch),
+                     pixels.begin() +
+                         static_cast<std::ptrdiff_t>((top + 1) * pitch),
+                     pixels.begin() +
+                         static_cast<std::ptrdiff_t>(bottom * pitch));
+  }
+
+  auto *surface{SDL_CreateRGBSurfaceWithFormatFrom(
+      pixels.data(), width, height, 32, static_cast<int>(pitch),
+      SDL_PIXELFORMAT_RGBA32)};
+  if (surface == nullptr) {
+    throw abcg::Exception{
+        abcg::Exception::SDL("SDL_CreateRGBSurfaceWithFormatFrom failed")};
+  }
+  const auto result{IMG_SavePNG(surface, path.c_str())};
+  SDL_FreeSurface(surface);
+  if (result != 0) {
+    throw abcg::Exception{abcg::Exception::SDLImage(
+        fmt::format("Failed to save screenshot {}", path))};
+  }
+  fmt::print("Screenshot written to {}\n", path);
+}
@@ -10,16 +10,37 @@
 #ifndef ABCG_OPENGLWINDOW_HPP_
 #define ABCG_OPENGLWINDOW_HPP_
 
+#include <imgui.h>
+
+#include <array>
+#include <condition_variable>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
+#include "abcg_benchmark.hpp"
+#include "abcg_cpuprofiler.hpp"
 #include "abcg_elapsedtimer.hpp"
 #include "abcg_external.hpp"
+#include "abcg_framestatistics.hpp"
+#include "abcg_glcapture.hpp"
+#include "abcg_gpuprofiler.hpp"
+#include "abcg_openglstate.hpp"
+#include "abcg_openglstats.hpp"
+#include "abcg_samplercache.hpp"
+#include "abcg_shaderpreprocessor.hpp"
 
 namespace abcg {
 enum class OpenGLProfile;
 class Application;
 class OpenGLWindow;
 struct OpenGLSettings;
+struct SharedContext;
 struct WindowSettings;
 #if defined(__EMSCRIPTEN__)
 EM_BOOL fullscreenchangeCallback(int eventType,
@@ -43,16 +64,66 @@ struct abcg::OpenGLSettings {
   int samples{0};
   bool vsync{false};
   bool preserveWebGLDrawingBuffer{false};
+  // Used only if ABCG_GL_DEBUG_OUTPUT is defined
+  bool synchronousDebugOutput{true};
+  // Used only if ABCG_GL_CAPTURE is defined: if not empty, the OpenGL calls of
+  // initializeGL and of the first captureFrames frames are recorded to this
+  // file (see tools/glreplay)
+  std::string captureFile{};
+  int captureFrames{60};
+  // Paint on a thread that owns the context, one frame behind the main
+  // thread (see OpenGLWindow::publishFrame). Ignored in WebAssembly builds
+  bool renderThread{false};
 };
 
 struct abcg::WindowSettings {
   int width{800};
   int height{600};
+  // Frame time plot and percentiles
   bool showFPS{true};
   bool showFullscreenButton{true};
+  // Used only if ABCG_GL_STATS is defined
+  bool showGLStats{true};
+  // GPU time of paintGL, ImGui and buffer swap, measured only while shown
+  bool showGPUTimings{false};
+  // Flame graph of the CPU scopes of the last frame
+  bool showCPUProfile{false};
+  // Paint only after input, window events or requestRepaint, instead of
+  // continuously
+  bool renderOnDemand{false};
+  // Period in seconds of fixedUpdate, or 0 to disable it
+  double fixedTimeStep{1.0 / 60.0};
+  // Maximum number of fixedUpdate calls per frame; simulation time that
+  // does not fit is dropped, so the simulation slows down instead of
+  // falling further behind
+  int maxFixedSteps{8};
+  // Simulated seconds per real second
+  double simulationSpeed{1.0};
   std::string title{"ABCg Window"};
 };
 
+/**
+ * @brief OpenGL context and ImGui font atlas shared by the windows of an
+ * application.
+ *
+ * Created by abcg::Application when it runs more than one window. The
+ * context of each window shares objects with a hidden context, so textures,
+ * buffers, shaders and programs created by one window can be used by the
+ * others. Container objects (vertex arrays, framebuffers) are not shared.
+ * All windows must then use the same OpenGL profile and version.
+ */
+struct abcg::SharedContext {
+  SDL_Window* window{};
+  SDL_GLContext context{};
+  // Fonts of the ImGui contexts of all windows, so that the ImGui renderer
+  // uses a single font texture
+  ImFontAtlas fontAtlas;
+  bool fontsLoaded{};
+  // Serializes the ImGui renderer, whose vertex and index buffers are shared
+  // by the render threads of all windows
+  std::mutex imGuiMutex;
+};
+
 /**
  * @brief abcg::OpenGLWindow class.
  *
@@ -62,19 +133,23 @@ class abcg::OpenGLWindow {
   OpenGLWindow() = default;
   virtual ~OpenGLWindow();
 
-  OpenGLWindow(const OpenGLWindow&) = default;
-  OpenGLWindow(OpenGLWindow&&) = default;
-  OpenGLWindow& operator=(const OpenGLWindow&) = default;
-  OpenGLWindow& operator=(OpenGLWindow&&) = default;
+  OpenGLWindow(const OpenGLWindow&) = delete;
+  OpenGLWindow(OpenGLWindow&&) = delete;
+  OpenGLWindow& operator=(const OpenGLWindow&) = delete;
+  OpenGLWindow& operator=(OpenGLWindow&&) = delete;
 
   [[nodiscard]] OpenGLSettings getOpenGLSettings() noexcept;
   [[nodiscard]] WindowSettings getWindowSettings() noexcept;
   void setOpenGLSettings(const OpenGLSettings& openGLSettings) noexcept;
   void setWindowSettings(const WindowSettings& windowSettings);
+  void requestRepaint(double delay = 0.0);
+  void requestScreenshot(std::string_view path);
 
  protected:
   virtual void handleEvent(SDL_Event& event);
   virtual void initializeGL();
+  virtual void fixedUpdate(double timeStep);
+  virtual void publishFrame(int slot);
   virtual void paintGL();
   virtual void paintUI();
   virtual void resizeGL(int width, int height);
@@ -86,15 +161,44 @@ class abcg::OpenGLWindow {
   [[nodiscard]] GLuint createProgramFromString(
       std::string_view vertexShaderSource,
       std::string_view fragmentShaderSource);
+  [[nodiscard]] GLuint getProgramVariant(std::string_view pathToVertexShader,
+                                         std::string_view pathToFragmentShader,
+                                         const ShaderDefines& defines = {});
   std::string getAssetsPath();
   [[nodiscard]] double getDeltaTime() const;
   [[nodiscard]] double getElapsedTime() const;
+  [[nodiscard]] double getInterpolationAlpha() const noexcept;
+  [[nodiscard]] int getPaintSlot() const noexcept;
+  [[nodiscard]] GLuint getDefaultFramebuffer() const noexcept;
+  [[nodiscard]] GPUProfiler& getGPUProfiler() noexcept;
+  [[nodiscard]] SamplerCache& getSamplerCache() noexcept;
+  [[nodiscard]] FrameStatistics& getFrameStatistics() noexcept;
   void toggleFullscreen();
 
  private:
   void handleEvent(SDL_Event& event, bool& done);
   void initialize(std::string_view basePath);
   void paint();
+  void advanceSimulation();
+  [[nodiscard]] double getTimeToRepaint() const;
+  void submitFrame(const ElapsedTimer& cpuTimer);
+  void renderLoop();
+  [[nodiscard]] bool isRenderThreadBusy();
+  void waitForRenderThread();
+  void stopRenderThread();
+  struct FrameSlot;
+  void prepareFrameSlot(FrameSlot& slot, double cpuTime);
+  void presentFrame(const FrameSlot& slot, ImDrawData* drawData);
+  void render(ImDrawData* drawData);
+  void startMeasurement(std::size_t frames);
+  [[nodiscard]] BenchmarkResult getBenchmarkResult(double elapsedTime);
+  void recordFrameStatistics(std::uint64_t number, double cpuTime);
+  void checkFrameGLErrors(ImDrawData* drawData);
+  void createOffscreenFramebuffer();
+  void destroyOffscreenFramebuffer();
+  void saveScreenshot(const std::string& path);
+  [[nodiscard]] GLuint linkProgram(const std::string& vsSource,
+                                   const std::string& fsSource);
 
   WindowSettings m_windowSettings{};
   OpenGLSettings m_openGLSettings{};
@@ -102,9 +206,89 @@ class abcg::OpenGLWindow {
   std::string m_assetsPath{};
   std::string m_GLSLVersion{};
 
+  ShaderPreprocessor m_vertexShaderPreprocessor;
+  ShaderPreprocessor m_fragmentShaderPreprocessor;
+  // Programs created by getProgramVariant, keyed by paths and defines
+  std::unordered_map<std::string, GLuint> m_programVariants;
+  SamplerCache m_samplerCache;
+
+  FrameStatistics m_frameStatistics;
+  std::uint64_t m_frameNumber{};
+  ElapsedTimer m_presentTimer;
+
+  // Frames still to be painted in on-demand mode
+  int m_pendingFrames{1};
+  // Window time of the next timed repaint in on-demand mode
+  double m_repaintTime{std::numeric_limits<double>::infinity()};
+  GPUProfiler m_gpuProfiler;
+  // CPU profiler state shown in the flame graph, not updated while paused
+  profiler::Snapshot m_cpuProfile;
+  bool m_cpuProfilePaused{};
+  // Guards the frame statistics, GPU timings and OpenGL statistics, which
+  // are written by the render thread and read by the overlays
+  std::mutex m_statisticsMutex;
+  opengl::FrameStats m_glStats;
+  // Sum of the OpenGL statistics since startMeasurement
+  opengl::FrameStats m_glStatsTotal;
+  std::uint64_t m_glStatsFrames{};
+  // Set by abcg::Application in benchmark mode: GPU times are measured
+  // whenever timer queries are available
+  bool m_benchmarking{};
+  // Renderer and version strings, for benchmark reports
+  std::string m_renderer;
+
+  // Frame handed over from the main thread to the render thread
+  struct FrameSlot {
+    std::uint64_t number{};
+    // Main thread time spent on the frame, in seconds
+    double cpuTime{};
+    bool measureGPU{};
+    int viewportWidth{};
+    int viewportHeight{};
+    // If not empty, the frame is saved to this file
+    std::string screenshotPath;
+    // Copy of the ImGui draw lists, which ImGui reuses in the next frame
+    ImDrawData drawData{};
+    std::vector<std::unique_ptr<ImDrawList>> drawLists;
+    std::vector<ImDrawList*> drawListPointers;
+    // Set by the main thread when published, cleared by the render thread
+    // when painted
+    bool ready{};
+  };
+  std::array<FrameSlot, 2> m_frameSlots;
+  // Slot written by the main thread and slot read by the render thread
+  int m_publishSlot{};
+  int m_paintSlot{};
+  std::thread m_renderThread;
+  std::mutex m_renderMutex;
+  std::condition_variable m_renderCondition;
+  bool m_stopRendering{};
+  // Exception thrown in the render thread, rethrown by the main thread
+  std::exception_ptr m_renderException;
+  // Viewport size last passed to resizeGL by the render thread
+  int m_renderWidth{};
+  int m_renderHeight{};
+  // Capture started by initialize, moved to the render thread
+  opengl::CaptureWriter* m_capture{};
+
+  // Path of the screenshot requested with requestScreenshot
+  std::string m_screenshotPath;
+
   SDL_Window* m_window{};
   SDL_GLContext m_GLContext{};
   Uint32 m_windowID{};
+  // Redundant state filter of m_GLContext
+  opengl::StateCache m_stateCache;
+  ImGuiContext* m_imGuiContext{};
+  // Set by abcg::Application when it runs more than one window
+  SharedContext* m_sharedContext{};
+
+  // Set by abcg::Application when started with --headless: the window is
+  // hidden and frames are painted to an offscreen framebuffer
+  bool m_headless{};
+  GLuint m_offscreenFramebuffer{};
+  GLuint m_offscreenColorbuffer{};
+  GLuint m_offscreenDepthbuffer{};
 
   int m_viewportWidth{};
   int m_viewportHeight{};
@@ -113,6 +297,11 @@ class abcg::OpenGLWindow {
   ElapsedTimer m_windowStartTime;
   double m_lastDeltaTime{0.0};
 
+  ElapsedTimer m_simulationTimer;
+  // Simulation time not yet consumed by fixedUpdate
+  double m_accumulator{};
+  double m_interpolationAlpha{};
+
   friend Application;
 
 #if defined(__EMSCRIPTEN__)
@@ -0,0 +1,251 @@
+/**
+ * @file abcg_renderqueue.cpp
+ * @brief Definition of abcg::RenderQueue class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_renderqueue.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <bit>
+#include <string_view>
+#include <utility>
+
+#include "abcg_exception.hpp"
+#include "abcg_openglfunctions.hpp"
+
+namespace {
+// Bits of the sort key after the pass
+constexpr int programBits{8};
+constexpr int materialBits{12};
+constexpr int geometryBits{8};
+constexpr int stateBits{programBits + materialBits + geometryBits};
+constexpr int depthBits{32};
+
+// Maps a float to an unsigned integer with the same order
+std::uint32_t toOrderedBits(float value) {
+  const auto bits{std::bit_cast<std::uint32_t>(value)};
+  return (bits & 0x80000000U) != 0 ? ~bits : bits | 0x80000000U;
+}
+
+// Returns the rank of a value, adding it to the ranks if it is new
+template <typename T>
+std::uint64_t getRank(std::unordered_map<T, std::uint64_t> &ranks,
+                      const T &value, int bits, std::string_view name) {
+  const auto [it, inserted]{ranks.try_emplace(value, ranks.size())};
+  if (inserted && it->second >= (std::uint64_t{1} << bits)) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Too many {} in render queue (maximum {})", name,
+                    std::uint64_t{1} << bits))};
+  }
+  return it->second;
+}
+}  // namespace
+
+/**
+ * @brief Creates the draw list used to execute the packets.
+ *
+ * @param maxPacketsPerFrame Maximum number of packets executed in a single
+ * frame, summed over all calls of execute.
+ *
+ * @throw abcg::Exception if the buffer of draw commands cannot be mapped.
+ */
+void abcg::RenderQueue::create(GLsizei maxPacketsPerFrame) {
+  destroy();
+
+  m_drawList.create(maxPacketsPerFrame);
+  const auto capacity{static_cast<std::size_t>(maxPacketsPerFrame)};
+  m_packets.reserve(capacity);
+  m_entries.reserve(capacity);
+  m_sortBuffer.reserve(capacity);
+}
+
+/**
+ * @brief Releases the draw list and discards the queued packets.
+ */
+void abcg::RenderQueue::destroy() {
+  m_drawList.destroy();
+  m_packets.clear();
+  m_entries.clear();
+  m_sortBuffer.clear();
+  m_programRanks.clear();
+  m_materialRanks.clear();
+  m_geometryRanks.clear();
+}
+
+/**
+ * @brief Sets the order of the packets of a pass.
+ *
+ * Applies to packets submitted afterwards.
+ *
+ * @param pass Index of the pass.
+ * @param order Order of the packets. The default is Order::State.
+ *
+ * @throw abcg::Exception if the pass is not lower than maxPasses.
+ */
+void abcg::RenderQueue::setOrder(std::uint8_t pass, Order order) {
+  if (pass >= maxPasses) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Invalid render queue pass {}", pass))};
+  }
+  m_orders.at(pass) = order;
+}
+
+/**
+ * @brief Starts a new frame.
+ *
+ * Must be called once per frame, before the first submit. Packets submitted
+ * but not executed in the previous frame are discarded.
+ */
+void abcg::RenderQueue::beginFrame() {
+  m_drawList.beginFrame();
+  m_packets.clear();
+  m_entries.clear();
+  m_programRanks.clear();
+  m_materialRanks.clear();
+  m_geometryRanks.clear();
+}
+
+/**
+ * @brief Adds a packet to the queue.
+ *
+ * Packets without geometry or instances are ignored.
+ *
+ * @param packet Packet to be drawn by the next execute. Its geometry buffer
+ * must remain valid until then.
+ *
+ * @throw abcg::Exception if the pass is invalid, or if the queue has more
+ * than 256 programs, 4096 materials or 256 geometry buffers.
+ */
+void abcg::RenderQueue::submit(const Packet &packet) {
+  if (packet.geometry == nullptr || packet.instanceCount == 0 ||
+      packet.mesh.indexCount <= 0) {
+    return;
+  }
+  if (packet.pass >= maxPasses) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Invalid render queue pass {}", packet.pass))};
+  }
+
+  m_entries.push_back(
+      {makeKey(packet), static_cast<std::uint32_t>(m_packets.size())});
+  m_packets.push_back(packet);
+}
+
+/**
+ * @brief Draws the queued packets in the order of their sort keys, and
+ * clears the queue.
+ *
+ * Runs of consecutive packets with the same program, material, geometry
+ * buffer and instance buffer are submitted as one abcg::DrawList. Leaves no
+ * program in use.
+ *
+ * @throw abcg::Exception if the frame has more packets than given to create.
+ */
+void abcg::RenderQueue::execute() {
+  sort();
+
+  const Packet *run{};
+  const auto submitRun{[this](const Packet &first) {
+    m_drawList.submit(*first.geometry, first.instanceBuffer,
+                      first.instanceOffset);
+  }};
+  for (const auto &entry : m_entries) {
+    const auto &packet{m_packets.at(entry.packet)};
+    const auto sameRun{run != nullptr && packet.program == run->program &&
+                       packet.material == run->material &&
+                       packet.geometry == run->geometry &&
+                       packet.instanceBuffer == run->instanceBuffer &&
+                       packet.instanceOffset == run->instanceOffset};
+    if (!sameRun) {
+      if (run != nullptr) submitRun(*run);
+      if (run == nullptr || packet.program != run->program) {
+        glUseProgram(packet.program);
+      }
+      if (run == nullptr || packet.material != run->material) {
+        bindMaterial(packet);
+      }
+      run = &packet;
+    }
+    m_drawList.add(packet.mesh, packet.instanceCount, packet.baseInstance);
+  }
+  if (run != nullptr) {
+    submitRun(*run);
+    glUseProgram(0);
+  }
+
+  m_packets.clear();
+  m_entries.clear();
+  m_programRanks.clear();
+  m_materialRanks.clear();
+  m_geometryRanks.clear();
+}
+
+// Builds the sort key of a packet. From the most significant bits: the pass
+// (4 bits), then either the state (program, material and geometry ranks, 28
+// bits) and the depth (32 bits), or the depth and the state, according to
+// the order of the pass
+std::uint64_t abcg::RenderQueue::makeKey(const Packet &packet) {
+  const auto program{
+      getRank(m_programRanks, packet.program, programBits, "programs")};
+  const auto material{
+      getRank(m_materialRanks, packet.material, materialBits, "materials")};
+  const auto geometry{getRank(m_geometryRanks, packet.geometry, geometryBits,
+                              "geometry buffers")};
+  const auto state{(program << (materialBits + geometryBits)) |
+                   (material << geometryBits) | geometry};
+  const std::uint64_t depth{toOrderedBits(packet.depth)};
+  const auto pass{std::uint64_t{packet.pass} << (stateBits + depthBits)};
+
+  switch (m_orders.at(packet.pass)) {
+    case Order::FrontToBack:
+      return pass | (depth << stateBits) | state;
+    case Order::BackToFront:
+      return pass | ((~depth & 0xFFFFFFFFU) << stateBits) | state;
+    case Order::State:
+    default:
+      return pass | (state << depthBits) | depth;
+  }
+}
+
+// Sorts the entries by key with a stable least significant digit radix
+// sort, one byte per pass. Bytes that are the same in all keys are skipped
+void abcg::RenderQueue::sort() {
+  m_sortBuffer.resize(m_entries.size());
+  for (auto shift{0}; shift < 64; shift += 8) {
+    std::array<std::size_t, 256> counts{};
+    for (const auto &entry : m_entries) {
+      ++counts.at((entry.key >> shift) & 0xFFU);
+    }
+    if (std::ranges::find(counts, m_entries.size()) != counts.end()) continue;
+
+    // Position of the first entry of each digit
+    std::size_t position{};
+    for (auto &count : counts) position += std::exchange(count, position);
+    for (const auto &entry : m_entries) {
+      m_sortBuffer.at(counts.at((entry.key >> shift) & 0xFFU)++) = entry;
+    }
+    std::swap(m_entries, m_sortBuffer);
+  }
+}
+
+// Binds the textures and the uniform block of the material of a packet
+void abcg::RenderQueue::bindMaterial(const Packet &packet) {
+  for (std::size_t unit{}; unit < packet.textures.size(); ++unit) {
+    const auto &texture{packet.textures.at(unit)};
+    if (texture.texture == 0) continue;
+
+    glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit));
+    glBindTexture(texture.target, texture.texture);
+    glBindSampler(static_cast<GLuint>(unit), texture.sampler);
+  }
+
+  const auto &block{packet.materialBlock};
+  if (block.buffer != 0) {
+    glBindBufferRange(GL_UNIFORM_BUFFER, block.binding, block.buffer,
+                      block.offset, block.size);
+  }
+}
@@ -0,0 +1,153 @@
+/**
+ * @file abcg_renderqueue.hpp
+ * @brief abcg::RenderQueue header file.
+ *
+ * Declaration of abcg::RenderQueue class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_RENDERQUEUE_HPP_
+#define ABCG_RENDERQUEUE_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "abcg_drawlist.hpp"
+#include "abcg_external.hpp"
+#include "abcg_geometrybuffer.hpp"
+
+namespace abcg {
+class RenderQueue;
+}  // namespace abcg
+
+/**
+ * @brief abcg::RenderQueue class.
+ *
+ * Queue of draw packets submitted in any order during paintGL and executed
+ * in an order that minimizes state changes.
+ *
+ * Each packet is given a 64-bit sort key made of its pass, its program, its
+ * material, its geometry buffer and its depth, and the packets are sorted by
+ * key with a radix sort before they are executed. Passes are executed in
+ * increasing order. By default, the packets of a pass are grouped by
+ * program, then by material, then by geometry buffer, and the packets of
+ * each group are ordered front to back. The order of a pass can instead be
+ * by depth only, front to back for early depth rejection of opaque draws or
+ * back to front for blended draws (see setOrder).
+ *
+ * A program is made current, and a material is bound, only when it changes
+ * from the previous packet. Consecutive packets with the same state are
+ * drawn with a single abcg::DrawList submission, so a pass with a single
+ * program and material is usually one glMultiDrawElementsIndirect.
+ *
+ * The per-object data of the draws, such as the model matrix, are read from
+ * per-instance attributes. Blending, depth testing and other context state
+ * are not part of the packets: packets that need different state must be
+ * executed separately. All members except setOrder and submit must be
+ * called with the OpenGL context current.
+ */
+class abcg::RenderQueue {
+ public:
+  static constexpr std::size_t maxPasses{16};
+  static constexpr std::size_t maxTextureUnits{4};
+
+  /**
+   * @brief Order of the packets of a pass.
+   */
+  enum class Order : std::uint8_t {
+    // By program, material and geometry buffer, then front to back
+    State,
+    // Front to back, then by state
+    FrontToBack,
+    // Back to front, then by state
+    BackToFront
+  };
+
+  /**
+   * @brief Texture bound to a texture unit, with its sampler.
+   */
+  struct Texture {
+    GLenum target{GL_TEXTURE_2D};
+    // Texture object, or 0 to leave the unit as it is
+    GLuint texture{};
+    GLuint sampler{};
+  };
+
+  /**
+   * @brief Range of a buffer bound to a uniform block binding point.
+   */
+  struct UniformRange {
+    GLuint binding{};
+    // Buffer object, or 0 for no uniform block
+    GLuint buffer{};
+    GLintptr offset{};
+    GLsizeiptr size{};
+  };
+
+  /**
+   * @brief Draw of instances of a mesh, with the state it requires.
+   */
+  struct Packet {
+    // Index of the pass, lower than maxPasses
+    std::uint8_t pass{};
+    GLuint program{};
+    // Application-defined identifier of the material. Packets with the same
+    // material must use the same textures and material block
+    std::uint32_t material{};
+    std::array<Texture, maxTextureUnits> textures{};
+    UniformRange materialBlock{};
+    // Distance from the camera, in view space
+    float depth{};
+    const GeometryBuffer* geometry{};
+    MeshRange mesh{};
+    GLuint instanceCount{1};
+    // Index of the data of the first instance in the instance buffer
+    GLuint baseInstance{};
+    // Buffer with the per-instance data, or 0 if there is none
+    GLuint instanceBuffer{};
+    GLintptr instanceOffset{};
+  };
+
+  void create(GLsizei maxPacketsPerFrame);
+  void destroy();
+
+  void setOrder(std::uint8_t pass, Order order);
+
+  void beginFrame();
+  void submit(const Packet& packet);
+  void execute();
+
+  // Number of packets submitted since the last execute
+  [[nodiscard]] std::size_t size() const noexcept { return m_packets.size(); }
+
+ private:
+  struct SortEntry {
+    std::uint64_t key{};
+    std::uint32_t packet{};
+  };
+
+  std::vector<Packet> m_packets;
+  std::vector<SortEntry> m_entries;
+  // Destination of every other pass of the radix sort
+  std::vector<SortEntry> m_sortBuffer;
+  std::array<Order, maxPasses> m_orders{};
+
+  // Ranks of the programs, materials and geometry buffers of the queued
+  // packets, in the order of their first submission. They take fewer bits
+  // of the sort key than the values themselves
+  std::unordered_map<GLuint, std::uint64_t> m_programRanks;
+  std::unordered_map<std::uint32_t, std::uint64_t> m_materialRanks;
+  std::unordered_map<const GeometryBuffer*, std::uint64_t> m_geometryRanks;
+
+  DrawList m_drawList;
+
+  [[nodiscard]] std::uint64_t makeKey(const Packet& packet);
+  void sort();
+  void bindMaterial(const Packet& packet);
+};
+
+#endif
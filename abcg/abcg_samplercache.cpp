@@ -0,0 +1,70 @@
+/**
+ * @file abcg_samplercache.cpp
+ * @brief Definition of abcg::SamplerCache class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_samplercache.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+
+#include "abcg_openglfunctions.hpp"
+
+/**
+ * @brief Returns the sampler object of a description.
+ *
+ * The sampler is created on the first request of the description. The
+ * OpenGL context that owns the cache must be current.
+ *
+ * @param description Filtering and wrapping parameters.
+ * @return Sampler name, to be used with glBindSampler.
+ */
+GLuint abcg::SamplerCache::get(const SamplerDescription &description) {
+  if (auto it{m_samplers.find(description)}; it != m_samplers.end()) {
+    return it->second;
+  }
+
+  GLuint sampler{};
+  glGenSamplers(1, &sampler);
+  glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER,
+                      static_cast<GLint>(description.minFilter));
+  glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER,
+                      static_cast<GLint>(description.magFilter));
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S,
+                      static_cast<GLint>(description.wrapS));
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T,
+                      static_cast<GLint>(description.wrapT));
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_R,
+                      static_cast<GLint>(description.wrapR));
+#if !defined(__EMSCRIPTEN__)
+  if (description.maxAnisotropy > 1.0f &&
+      GLEW_EXT_texture_filter_anisotropic != 0) {
+    if (m_maxAnisotropy == 0.0f) {
+      glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &m_maxAnisotropy);
+    }
+    glSamplerParameterf(sampler, GL_TEXTURE_MAX_ANISOTROPY_EXT,
+                        std::min(description.maxAnisotropy, m_maxAnisotropy));
+  }
+  // GL_SAMPLER is a GL_KHR_debug identifier, not declared on OpenGL ES
+  abcg::opengl::setObjectLabel(GL_SAMPLER, sampler,
+                               fmt::format("Sampler {}", m_samplers.size()));
+#endif
+
+  m_samplers.emplace(description, sampler);
+  return sampler;
+}
+
+/**
+ * @brief Deletes all sampler objects.
+ *
+ * The OpenGL context that owns the cache must be current.
+ */
+void abcg::SamplerCache::destroy() {
+  for (const auto &[description, sampler] : m_samplers) {
+    glDeleteSamplers(1, &sampler);
+  }
+  m_samplers.clear();
+}
@@ -0,0 +1,71 @@
+/**
+ * @file abcg_samplercache.hpp
+ * @brief abcg::SamplerCache header file.
+ *
+ * Declaration of abcg::SamplerCache class and abcg::SamplerDescription
+ * structure.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_SAMPLERCACHE_HPP_
+#define ABCG_SAMPLERCACHE_HPP_
+
+#include <compare>
+#include <cstddef>
+#include <map>
+
+#include "abcg_external.hpp"
+
+namespace abcg {
+class SamplerCache;
+struct SamplerDescription;
+}  // namespace abcg
+
+/**
+ * @brief Filtering and wrapping parameters of a sampler object.
+ *
+ * The default is trilinear filtering with repeat wrapping.
+ */
+struct abcg::SamplerDescription {
+  GLenum minFilter{GL_LINEAR_MIPMAP_LINEAR};
+  GLenum magFilter{GL_LINEAR};
+  GLenum wrapS{GL_REPEAT};
+  GLenum wrapT{GL_REPEAT};
+  GLenum wrapR{GL_REPEAT};
+  // Maximum degree of anisotropy, clamped to the limit of the driver. 1
+  // disables anisotropic filtering
+  float maxAnisotropy{1.0f};
+
+  auto operator<=>(const SamplerDescription&) const = default;
+};
+
+/**
+ * @brief abcg::SamplerCache class.
+ *
+ * Creates one sampler object per distinct abcg::SamplerDescription and
+ * returns the same object for every later request of that description. A
+ * sampler bound to a texture unit with glBindSampler overrides the
+ * filtering and wrapping parameters of the texture bound to that unit, so
+ * that textures can be shared by draws with different sampling without
+ * calling glTexParameteri before each draw.
+ *
+ * Samplers returned by the cache are shared and must not be modified or
+ * deleted. Requires OpenGL 3.3 or OpenGL ES 3.0. Anisotropic filtering is
+ * used only if GL_EXT_texture_filter_anisotropic is supported.
+ */
+class abcg::SamplerCache {
+ public:
+  [[nodiscard]] GLuint get(const SamplerDescription& description = {});
+  void destroy();
+
+  // Number of sampler objects created
+  [[nodiscard]] std::size_t size() const noexcept { return m_samplers.size(); }
+
+ private:
+  std::map<SamplerDescription, GLuint> m_samplers;
+  // Maximum degree of anisotropy supported, or 0 if not queried yet
+  float m_maxAnisotropy{};
+};
+
+#endif
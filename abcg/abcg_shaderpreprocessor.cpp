@@ -0,0 +1,228 @@
+/**
+ * @file abcg_shaderpreprocessor.cpp
+ * @brief Definition of abcg::ShaderPreprocessor class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_shaderpreprocessor.hpp"
+
+#include <fmt/core.h>
+
+#include <fstream>
+#include <sstream>
+
+#include "abcg_exception.hpp"
+
+namespace {
+constexpr auto maxIncludeDepth{32};
+
+std::string readFile(const std::filesystem::path &path) {
+  std::stringstream source;
+  if (std::ifstream stream(path); stream) {
+    source << stream.rdbuf();
+  } else {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to read shader file {}", path.string()))};
+  }
+  return source.str();
+}
+
+std::string_view trimLeft(std::string_view line) {
+  const auto first{line.find_first_not_of(" \t")};
+  return first == std::string_view::npos ? std::string_view{}
+                                         : line.substr(first);
+}
+
+// Returns the name between quotes or angle brackets of an #include directive
+std::string_view includeName(std::string_view directive) {
+  const auto first{directive.find_first_of("\"<")};
+  if (first == std::string_view::npos) return {};
+  const auto closing{directive[first] == '"' ? '"' : '>'};
+  const auto last{directive.find(closing, first + 1)};
+  if (last == std::string_view::npos) return {};
+  return directive.substr(first + 1, last - first - 1);
+}
+
+bool isDirective(std::string_view line, std::string_view name) {
+  if (!line.starts_with('#')) return false;
+  line = trimLeft(line.substr(1));
+  return line.starts_with(name) &&
+         (line.size() == name.size() || line[name.size()] == ' ' ||
+          line[name.size()] == '\t' || line[name.size()] == '"' ||
+          line[name.size()] == '<');
+}
+}  // namespace
+
+/**
+ * @brief Returns a string that uniquely identifies a set of definitions.
+ *
+ * @param defines Set of definitions.
+ * @return Cache key.
+ */
+std::string abcg::toCacheKey(const ShaderDefines &defines) {
+  std::string key;
+  for (const auto &[name, value] : defines) {
+    key += name;
+    key += '=';
+    key += value;
+    key += ';';
+  }
+  return key;
+}
+
+/**
+ * @brief Sets the `#version` header used by processed sources.
+ *
+ * @param versionHeader Version header, e.g. `#version 410 core`.
+ * @param keepExistingVersion Whether a `#version` directive already present
+ * in the source takes precedence over the header.
+ */
+void abcg::ShaderPreprocessor::setVersionHeader(std::string_view versionHeader,
+                                                bool keepExistingVersion) {
+  m_versionHeader = versionHeader;
+  m_keepExistingVersion = keepExistingVersion;
+  clearCache();
+}
+
+/**
+ * @brief Sets a precision statement added to sources that have none.
+ *
+ * @param precision Precision statement, e.g. `precision mediump float;`, or an
+ * empty string to disable.
+ */
+void abcg::ShaderPreprocessor::setDefaultPrecision(std::string_view precision) {
+  m_defaultPrecision = precision;
+  clearCache();
+}
+
+/**
+ * @brief Expands a shader source string.
+ *
+ * @param source Shader source.
+ * @param defines Definitions injected after the version header.
+ * @param includeDirectory Directory used to resolve `#include` directives.
+ * @return Reference to the cached expanded source.
+ *
+ * @throw abcg::Exception if an included file cannot be read.
+ */
+const std::string &abcg::ShaderPreprocessor::processString(
+    std::string_view source, const ShaderDefines &defines,
+    const std::filesystem::path &includeDirectory) {
+  auto key{fmt::format("S{}\n{}\n{}", toCacheKey(defines),
+                       includeDirectory.string(), source)};
+  if (auto it{m_cache.find(key)}; it != m_cache.end()) {
+    return it->second;
+  }
+  auto expanded{expand(source, defines, includeDirectory)};
+  return m_cache.emplace(std::move(key), std::move(expanded)).first->second;
+}
+
+/**
+ * @brief Expands a shader source file.
+ *
+ * Files are read only the first time a (path, defines) key is requested.
+ *
+ * @param path Path to the shader source.
+ * @param defines Definitions injected after the version header.
+ * @return Reference to the cached expanded source.
+ *
+ * @throw abcg::Exception if the file or an included file cannot be read.
+ */
+const std::string &abcg::ShaderPreprocessor::processFile(
+    const std::filesystem::path &path, const ShaderDefines &defines) {
+  auto key{fmt::format("F{}\n{}", toCacheKey(defines), path.string())};
+  if (auto it{m_cache.find(key)}; it != m_cache.end()) {
+    return it->second;
+  }
+  auto expanded{expand(readFile(path), defines, path.parent_path())};
+  return m_cache.emplace(std::move(key), std::move(expanded)).first->second;
+}
+
+/**
+ * @brief Discards all cached sources.
+ */
+void abcg::ShaderPreprocessor::clearCache() { m_cache.clear(); }
+
+std::string abcg::ShaderPreprocessor::expand(
+    std::string_view source, const ShaderDefines &defines,
+    const std::filesystem::path &includeDirectory) const {
+  std::string body;
+  body.reserve(source.size());
+  std::string versionLine;
+  bool hasPrecision{};
+  std::set<std::filesystem::path> includedFiles;
+  expandIncludes(source, includeDirectory, includedFiles, body, versionLine,
+                 hasPrecision, 0);
+
+  std::string output;
+  output.reserve(body.size() + 256);
+  output += (m_keepExistingVersion && !versionLine.empty()) ? versionLine
+                                                            : m_versionHeader;
+  output += '\n';
+  if (!hasPrecision && !m_defaultPrecision.empty()) {
+    output += m_defaultPrecision;
+    output += '\n';
+  }
+  for (const auto &[name, value] : defines) {
+    output += fmt::format("#define {} {}\n", name, value);
+  }
+  // Restore line numbers of the main source in compiler messages
+  output += "#line 1\n";
+  output += body;
+
+  return output;
+}
+
+void abcg::ShaderPreprocessor::expandIncludes(
+    std::string_view source, const std::filesystem::path &includeDirectory,
+    std::set<std::filesystem::path> &includedFiles, std::string &output,
+    std::string &versionLine, bool &hasPrecision, int depth) const {
+  if (depth > maxIncludeDepth) {
+    throw abcg::Exception{
+        abcg::Exception::Runtime("Shader #include nesting is too deep")};
+  }
+
+  int lineNumber{0};
+  while (!source.empty()) {
+    ++lineNumber;
+    const auto end{source.find('\n')};
+    auto line{source.substr(0, end)};
+    source = (end == std::string_view::npos) ? std::string_view{}
+                                             : source.substr(end + 1);
+    if (line.ends_with('\r')) line.remove_suffix(1);
+
+    const auto trimmed{trimLeft(line)};
+
+    if (isDirective(trimmed, "version")) {
+      // Blank line keeps the numbering of the following lines
+      if (depth == 0 && versionLine.empty()) versionLine = trimmed;
+      output += '\n';
+      continue;
+    }
+
+    if (isDirective(trimmed, "include")) {
+      const auto name{includeName(trimmed)};
+      if (name.empty()) {
+        throw abcg::Exception{abcg::Exception::Runtime(
+            fmt::format("Malformed shader directive: {}", trimmed))};
+      }
+      auto path{(includeDirectory / name).lexically_normal()};
+      if (includedFiles.insert(path).second) {
+        const auto included{readFile(path)};
+        expandIncludes(included, path.parent_path(), includedFiles, output,
+                       versionLine, hasPrecision, depth + 1);
+      }
+      output += fmt::format("#line {}\n", lineNumber + 1);
+      continue;
+    }
+
+    if (trimmed.starts_with("precision") &&
+        trimmed.find("float") != std::string_view::npos) {
+      hasPrecision = true;
+    }
+
+    output += line;
+    output += '\n';
+  }
+}
@@ -0,0 +1,79 @@
+/**
+ * @file abcg_shaderpreprocessor.hpp
+ * @brief abcg::ShaderPreprocessor header file.
+ *
+ * Declaration of abcg::ShaderPreprocessor class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_SHADERPREPROCESSOR_HPP_
+#define ABCG_SHADERPREPROCESSOR_HPP_
+
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace abcg {
+class ShaderPreprocessor;
+
+/**
+ * @brief Set of preprocessor definitions (name and value) injected into a
+ * shader source. An ordered map is used so that equal sets always produce the
+ * same cache key.
+ */
+using ShaderDefines = std::map<std::string, std::string>;
+
+[[nodiscard]] std::string toCacheKey(const ShaderDefines& defines);
+}  // namespace abcg
+
+/**
+ * @brief abcg::ShaderPreprocessor class.
+ *
+ * Expands GLSL sources before compilation:
+ *
+ * - Replaces or adds the `#version` header;
+ * - Adds a default precision statement, if missing (used for OpenGL ES
+ *   fragment shaders);
+ * - Injects a set of `#define` directives (e.g. to generate compile-time
+ *   variants of the same shader);
+ * - Resolves `#include "file"` directives relative to the including file.
+ *   Each file is included at most once per shader.
+ *
+ * Expanded sources are cached by (source, defines) key.
+ */
+class abcg::ShaderPreprocessor {
+ public:
+  void setVersionHeader(std::string_view versionHeader,
+                        bool keepExistingVersion);
+  void setDefaultPrecision(std::string_view precision);
+
+  [[nodiscard]] const std::string& processString(
+      std::string_view source, const ShaderDefines& defines = {},
+      const std::filesystem::path& includeDirectory = {});
+  [[nodiscard]] const std::string& processFile(
+      const std::filesystem::path& path, const ShaderDefines& defines = {});
+
+  void clearCache();
+
+ private:
+  std::string m_versionHeader{};
+  bool m_keepExistingVersion{};
+  std::string m_defaultPrecision{};
+
+  std::unordered_map<std::string, std::string> m_cache;
+
+  [[nodiscard]] std::string expand(
+      std::string_view source, const ShaderDefines& defines,
+      const std::filesystem::path& includeDirectory) const;
+  void expandIncludes(std::string_view source,
+                      const std::filesystem::path& includeDirectory,
+                      std::set<std::filesystem::path>& includedFiles,
+                      std::string& output, std::string& versionLine,
+                      bool& hasPrecision, int depth) const;
+};
+
+#endif
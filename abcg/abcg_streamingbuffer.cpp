@@ -0,0 +1,212 @@
+/**
+ * @file abcg_streamingbuffer.cpp
+ * @brief Definition of abcg::StreamingBuffer class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_streamingbuffer.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "abcg_exception.hpp"
+#include "abcg_openglfunctions.hpp"
+
+/**
+ * @brief Creates the buffer object.
+ *
+ * @param bytesPerFrame Maximum number of bytes allocated in a single frame,
+ * including alignment padding.
+ * @param framesInFlight Number of segments of a persistently mapped buffer.
+ * A segment is reused after framesInFlight frames, or later if the GPU is
+ * still reading it.
+ *
+ * @throw abcg::Exception if the buffer cannot be mapped.
+ */
+void abcg::StreamingBuffer::create(GLsizeiptr bytesPerFrame,
+                                   int framesInFlight) {
+  destroy();
+
+  // Keep every segment aligned for any kind of data
+  const GLsizeiptr segmentAlignment{256};
+  const auto size{std::max(bytesPerFrame, GLsizeiptr{1})};
+  m_segmentSize =
+      (size + segmentAlignment - 1) / segmentAlignment * segmentAlignment;
+  m_segment = 0;
+  m_used = 0;
+  m_flushed = 0;
+
+  auto persistent{false};
+#if !defined(__EMSCRIPTEN__)
+  persistent =
+      GLEW_VERSION_4_4 == GL_TRUE || GLEW_ARB_buffer_storage == GL_TRUE;
+#if defined(ABCG_GL_CAPTURE)
+  // Writes to mapped memory cannot be recorded
+  if (opengl::activeCapture != nullptr) persistent = false;
+#endif
+#endif
+
+  glGenBuffers(1, &m_buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+#if !defined(__EMSCRIPTEN__)
+  if (persistent) {
+    const auto frames{std::max(framesInFlight, 1)};
+    const auto storageSize{m_segmentSize * frames};
+    const GLbitfield flags{GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+                           GL_MAP_COHERENT_BIT};
+    glBufferStorage(GL_COPY_WRITE_BUFFER, storageSize, nullptr, flags);
+    m_mapping = static_cast<std::byte *>(
+        glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, storageSize, flags));
+    if (m_mapping == nullptr) {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+      destroy();
+      throw abcg::Exception{
+          abcg::Exception::Runtime("Failed to map streaming buffer")};
+    }
+    m_fences.assign(static_cast<std::size_t>(frames), nullptr);
+  }
+#endif
+  if (!persistent) {
+    glBufferData(GL_COPY_WRITE_BUFFER, m_segmentSize, nullptr, GL_STREAM_DRAW);
+    m_staging.assign(static_cast<std::size_t>(m_segmentSize), std::byte{});
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/**
+ * @brief Releases the buffer object.
+ */
+void abcg::StreamingBuffer::destroy() {
+#if !defined(__EMSCRIPTEN__)
+  for (auto &fence : m_fences) {
+    if (fence != nullptr) glDeleteSync(fence);
+  }
+#endif
+  m_fences.clear();
+  if (m_buffer != 0) {
+    // Deleting a buffer also unmaps it
+    glDeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+  }
+  m_mapping = nullptr;
+  m_staging.clear();
+  m_segmentSize = 0;
+  m_used = 0;
+  m_flushed = 0;
+}
+
+/**
+ * @brief Starts allocating from the segment of the next frame.
+ *
+ * Must be called once per frame, after the draws of the previous frame were
+ * issued and before the first allocation. If the GPU may still be reading
+ * the segment, waits for its fence.
+ */
+void abcg::StreamingBuffer::beginFrame() {
+#if !defined(__EMSCRIPTEN__)
+  if (isPersistent()) {
+    auto &previous{m_fences.at(static_cast<std::size_t>(m_segment))};
+    if (m_used > 0) {
+      if (previous != nullptr) glDeleteSync(previous);
+      previous = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    m_segment = (m_segment + 1) % static_cast<int>(m_fences.size());
+    waitForFence(m_fences.at(static_cast<std::size_t>(m_segment)));
+  }
+#endif
+  m_used = 0;
+  m_flushed = 0;
+}
+
+/**
+ * @brief Allocates memory for the current frame.
+ *
+ * @param size Size in bytes.
+ * @param alignment Alignment of the offset in bytes.
+ * @return Offset of the memory in the buffer and pointer for writing.
+ *
+ * @throw abcg::Exception if the segment of the frame is full.
+ */
+abcg::StreamingBuffer::Allocation abcg::StreamingBuffer::allocate(
+    GLsizeiptr size, GLsizeiptr alignment) {
+  alignment = std::max(alignment, GLsizeiptr{1});
+  const auto offset{(m_used + alignment - 1) / alignment * alignment};
+  if (offset + size > m_segmentSize) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Streaming buffer segment overflow ({} of {} bytes)",
+                    offset + size, m_segmentSize))};
+  }
+  m_used = offset + size;
+
+  const auto segmentOffset{isPersistent() ? m_segmentSize * m_segment
+                                          : GLsizeiptr{}};
+  auto *base{isPersistent() ? m_mapping : m_staging.data()};
+  return {segmentOffset + offset,
+          {base + segmentOffset + offset, static_cast<std::size_t>(size)}};
+}
+
+/**
+ * @brief Copies data into memory allocated for the current frame.
+ *
+ * @param data Pointer to the data.
+ * @param size Size of the data in bytes.
+ * @param alignment Alignment of the offset in bytes.
+ * @return Offset of the data in the buffer.
+ *
+ * @throw abcg::Exception if the segment of the frame is full.
+ */
+GLintptr abcg::StreamingBuffer::push(const void *data, GLsizeiptr size,
+                                     GLsizeiptr alignment) {
+  const auto allocation{allocate(size, alignment)};
+  std::memcpy(allocation.data.data(), data, allocation.data.size());
+  if (isPersistent()) opengl::recordBufferUpload(size, data);
+  return allocation.offset;
+}
+
+/**
+ * @brief Makes the data written since the last flush visible to OpenGL.
+ *
+ * Must be called before the draws that read the data. This is a no-op for a
+ * persistently mapped buffer, whose mapping is coherent. Otherwise, the
+ * first flush of a frame orphans the buffer storage, so that the upload does
+ * not wait for draws of previous frames, and each flush uploads the data
+ * written since the previous one.
+ */
+void abcg::StreamingBuffer::flush() {
+  if (isPersistent() || m_used == m_flushed) return;
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+  if (m_flushed == 0) {
+    glBufferData(GL_COPY_WRITE_BUFFER, m_segmentSize, nullptr, GL_STREAM_DRAW);
+  }
+  glBufferSubData(GL_COPY_WRITE_BUFFER, m_flushed, m_used - m_flushed,
+                  &m_staging.at(static_cast<std::size_t>(m_flushed)));
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  m_flushed = m_used;
+}
+
+// Blocks until the GPU has finished the commands before a fence, and then
+// deletes the fence
+void abcg::StreamingBuffer::waitForFence([[maybe_unused]] GLsync &fence) {
+#if !defined(__EMSCRIPTEN__)
+  if (fence == nullptr) return;
+
+  const GLuint64 timeout{1'000'000'000};  // 1 s
+  while (true) {
+    const auto status{
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout)};
+    if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+      break;
+    }
+    if (status == GL_WAIT_FAILED) {
+      throw abcg::Exception{
+          abcg::Exception::Runtime("Failed to wait for streaming buffer")};
+    }
+  }
+  glDeleteSync(fence);
+  fence = nullptr;
+#endif
+}
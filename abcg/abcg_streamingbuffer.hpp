@@ -0,0 +1,109 @@
+/**
+ * @file abcg_streamingbuffer.hpp
+ * @brief abcg::StreamingBuffer header file.
+ *
+ * Declaration of abcg::StreamingBuffer class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_STREAMINGBUFFER_HPP_
+#define ABCG_STREAMINGBUFFER_HPP_
+
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "abcg_external.hpp"
+
+namespace abcg {
+class StreamingBuffer;
+}  // namespace abcg
+
+/**
+ * @brief abcg::StreamingBuffer class.
+ *
+ * Buffer object for data written by the CPU every frame: dynamic vertices,
+ * indices and uniform blocks. The buffer is split into one segment per frame
+ * in flight, and each frame sub-allocates its data from its segment with a
+ * bump allocator.
+ *
+ * If OpenGL 4.4 or GL_ARB_buffer_storage is available, the buffer is created
+ * with immutable storage and persistently mapped, so data are written
+ * directly to the mapped memory. A fence is placed after the draws of each
+ * frame, and a segment is reused only after its fence is signaled.
+ * Otherwise, data are written to a CPU staging area and uploaded by flush,
+ * after the buffer storage is orphaned with glBufferData.
+ *
+ * The same buffer can be bound to any target (e.g. GL_ARRAY_BUFFER,
+ * GL_ELEMENT_ARRAY_BUFFER, or GL_UNIFORM_BUFFER with glBindBufferRange).
+ * Allocations are addressed by their offsets in the buffer, which change
+ * every frame. All members must be called with the OpenGL context current.
+ */
+class abcg::StreamingBuffer {
+ public:
+  /**
+   * @brief Memory allocated for the current frame.
+   */
+  struct Allocation {
+    // Offset in the buffer object
+    GLintptr offset{};
+    // Memory to be written before flush
+    std::span<std::byte> data;
+  };
+
+  void create(GLsizeiptr bytesPerFrame, int framesInFlight = 3);
+  void destroy();
+
+  void beginFrame();
+  [[nodiscard]] Allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 1);
+  GLintptr push(const void* data, GLsizeiptr size, GLsizeiptr alignment = 1);
+  template <typename T>
+  GLintptr push(std::span<const T> elements,
+                GLsizeiptr alignment = alignof(T));
+  void flush();
+
+  [[nodiscard]] GLuint getBuffer() const noexcept { return m_buffer; }
+  [[nodiscard]] bool isPersistent() const noexcept {
+    return m_mapping != nullptr;
+  }
+  // Bytes allocated in the current frame, including alignment padding
+  [[nodiscard]] GLsizeiptr getUsedSize() const noexcept { return m_used; }
+
+ private:
+  GLuint m_buffer{};
+  GLsizeiptr m_segmentSize{};
+  int m_segment{};
+  GLsizeiptr m_used{};
+  // Bytes of the segment already uploaded by flush, if not persistent
+  GLsizeiptr m_flushed{};
+
+  // Persistently mapped storage of all segments, or nullptr
+  std::byte* m_mapping{};
+  // Fence placed after the draws of each segment, or nullptr
+  std::vector<GLsync> m_fences;
+  // Staging area of the only segment, if not persistent
+  std::vector<std::byte> m_staging;
+
+  void waitForFence(GLsync& fence);
+};
+
+/**
+ * @brief Copies an array into memory allocated for the current frame.
+ *
+ * @tparam T Trivially copyable type of the elements.
+ * @param elements Elements to be copied.
+ * @param alignment Alignment of the offset in bytes. With vertex data, use
+ * the stride to be able to address the first vertex by index.
+ * @return Offset of the data in the buffer.
+ */
+template <typename T>
+GLintptr abcg::StreamingBuffer::push(std::span<const T> elements,
+                                     GLsizeiptr alignment) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  return push(elements.data(), static_cast<GLsizeiptr>(elements.size_bytes()),
+              alignment);
+}
+
+#endif
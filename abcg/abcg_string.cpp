@@ -10,6 +10,8 @@
 
 #include "abcg_string.hpp"
 
+#include <fmt/core.h>
+
 #include <cctype>
 
 // Trim from start (in place)
@@ -46,4 +48,20 @@ std::string abcg::rightTrimCopy(std::string s) {
 std::string abcg::trimCopy(std::string s) {
   trim(s);
   return s;
-}
\ No newline at end of file
+}
+// Escape quotes, backslashes and control characters for a JSON string
+std::string abcg::escapeJSON(std::string_view text) {
+  std::string escaped;
+  escaped.reserve(text.size());
+  for (const auto character : text) {
+    if (character == '"' || character == '\\') {
+      escaped += '\\';
+      escaped += character;
+    } else if (static_cast<unsigned char>(character) < 0x20) {
+      escaped += fmt::format("\\u{:04x}", static_cast<int>(character));
+    } else {
+      escaped += character;
+    }
+  }
+  return escaped;
+}
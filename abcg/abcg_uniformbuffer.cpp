@@ -0,0 +1,106 @@
+/**
+ * @file abcg_uniformbuffer.cpp
+ * @brief Definition of abcg::UniformBuffer class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_uniformbuffer.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+
+#include "abcg_exception.hpp"
+#include "abcg_openglfunctions.hpp"
+
+/**
+ * @brief Checks that a C++ struct is large enough for a uniform block.
+ *
+ * @param program Linked shader program that declares the block.
+ * @param blockName Name of the uniform block.
+ * @param size Size of the C++ struct that mirrors the block.
+ *
+ * @throw abcg::Exception if the block is larger than the struct. Blocks not
+ * found in the program are ignored.
+ */
+void abcg::std140::checkBlockSize(GLuint program, std::string_view blockName,
+                                  std::size_t size) {
+  const auto blockIndex{glGetUniformBlockIndex(program, blockName.data())};
+  if (blockIndex == GL_INVALID_INDEX) return;
+
+  GLint dataSize{};
+  glGetActiveUniformBlockiv(program, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE,
+                            &dataSize);
+  if (static_cast<std::size_t>(dataSize) > size) {
+    throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
+        "Uniform block {} has {} bytes but the C++ struct has only {}",
+        blockName, dataSize, size))};
+  }
+}
+
+/**
+ * @brief Creates the buffer object.
+ *
+ * @param bytesPerFrame Maximum number of bytes pushed in a single frame,
+ * including the padding required by GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+ * @param framesInFlight Number of frames the ring holds before a segment is
+ * overwritten.
+ *
+ * @throw abcg::Exception if the buffer cannot be mapped.
+ */
+void abcg::UniformBuffer::create(GLsizeiptr bytesPerFrame,
+                                 int framesInFlight) {
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &m_offsetAlignment);
+  m_offsetAlignment = std::max(m_offsetAlignment, 1);
+
+  m_stream.create(bytesPerFrame, framesInFlight);
+}
+
+/**
+ * @brief Releases the buffer object.
+ */
+void abcg::UniformBuffer::destroy() { m_stream.destroy(); }
+
+/**
+ * @brief Moves on to the next segment of the ring.
+ *
+ * Must be called once per frame before the first push. May wait for the GPU
+ * to finish reading the segment.
+ */
+void abcg::UniformBuffer::beginFrame() { m_stream.beginFrame(); }
+
+/**
+ * @brief Copies data into the buffer segment of the current frame.
+ *
+ * @param data Pointer to the data.
+ * @param size Size of the data in bytes.
+ * @return Offset of the data in the buffer, to be used with bindRange.
+ *
+ * @throw abcg::Exception if the frame segment is full.
+ */
+GLintptr abcg::UniformBuffer::push(const void *data, GLsizeiptr size) {
+  return m_stream.push(data, size,
+                       static_cast<GLsizeiptr>(m_offsetAlignment));
+}
+
+/**
+ * @brief Makes the blocks pushed in the current frame visible to OpenGL.
+ *
+ * Must be called before the blocks are bound. See
+ * abcg::StreamingBuffer::flush.
+ */
+void abcg::UniformBuffer::upload() { m_stream.flush(); }
+
+/**
+ * @brief Binds a block to a uniform block binding point.
+ *
+ * @param bindingPoint Binding point set with glUniformBlockBinding.
+ * @param offset Offset returned by push.
+ * @param size Size of the block in bytes.
+ */
+void abcg::UniformBuffer::bindRange(GLuint bindingPoint, GLintptr offset,
+                                    GLsizeiptr size) const {
+  glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, m_stream.getBuffer(),
+                    offset, size);
+}
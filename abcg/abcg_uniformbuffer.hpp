@@ -0,0 +1,123 @@
+/**
+ * @file abcg_uniformbuffer.hpp
+ * @brief abcg::UniformBuffer header file.
+ *
+ * Declaration of abcg::UniformBuffer class and of std140 layout helpers.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_UNIFORMBUFFER_HPP_
+#define ABCG_UNIFORMBUFFER_HPP_
+
+#include <array>
+#include <cstddef>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <string_view>
+#include <type_traits>
+
+#include "abcg_external.hpp"
+#include "abcg_streamingbuffer.hpp"
+
+namespace abcg {
+class UniformBuffer;
+}  // namespace abcg
+
+/**
+ * @brief Helper types for declaring C++ structs that mirror GLSL uniform
+ * blocks declared with `layout(std140)`.
+ *
+ * Scalars, `vec2`, `vec4` and `mat4` already have matching size and alignment
+ * in GLM and can be used directly. `vec3` and `mat3` must use the types below.
+ * A `Vec3` occupies 16 bytes, so in GLSL a `vec3` must not be followed by a
+ * scalar packed into its last component.
+ */
+namespace abcg::std140 {
+/**
+ * @brief `vec3` with the 16-byte base alignment of std140.
+ */
+struct alignas(16) Vec3 {
+  glm::vec3 value{};
+
+  Vec3() = default;
+  // NOLINTNEXTLINE(hicpp-explicit-conversions)
+  Vec3(const glm::vec3& v) : value{v} {}
+  Vec3& operator=(const glm::vec3& v) {
+    value = v;
+    return *this;
+  }
+};
+
+/**
+ * @brief `mat3` stored as three columns padded to `vec4`, as in std140.
+ */
+struct alignas(16) Mat3 {
+  std::array<glm::vec4, 3> columns{};
+
+  Mat3() = default;
+  // NOLINTNEXTLINE(hicpp-explicit-conversions)
+  Mat3(const glm::mat3& m) { *this = m; }
+  Mat3& operator=(const glm::mat3& m) {
+    for (std::size_t i{}; i < columns.size(); ++i) {
+      columns.at(i) = glm::vec4(m[static_cast<glm::length_t>(i)], 0.0f);
+    }
+    return *this;
+  }
+};
+
+static_assert(sizeof(Vec3) == 16);
+static_assert(sizeof(Mat3) == 48);
+
+void checkBlockSize(GLuint program, std::string_view blockName,
+                    std::size_t size);
+}  // namespace abcg::std140
+
+/**
+ * @brief abcg::UniformBuffer class.
+ *
+ * Ring-buffered uniform buffer object for per-frame and per-object data.
+ *
+ * Blocks are sub-allocated from an abcg::StreamingBuffer with the offset
+ * alignment required for uniform buffers, so each push is a bump allocation
+ * plus a copy into persistently mapped memory where available. After upload,
+ * blocks are bound to uniform block binding points with glBindBufferRange.
+ */
+class abcg::UniformBuffer {
+ public:
+  void create(GLsizeiptr bytesPerFrame, int framesInFlight = 3);
+  void destroy();
+
+  void beginFrame();
+  GLintptr push(const void* data, GLsizeiptr size);
+  template <typename T>
+  GLintptr push(const T& block);
+  void upload();
+
+  void bindRange(GLuint bindingPoint, GLintptr offset, GLsizeiptr size) const;
+
+  [[nodiscard]] GLuint getBuffer() const noexcept {
+    return m_stream.getBuffer();
+  }
+
+ private:
+  StreamingBuffer m_stream;
+  GLint m_offsetAlignment{};
+};
+
+/**
+ * @brief Copies a block into the buffer segment of the current frame.
+ *
+ * @tparam T Type of a struct that mirrors a std140 uniform block.
+ * @param block Block data.
+ * @return Offset of the block in the buffer, to be used with bindRange.
+ */
+template <typename T>
+GLintptr abcg::UniformBuffer::push(const T& block) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  return push(&block, sizeof(T));
+}
+
+#endif
@@ -376,6 +376,8 @@ static void ImGui_ImplSDL2_UpdateGamepads() {
 }
 
 void ImGui_ImplSDL2_NewFrame(SDL_Window *window) {
+  // ABCg: windows of an application have their own ImGui contexts
+  g_Window = window;
   ImGuiIO &io = ImGui::GetIO();
   IM_ASSERT(io.Fonts->IsBuilt() &&
             "Font atlas not built! It is generally built by the renderer "
@@ -10,8 +10,12 @@ int main(int argc, char **argv) {
 
     // Create OpenGL window
     auto window{std::make_unique<OpenGLWindow>()};
-    window->setWindowSettings(
-        {.width = 800, .height = 600, .title = "Jogo da Memória"});
+    // The board is static between clicks, so it is painted only on input
+    // and when a timeout of the game expires
+    window->setWindowSettings({.width = 800,
+                               .height = 600,
+                               .renderOnDemand = true,
+                               .title = "Jogo da Memória"});
 
     // Run application
     app.run(window);
@@ -4,6 +4,7 @@
 #include <imgui.h>
 
 #include <array>
+#include <cmath>
 #include <cppitertools/itertools.hpp>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
@@ -38,25 +39,24 @@ void OpenGLWindow::initializeGL() {
   // Create shader program
   m_program = createProgramFromString(vertexShader, fragmentShader);
 
+  // Create batch for the triangles of all cards
+  m_batch.create(m_program, 16);
+
   // Clear window
-  glClearColor(0, 0, 0, 1);
-  glClear(GL_COLOR_BUFFER_BIT);
+  abcg::glClearColor(0, 0, 0, 1);
+  abcg::glClear(GL_COLOR_BUFFER_BIT);
 
   restart(GameDificulty::Easy); // Starts the game with Easy mode
 }
 
 void OpenGLWindow::paintGL() {
-  glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+  abcg::glViewport(0, 0, m_viewportWidth, m_viewportHeight);
   update();
-  glClear(GL_COLOR_BUFFER_BIT);
-  glUseProgram(m_program);
-  for (int i = 0; i < m_N * m_N; i++) {
-    Card* cd = &(cards[i]);
-    glBindVertexArray(cd->m_vao);
-    glDrawArrays(GL_TRIANGLES, 0, 3);
-    glBindVertexArray(0);
-  }
-  glUseProgram(0);
+  abcg::glClear(GL_COLOR_BUFFER_BIT);
+  abcg::glUseProgram(m_program);
+  // Whole board in a single draw call
+  m_batch.render();
+  abcg::glUseProgram(0);
 }
 
 void OpenGLWindow::paintUI() {
@@ -155,9 +155,11 @@ void OpenGLWindow::paintUI() {
           if (m_gameState == GameState::Play && cards[offset].showing != 2) {
             if (ImGui::IsItemClicked()) {
               cards[offset].showing = 1;
+              m_boardChanged = true;
               qntShowing++;
               checkEquals();
               checkWin();
+              requestRepaint();
             }
           }
           ImGui::NextColumn();
@@ -166,6 +168,21 @@ void OpenGLWindow::paintUI() {
       ImGui::End();
     }
   }
+
+  // Paint again when a timeout expires or the elapsed time changes
+  switch (m_gameState) {
+    case GameState::Starting:
+      requestRepaint(3 - timer.elapsed());
+      break;
+    case GameState::Waiting:
+      requestRepaint(1 - timer.elapsed());
+      break;
+    case GameState::Play:
+      requestRepaint(1 - std::fmod(universalTimer.elapsed(), 1.0));
+      break;
+    case GameState::WinPlayer:
+      break;
+  }
 }
 
 // Cheack if cards are equal
@@ -218,6 +235,7 @@ void OpenGLWindow::update() {
         cards[i].showing = 0;
       }
     }
+    m_boardChanged = true;
   }
   // Controls when ALL the cards are hidden in the beggining of the game
   if (m_gameState == GameState::Starting && timer.elapsed() > 3) {
@@ -225,12 +243,12 @@ void OpenGLWindow::update() {
     for (int i = 0; i < m_N * m_N; i++) {
       cards[i].showing = 0;
     }
+    m_boardChanged = true;
     universalTimer.restart();
   }
-  for (int i = 0; i < m_N * m_N; i++) {
-    Card* cd;
-    cd = &(cards[i]);
-    createTriangle(cd, i);
+  // Rebuild the triangles only if a card changed
+  if (m_boardChanged) {
+    buildBoard();
   }
 }
 
@@ -238,34 +256,38 @@ void OpenGLWindow::update() {
 void OpenGLWindow::restart(GameDificulty dificulty) {
   m_gameState = GameState::Starting;
   qntShowing = 0;
-  m_N = 4;
-  int values[] = {0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7};
+  int pairs = m_N * m_N / 2;
+  std::vector<int> values(m_N * m_N);
+  for (int i = 0; i < m_N * m_N; i++) {
+    values[i] = i % pairs;
+  }
   std::random_device rd;
   std::mt19937 g(rd());
-  std::shuffle(values, values + m_N * m_N, g);
+  std::shuffle(values.begin(), values.end(), g);
 
-  float colors[8][9];
-  for (int i = 0; i < 8; i++) {
+  std::vector<std::array<float, 9>> colors(pairs);
+  for (int i = 0; i < pairs; i++) {
     for (int j = 0; j < 9; j++) {
       colors[i][j] = ((double)rand() / (RAND_MAX));
     }
   }
 
   if (dificulty == GameDificulty::Easy) {
-    for (int i = 0; i < 8; i++) {
+    for (int i = 0; i < pairs; i++) {
       for (int j = 0; j < 3; j++) {
         colors[i][j + 3] = colors[i][j];
         colors[i][j + 6] = colors[i][j];
       }
     }
   } else if (dificulty == GameDificulty::Medium) {
-    for (int i = 0; i < 8; i++) {
+    for (int i = 0; i < pairs; i++) {
       for (int j = 0; j < 3; j++) {
         colors[i][j + 3] = colors[i][j];
       }
     }
   }
 
+  cards.resize(m_N * m_N);
   for (int i = 0; i < m_N * m_N; i++) {
     Card cd;
     cd.value = values[i];
@@ -275,11 +297,16 @@ void OpenGLWindow::restart(GameDificulty dificulty) {
     }
     cards[i] = cd;
   }
+  buildBoard();
+}
+
+// Rebuilds the batch with the triangles of all cards
+void OpenGLWindow::buildBoard() {
+  m_batch.clear();
   for (int i = 0; i < m_N * m_N; i++) {
-    Card* cd;
-    cd = &(cards[i]);
-    createTriangle(cd, i);
+    createTriangle(cards[i], i);
   }
+  m_boardChanged = false;
 }
 
 // Convert seconds to hours, minutes, seconds
@@ -299,93 +326,51 @@ std::string OpenGLWindow::convertTimeSeconds() {
 void OpenGLWindow::resizeGL(int width, int height) {
   m_viewportWidth = width;
   m_viewportHeight = height;
+  // Card positions depend on the window height
+  m_boardChanged = true;
+  requestRepaint();
 
-  glClear(GL_COLOR_BUFFER_BIT);
+  abcg::glClear(GL_COLOR_BUFFER_BIT);
 }
 
 void OpenGLWindow::terminateGL() {
-  glDeleteProgram(m_program);
-  for (int i = 0; i <= m_N * m_N; i++) {
-    Card* cd = &(cards[i]);
-    glDeleteBuffers(1, &(cd->m_vboPositions));
-    glDeleteBuffers(1, &(cd->m_vboColors));
-    glDeleteVertexArrays(1, &(cd->m_vao));
-  }
+  m_batch.destroy();
+  abcg::glDeleteProgram(m_program);
 }
 
-// Triangle definitions (position, color, vbo, vao...)
-void OpenGLWindow::createTriangle(Card* cd, int pos) {
-  glDeleteBuffers(1, &(cd->m_vboPositions));
-  glDeleteBuffers(1, &(cd->m_vboColors));
-  glDeleteVertexArrays(1, &(cd->m_vao));
-
+// Adds the triangle of a card to the batch
+void OpenGLWindow::createTriangle(const Card& cd, int pos) {
   float header = 2.0 * (110.0 / getWindowSettings().height);
   float footer = 2.0 * (15.0 / getWindowSettings().height);
   float sep = 2.0 * (4.0 / getWindowSettings().height);
-  float buttonHeight = (2.0 - header - footer) / 4.0 - sep;
+  float buttonHeight = (2.0 - header - footer) / m_N - sep;
+  float buttonWidth = 2.0 / m_N;
 
-  int x_add = pos % 4;
-  int y_add = (int)pos / 4;
+  int x_add = pos % m_N;
+  int y_add = (int)pos / m_N;
 
-  float x1 = -1.0 + 0.5 * x_add + 0.075;
-  float y1 = 1.0 - header - (y_add + 1.0) * (buttonHeight + sep) + 0.05;
-  float x2 = -0.75 + 0.5 * x_add;
-  float y2 = 1.0 - header - (y_add) * (buttonHeight + sep) - 0.05;
-  float x3 = -0.5 + 0.5 * x_add - 0.075;
-  float y3 = 1.0 - header - (y_add + 1.0) * (buttonHeight + sep) + 0.05;
+  // Margins inside the button, relative to the 4x4 board
+  float marginX = 0.3 / m_N;
+  float marginY = 0.2 / m_N;
 
-  // Create vertex positions
+  float x1 = -1.0 + buttonWidth * x_add + marginX;
+  float y1 = 1.0 - header - (y_add + 1.0) * (buttonHeight + sep) + marginY;
+  float x2 = -1.0 + buttonWidth * (x_add + 0.5);
+  float y2 = 1.0 - header - (y_add) * (buttonHeight + sep) - marginY;
+  float x3 = -1.0 + buttonWidth * (x_add + 1.0) - marginX;
+  float y3 = 1.0 - header - (y_add + 1.0) * (buttonHeight + sep) + marginY;
+
+  // Vertex positions
   std::array positions{glm::vec2(x1, y1), glm::vec2(x2, y2), glm::vec2(x3, y3)};
 
-  std::vector<glm::vec4> colors(0);
-  // Create vertex colors
-  if (cd->showing != 0) {
-    colors.push_back(
-        glm::vec4{cd->colors[0], cd->colors[1], cd->colors[2], 1.0f});
-    colors.push_back(
-        glm::vec4{cd->colors[3], cd->colors[4], cd->colors[5], 1.0f});
-    colors.push_back(
-        glm::vec4{cd->colors[6], cd->colors[7], cd->colors[8], 1.0f});
+  // Vertex colors
+  if (cd.showing != 0) {
+    m_batch.addTriangle(
+        positions,
+        {glm::vec4{cd.colors[0], cd.colors[1], cd.colors[2], 1.0f},
+         glm::vec4{cd.colors[3], cd.colors[4], cd.colors[5], 1.0f},
+         glm::vec4{cd.colors[6], cd.colors[7], cd.colors[8], 1.0f}});
   } else {
-    colors.push_back(glm::vec4{0.39f, 0.39f, 0.39f, 1.0f});
-    colors.push_back(glm::vec4{0.39f, 0.39f, 0.39f, 1.0f});
-    colors.push_back(glm::vec4{0.39f, 0.39f, 0.39f, 1.0f});
+    m_batch.addTriangle(positions, glm::vec4{0.39f, 0.39f, 0.39f, 1.0f});
   }
-
-  // Generate VBO of positions
-  glGenBuffers(1, &(cd->m_vboPositions));
-  glBindBuffer(GL_ARRAY_BUFFER, cd->m_vboPositions);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(positions), positions.data(),
-               GL_STATIC_DRAW);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Generate VBO of colors
-  glGenBuffers(1, &(cd->m_vboColors));
-  glBindBuffer(GL_ARRAY_BUFFER, cd->m_vboColors);
-  glBufferData(GL_ARRAY_BUFFER, colors.size() * sizeof(glm::vec4),
-               colors.data(), GL_STATIC_DRAW);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Get location of attributes in the program
-  GLint positionAttribute{glGetAttribLocation(m_program, "inPosition")};
-  GLint colorAttribute{glGetAttribLocation(m_program, "inColor")};
-
-  // Create VAO
-  glGenVertexArrays(1, &(cd->m_vao));
-
-  // Bind vertex attributes to current VAO
-  glBindVertexArray(cd->m_vao);
-
-  glEnableVertexAttribArray(positionAttribute);
-  glBindBuffer(GL_ARRAY_BUFFER, cd->m_vboPositions);
-  glVertexAttribPointer(positionAttribute, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  glEnableVertexAttribArray(colorAttribute);
-  glBindBuffer(GL_ARRAY_BUFFER, cd->m_vboColors);
-  glVertexAttribPointer(colorAttribute, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // End of binding to current VAO
-  glBindVertexArray(0);
-}
\ No newline at end of file
+}
@@ -7,6 +7,7 @@
 #include <glm/vec4.hpp>
 #include <string>
 #include <random>
+#include <vector>
 
 #include "abcg.hpp"
 
@@ -25,28 +26,28 @@ class OpenGLWindow : public abcg::OpenGLWindow {
  
   enum class GameState {Play, WinPlayer, Waiting, Starting}; // Game states
   enum class GameDificulty {Easy, Medium, Hard}; // Levels of dificulty
-  int m_N{};  // Board size is m_N x m_N
+  int m_N{4};  // Board size is m_N x m_N
 
   // Definition of a card
   struct Card {
     int value;
     int showing;
     float colors[9];
-    GLuint m_vao;
-    GLuint m_vboPositions;
-    GLuint m_vboColors;
   };
   typedef struct Card Card;
 
   GameState m_gameState{};
   // GameDificulty m_gameDificulty{GameDificulty::Easy};
-  Card cards[16]; // Cards in the game
+  std::vector<Card> cards; // Cards in the game, m_N x m_N
+  abcg::BatchRenderer2D m_batch; // Triangles of all cards
+  bool m_boardChanged{true}; // Whether the batch must be rebuilt
   int qntShowing {0}; // Number of cards showing on the screen 
   abcg::ElapsedTimer timer; // Amount of time showing the cards in the beggining
   abcg::ElapsedTimer universalTimer; // Game time
   std::string elapsedTimeWin{}; // Time when player wins
 
-  void createTriangle(Card* cd, int pos); // Triangle definitions (position, color, vbo, vao...)
+  void createTriangle(const Card& cd, int pos); // Adds the triangle of a card to the batch
+  void buildBoard(); // Rebuilds the batch with the triangles of all cards
   void restart(GameDificulty dificulty); // Start new game 
   void checkWin(); // Check if the player won
   void checkEquals(); // Check if they are equal cards
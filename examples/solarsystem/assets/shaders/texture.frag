@@ -7,19 +7,23 @@ in vec2 fragTexCoord;
 in vec3 fragPObj;
 in vec3 fragNObj;
 
-// Light properties
-uniform vec4 Ia, Id, Is;
-
-// Material properties
-uniform vec4 Ka, Kd, Ks;
-uniform float shininess;
-
-// Diffuse texture sampler
+#include "uniformblocks.glsl"
+
+// Diffuse texture sampler. With TEXTURE_ARRAY, the maps of all objects are
+// layers of a single texture, selected per instance (GLSL ES has no default
+// precision for sampler2DArray)
+#ifdef TEXTURE_ARRAY
+uniform mediump sampler2DArray diffuseTex;
+flat in float fragLayer;
+#else
 uniform sampler2D diffuseTex;
+#endif
 
-// Mapping mode
+// Mapping mode, selected at compile time
 // 0: triplanar; 1: cylindrical; 2: spherical; 3: from mesh
-uniform int mappingMode;
+#ifndef MAPPING_MODE
+#define MAPPING_MODE 3
+#endif
 
 out vec4 outColor;
 
@@ -40,7 +44,11 @@ vec4 BlinnPhong(vec3 N, vec3 L, vec3 V, vec2 texCoord) {
     specular = pow(angle, shininess);
   }
 
+#ifdef TEXTURE_ARRAY
+  vec4 map_Kd = texture(diffuseTex, vec3(texCoord, fragLayer));
+#else
   vec4 map_Kd = texture(diffuseTex, texCoord);
+#endif
   vec4 map_Ka = map_Kd;
 
   vec4 diffuseColor = map_Kd * Kd * Id * lambertian;
@@ -82,41 +90,40 @@ vec2 SphericalMapping(vec3 P) {
 void main() {
   vec4 color;
 
-  if (mappingMode == 0) {
-    // Triplanar mapping
-
-    // A offset to center the texture around the origin
-    vec3 offset = vec3(-0.5, -0.5, -0.5);
-
-    // Sample with x planar mapping
-    vec2 texCoord1 = PlanarMappingX(fragPObj + offset);
-    vec4 color1 = BlinnPhong(fragN, fragL, fragV, texCoord1);
-
-    // Sample with y planar mapping
-    vec2 texCoord2 = PlanarMappingY(fragPObj + offset);
-    vec4 color2 = BlinnPhong(fragN, fragL, fragV, texCoord2);
-
-    // Sample with z planar mapping
-    vec2 texCoord3 = PlanarMappingZ(fragPObj + offset);
-    vec4 color3 = BlinnPhong(fragN, fragL, fragV, texCoord3);
-
-    // Compute average based on normal
-    vec3 weight = abs(normalize(fragNObj));
-    color = color1 * weight.x + color2 * weight.y + color3 * weight.z;
-  } else {
-    vec2 texCoord;
-    if (mappingMode == 1) {
-      // Cylindrical mapping
-      texCoord = CylindricalMapping(fragPObj);
-    } else if (mappingMode == 2) {
-      // Spherical mapping
-      texCoord = SphericalMapping(fragPObj);
-    } else if (mappingMode == 3) {
-      // From mesh
-      texCoord = fragTexCoord;
-    }
-    color = BlinnPhong(fragN, fragL, fragV, texCoord);
-  }
+#if MAPPING_MODE == 0
+  // Triplanar mapping
+
+  // A offset to center the texture around the origin
+  vec3 offset = vec3(-0.5, -0.5, -0.5);
+
+  // Sample with x planar mapping
+  vec2 texCoord1 = PlanarMappingX(fragPObj + offset);
+  vec4 color1 = BlinnPhong(fragN, fragL, fragV, texCoord1);
+
+  // Sample with y planar mapping
+  vec2 texCoord2 = PlanarMappingY(fragPObj + offset);
+  vec4 color2 = BlinnPhong(fragN, fragL, fragV, texCoord2);
+
+  // Sample with z planar mapping
+  vec2 texCoord3 = PlanarMappingZ(fragPObj + offset);
+  vec4 color3 = BlinnPhong(fragN, fragL, fragV, texCoord3);
+
+  // Compute average based on normal
+  vec3 weight = abs(normalize(fragNObj));
+  color = color1 * weight.x + color2 * weight.y + color3 * weight.z;
+#else
+#if MAPPING_MODE == 1
+  // Cylindrical mapping
+  vec2 texCoord = CylindricalMapping(fragPObj);
+#elif MAPPING_MODE == 2
+  // Spherical mapping
+  vec2 texCoord = SphericalMapping(fragPObj);
+#else
+  // From mesh
+  vec2 texCoord = fragTexCoord;
+#endif
+  color = BlinnPhong(fragN, fragL, fragV, texCoord);
+#endif
 
   if (gl_FrontFacing) {
     outColor = color;
@@ -4,12 +4,15 @@ layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inTexCoord;
 
-uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
-uniform mat3 normalMatrix;
+// Per-instance attributes (Instance in model.hpp), used instead of the
+// matrices of ObjectData if INSTANCED is defined
+#ifdef INSTANCED
+layout(location = 3) in mat4 inModelMatrix;
+layout(location = 7) in mat3 inNormalMatrix;
+layout(location = 10) in float inLayer;
+#endif
 
-uniform vec4 lightDirWorldSpace;
+#include "uniformblocks.glsl"
 
 out vec3 fragV;
 out vec3 fragL;
@@ -17,10 +20,22 @@ out vec3 fragN;
 out vec2 fragTexCoord;
 out vec3 fragPObj;
 out vec3 fragNObj;
+// Layer of the diffuse texture array (requires INSTANCED)
+#ifdef TEXTURE_ARRAY
+flat out float fragLayer;
+#endif
 
 void main() {
-  vec3 P = (viewMatrix * modelMatrix * vec4(inPosition, 1.0)).xyz;
-  vec3 N = normalMatrix * inNormal;
+#ifdef INSTANCED
+  mat4 M = inModelMatrix;
+  mat3 normalM = inNormalMatrix;
+#else
+  mat4 M = modelMatrix;
+  mat3 normalM = normalMatrix;
+#endif
+
+  vec3 P = (viewMatrix * M * vec4(inPosition, 1.0)).xyz;
+  vec3 N = normalM * inNormal;
   vec3 L = -(viewMatrix * lightDirWorldSpace).xyz;
 
   fragL = L;
@@ -29,6 +44,9 @@ void main() {
   fragTexCoord = inTexCoord;
   fragPObj = inPosition;
   fragNObj = inNormal;
+#ifdef TEXTURE_ARRAY
+  fragLayer = inLayer;
+#endif
 
   gl_Position = projMatrix * vec4(P, 1.0);
 }
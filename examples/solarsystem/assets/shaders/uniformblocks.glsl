@@ -0,0 +1,18 @@
+// Uniform blocks shared by texture.vert and texture.frag.
+// C++ mirrors: FrameData and ObjectData in openglwindow.hpp
+
+// Per-frame data
+layout(std140) uniform FrameData {
+  mat4 viewMatrix;
+  mat4 projMatrix;
+  vec4 lightDirWorldSpace;
+  vec4 Ia, Id, Is;
+};
+
+// Per-object data
+layout(std140) uniform ObjectData {
+  mat4 modelMatrix;
+  mat3 normalMatrix;
+  vec4 Ka, Kd, Ks;
+  float shininess;
+};
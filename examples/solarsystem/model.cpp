@@ -22,11 +22,17 @@ struct hash<Vertex> {
 }  // namespace std
 
 Model::~Model() {
-  glDeleteTextures(1, &m_normalTexture);
-  glDeleteTextures(1, &m_diffuseTexture);
-  glDeleteBuffers(1, &m_EBO);
-  glDeleteBuffers(1, &m_VBO);
-  glDeleteVertexArrays(1, &m_VAO);
+  abcg::glDeleteTextures(1, &m_normalTexture);
+  abcg::glDeleteTextures(1, &m_diffuseTexture);
+}
+
+// Copies the mesh into a slice of buffers shared with other models, to be
+// drawn with abcg::DrawList. The geometry buffer must use the layout of
+// Vertex. A model drawn this way never creates buffers of its own
+abcg::GeometryBuffer::MeshID Model::addToGeometry(
+    abcg::GeometryBuffer& geometry) const {
+  return geometry.add(std::span<const Vertex>{m_vertices},
+                      std::span<const GLuint>{m_indices});
 }
 
 void Model::computeNormals() {
@@ -124,37 +130,17 @@ void Model::computeTangents() {
   }
 }
 
-void Model::createBuffers() {
-  // Delete previous buffers
-  glDeleteBuffers(1, &m_EBO);
-  glDeleteBuffers(1, &m_VBO);
-
-  // VBO
-  glGenBuffers(1, &m_VBO);
-  glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(m_vertices[0]) * m_vertices.size(),
-               m_vertices.data(), GL_STATIC_DRAW);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // EBO
-  glGenBuffers(1, &m_EBO);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(m_indices[0]) * m_indices.size(),
-               m_indices.data(), GL_STATIC_DRAW);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-}
-
 void Model::loadDiffuseTexture(std::string_view path) {
   if (!std::filesystem::exists(path)) return;
 
-  glDeleteTextures(1, &m_diffuseTexture);
+  abcg::glDeleteTextures(1, &m_diffuseTexture);
   m_diffuseTexture = abcg::opengl::loadTexture(path);
 }
 
 void Model::loadNormalTexture(std::string_view path) {
   if (!std::filesystem::exists(path)) return;
 
-  glDeleteTextures(1, &m_normalTexture);
+  abcg::glDeleteTextures(1, &m_normalTexture);
   m_normalTexture = abcg::opengl::loadTexture(path);
 }
 
@@ -279,81 +265,6 @@ void Model::loadFromFile(std::string_view path, bool standardize) {
   if (m_hasTexCoords) {
     computeTangents();
   }
-
-  createBuffers();
-}
-
-void Model::render(int numTriangles) const {
-  glBindVertexArray(m_VAO);
-
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, m_diffuseTexture);
-
-  glActiveTexture(GL_TEXTURE1);
-  glBindTexture(GL_TEXTURE_2D, m_normalTexture);
-
-  // Set minification and magnification parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-  // Set texture wrapping parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-  GLsizei numIndices = (numTriangles < 0) ? m_indices.size() : numTriangles * 3;
-
-  glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, nullptr);
-
-  glBindVertexArray(0);
-}
-
-void Model::setupVAO(GLuint program) {
-  //Release previous VAO
-  glDeleteVertexArrays(1, &m_VAO);
-
-  // Create VAO
-  glGenVertexArrays(1, &m_VAO);
-  glBindVertexArray(m_VAO);
-
-  // Bind EBO and VBO
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-  glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-
-  // Bind vertex attributes
-  GLint positionAttribute{glGetAttribLocation(program, "inPosition")};
-  if (positionAttribute >= 0) {
-    glEnableVertexAttribArray(positionAttribute);
-    glVertexAttribPointer(positionAttribute, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(Vertex), nullptr);
-  }
-
-  GLint normalAttribute{glGetAttribLocation(program, "inNormal")};
-  if (normalAttribute >= 0) {
-    glEnableVertexAttribArray(normalAttribute);
-    GLsizei offset{sizeof(glm::vec3)};
-    glVertexAttribPointer(normalAttribute, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(Vertex), reinterpret_cast<void*>(offset));
-  }
-
-  GLint texCoordAttribute{glGetAttribLocation(program, "inTexCoord")};
-  if (texCoordAttribute >= 0) {
-    glEnableVertexAttribArray(texCoordAttribute);
-    GLsizei offset{sizeof(glm::vec3) + sizeof(glm::vec3)};
-    glVertexAttribPointer(texCoordAttribute, 2, GL_FLOAT, GL_FALSE,
-                          sizeof(Vertex), reinterpret_cast<void*>(offset));
-  }
-
-  GLint tangentCoordAttribute{glGetAttribLocation(program, "inTangent")};
-  if (tangentCoordAttribute >= 0) {
-    glEnableVertexAttribArray(tangentCoordAttribute);
-    GLsizei offset{sizeof(glm::vec3) + sizeof(glm::vec3) + sizeof(glm::vec2)};
-    glVertexAttribPointer(tangentCoordAttribute, 4, GL_FLOAT, GL_FALSE,
-                          sizeof(Vertex), reinterpret_cast<void*>(offset));
-  }
-
-  // End of binding
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
 }
 
 void Model::standardize() {
@@ -19,6 +19,15 @@ struct Vertex {
   }
 };
 
+// Per-instance attributes read by draws of meshes in a shared
+// abcg::GeometryBuffer
+struct Instance {
+  glm::mat4 modelMatrix{1.0f};
+  glm::mat3 normalMatrix{1.0f};
+  // Layer of the diffuse texture, for maps packed into a texture array
+  float layer{};
+};
+
 class Model {
  public:
   Model() = default;
@@ -32,8 +41,8 @@ class Model {
   void loadDiffuseTexture(std::string_view path);
   void loadNormalTexture(std::string_view path);
   void loadFromFile(std::string_view path, bool standardize = true);
-  void render(int numTriangles = -1) const;
-  void setupVAO(GLuint program);
+  [[nodiscard]] abcg::GeometryBuffer::MeshID addToGeometry(
+      abcg::GeometryBuffer& geometry) const;
 
   [[nodiscard]] int getNumTriangles() const {
     return static_cast<int>(m_indices.size()) / 3;
@@ -47,10 +56,6 @@ class Model {
   [[nodiscard]] bool isUVMapped() const { return m_hasTexCoords; }
 
  private:
-  GLuint m_VAO{};
-  GLuint m_VBO{};
-  GLuint m_EBO{};
-
   glm::vec4 m_Ka;
   glm::vec4 m_Kd;
   glm::vec4 m_Ks;
@@ -66,7 +71,6 @@ class Model {
 
   void computeNormals();
   void computeTangents();
-  void createBuffers();
   void standardize();
 };
 
@@ -2,10 +2,53 @@
 
 #include <imgui.h>
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <cppitertools/itertools.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
 #include <fmt/core.h>
+#include <random>
 #include <string> 
+#include <unordered_map>
+
+namespace {
+// Placement and rotation of each body, in the order of the filenames table
+struct BodyTransform {
+  glm::vec3 position{};
+  // Fixed rotation, in degrees
+  float tiltAngle{};
+  glm::vec3 tiltAxis{1.0f, 0.0f, 0.0f};
+  // Rotation per simulation step, in degrees
+  float spinSpeed{};
+  glm::vec3 spinAxis{0.0f, 1.0f, 0.0f};
+  float scale{1.0f};
+};
+
+const std::array<BodyTransform, 10> bodyTransforms{{
+    // Mercury
+    {{-2.15f, 0.0f, 0.0f}, 0.0f, {1, 0, 0}, 0.1f, {0, 1, 0}, 0.2f},
+    // Venus
+    {{-1.75f, 0.0f, 0.0f}, 0.0f, {1, 0, 0}, 0.03f, {0, 1, 0}, 0.35f},
+    // Earth
+    {{-1.25f, 0.0f, 0.0f}, 0.0f, {1, 0, 0}, 0.05f, {0, 1, 0}, 0.4f},
+    // Mars
+    {{-0.75f, 0.0f, 0.0f}, 90.0f, {1, 0, 0}, 0.12f, {0, 0, -1}, 0.35f},
+    // Jupyter
+    {{0.11f, 0.0f, 0.0f}, 90.0f, {1, 0, 0}, 0.07f, {0, 0, -1}, 1.0f},
+    // Saturn
+    {{1.5f, 0.0f, 0.0f}, 0.0f, {1, 0, 0}, 0.002f, {1, 0, 0}, 1.1f},
+    // Uranus
+    {{2.5f, 0.0f, 0.0f}, 180.0f, {0, 1, 0}, 0.004f, {1, 0, 0}, 0.7f},
+    // Neptune
+    {{3.2f, 0.0f, 0.0f}, 0.0f, {1, 0, 0}, 0.075f, {0, 1, 0}, 0.45f},
+    // Pluto
+    {{3.7f, 0.0f, 0.0f}, 0.0f, {1, 0, 0}, 0.4f, {0, 1, 0}, 0.15f},
+    // Sun
+    {{-3.5f, 0.0f, 0.0f}, 0.0f, {1, 0, 0}, 0.005f, {0, 0, 1}, 2.0f},
+}};
+}  // namespace
 
 void OpenGLWindow::handleEvent(SDL_Event& ev) {
   if (ev.type == SDL_KEYDOWN) {
@@ -21,6 +64,11 @@ void OpenGLWindow::handleEvent(SDL_Event& ev) {
     if (ev.key.keysym.sym == SDLK_e) m_truckSpeed = 0.3f;
     if (ev.key.keysym.sym == SDLK_r) m_liftSpeed = -0.3f;
     if (ev.key.keysym.sym == SDLK_f) m_liftSpeed = 0.3f;
+    if (ev.key.keysym.sym == SDLK_b) m_showAsteroids = !m_showAsteroids;
+    if (ev.key.keysym.sym == SDLK_EQUALS || ev.key.keysym.sym == SDLK_KP_PLUS)
+      m_numAsteroids = std::min(m_numAsteroids * 2, m_maxAsteroids);
+    if (ev.key.keysym.sym == SDLK_MINUS || ev.key.keysym.sym == SDLK_KP_MINUS)
+      m_numAsteroids = std::max(m_numAsteroids / 2, 256);
   }
   if (ev.type == SDL_KEYUP) {
     if ((ev.key.keysym.sym == SDLK_UP || ev.key.keysym.sym == SDLK_w) &&
@@ -43,229 +91,288 @@ void OpenGLWindow::handleEvent(SDL_Event& ev) {
 }
 
 void OpenGLWindow::initializeGL() {
-  glClearColor(0, 0, 0, 1);
-  glEnable(GL_DEPTH_TEST);
+  abcg::glClearColor(0, 0, 0, 1);
+  abcg::glEnable(GL_DEPTH_TEST);
 
+  // Texture mapping mode is a compile-time variant of the shaders (3: UV
+  // coordinates from mesh). Model and normal matrices and the layer of the
+  // texture array are per-instance attributes
   auto path{getAssetsPath() + "shaders/texture"};
-  auto program{createProgramFromFile(path + ".vert", path + ".frag")};
-  m_program = program;
+  m_program = getProgramVariant(
+      path + ".vert", path + ".frag",
+      {{"MAPPING_MODE", "3"}, {"INSTANCED", "1"}, {"TEXTURE_ARRAY", "1"}});
+
+  // Bind uniform blocks to fixed binding points
+  abcg::glUniformBlockBinding(
+      m_program, abcg::glGetUniformBlockIndex(m_program, "FrameData"),
+      m_frameDataBinding);
+  abcg::glUniformBlockBinding(
+      m_program, abcg::glGetUniformBlockIndex(m_program, "ObjectData"),
+      m_objectDataBinding);
+  abcg::std140::checkBlockSize(m_program, "FrameData", sizeof(FrameData));
+  abcg::std140::checkBlockSize(m_program, "ObjectData", sizeof(ObjectData));
+
+  // Uniforms that never change are set only once
+  abcg::glUseProgram(m_program);
+  abcg::glUniform1i(abcg::glGetUniformLocation(m_program, "diffuseTex"), 0);
+  abcg::glUniform1i(abcg::glGetUniformLocation(m_program, "normalTex"), 1);
+  abcg::glUseProgram(0);
+
+  // Room for one FrameData and the ObjectData of the sun and of the other
+  // bodies, with alignment slack
+  constexpr auto numBlocks{1 + 2};
+  m_uniformBuffer.create(numBlocks * (sizeof(ObjectData) + 256));
+
+  // Room for one Instance per planet and per asteroid
+  constexpr auto maxInstances{10 + m_maxAsteroids};
+  m_instanceBuffer.create(maxInstances * sizeof(Instance) + 256);
+
+  // All meshes share one vertex array, with the vertex attributes of
+  // texture.vert and the per-instance attributes of Instance (one location
+  // per matrix column)
+  const auto attribute{[](GLuint location, GLint size, std::size_t offset) {
+    return abcg::VertexAttribute{location, size, GL_FLOAT,
+                                 static_cast<GLuint>(offset)};
+  }};
+  const std::array vertexAttributes{
+      attribute(0, 3, offsetof(Vertex, position)),
+      attribute(1, 3, offsetof(Vertex, normal)),
+      attribute(2, 2, offsetof(Vertex, texCoord))};
+  std::vector<abcg::VertexAttribute> instanceAttributes;
+  for (const auto column : iter::range(4U)) {
+    instanceAttributes.push_back(attribute(
+        3 + column, 4,
+        offsetof(Instance, modelMatrix) + column * sizeof(glm::vec4)));
+  }
+  for (const auto column : iter::range(3U)) {
+    instanceAttributes.push_back(attribute(
+        7 + column, 3,
+        offsetof(Instance, normalMatrix) + column * sizeof(glm::vec3)));
+  }
+  instanceAttributes.push_back(attribute(10, 1, offsetof(Instance, layer)));
+  m_geometry.create(sizeof(Vertex), vertexAttributes, sizeof(Instance),
+                    instanceAttributes);
+
+  // One packet per body, and one for the asteroids
+  m_renderQueue.create(10 + 1);
 
   loadModel();
+  createAsteroids();
 }
 
 void OpenGLWindow::loadModel() {
+  // Trilinear filtering and repeat wrapping for all maps
+  m_sampler = getSamplerCache().get();
 
+  // Bodies with the same mesh file share one model
+  std::unordered_map<std::string, std::size_t> meshIndices;
+  std::vector<std::string> mapPaths;
   for (int i = 0; i < 10; i++){
-    planets[i].m_model.loadFromFile(getAssetsPath() + filenames[i][0]);
-    planets[i].m_model.loadDiffuseTexture(getAssetsPath() + "maps/" + filenames[i][1]);
-    if (i == 6){
-      planets[i].m_model.loadDiffuseTexture(getAssetsPath() + "maps/uranus_rings.map");
+    const auto [it, inserted]{
+        meshIndices.try_emplace(filenames[i][0], m_meshes.size())};
+    if (inserted) {
+      Model model;
+      model.loadFromFile(getAssetsPath() + filenames[i][0]);
+      m_meshes.push_back(model.addToGeometry(m_geometry));
+
+      // Use material properties from the first loaded model
+      if (m_meshes.size() == 1) {
+        m_Ka = model.getKa();
+        m_Kd = model.getKd();
+        m_Ks = model.getKs();
+        m_shininess = 13.0f;
+      }
     }
-    planets[i].m_model.setupVAO(m_program);
-    planets[i].m_trianglesToDraw = planets[i].m_model.getNumTriangles();
+    planets[i].m_mesh = it->second;
+    mapPaths.push_back(getAssetsPath() + "maps/" + filenames[i][1]);
   }
 
-  // Use material properties from the loaded model
-  m_Ka = planets[0].m_model.getKa();
-  m_Kd = planets[0].m_model.getKd();
-  m_Ks = planets[0].m_model.getKs();
-  m_shininess = 13.0f;
+  // All maps in a single texture, at the size of the largest 2:1 maps
+  m_diffuseMaps = abcg::opengl::loadTextureArray(mapPaths, 2048, 1024);
 }
 
-void OpenGLWindow::paintGL() {
+void OpenGLWindow::createAsteroids() {
+  // Fixed seed so that benchmark runs draw the same belt
+  std::mt19937 generator{42};
+  std::uniform_real_distribution<float> radius{2.9f, 3.4f};
+  std::uniform_real_distribution<float> angle{0.0f, 360.0f};
+  std::uniform_real_distribution<float> speed{0.002f, 0.01f};
+  std::uniform_real_distribution<float> height{-0.08f, 0.08f};
+  std::uniform_real_distribution<float> unit{-1.0f, 1.0f};
+  std::uniform_real_distribution<float> spin{0.1f, 1.0f};
+  std::uniform_real_distribution<float> scale{0.005f, 0.02f};
+
+  m_asteroids.resize(m_maxAsteroids);
+  for (auto& asteroid : m_asteroids) {
+    asteroid.orbitRadius = radius(generator);
+    asteroid.orbitAngle = angle(generator);
+    asteroid.orbitSpeed = speed(generator);
+    asteroid.height = height(generator);
+    asteroid.spinAxis = glm::normalize(glm::vec3(
+        unit(generator), unit(generator), unit(generator) + 2.0f));
+    asteroid.spinSpeed = spin(generator);
+    asteroid.scale = scale(generator);
+  }
+  m_instances.reserve(10 + m_maxAsteroids);
+}
+
+void OpenGLWindow::fixedUpdate([[maybe_unused]] double timeStep) {
+  numberFramers++;
+}
+
+void OpenGLWindow::publishFrame(int slot) {
   update();
 
-  glEnable(GL_CULL_FACE);
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  glViewport(0, 0, m_viewportWidth, m_viewportHeight);
-
-  glUseProgram(m_program);
-
-  GLint viewMatrixLoc{glGetUniformLocation(m_program, "viewMatrix")};
-  GLint projMatrixLoc{glGetUniformLocation(m_program, "projMatrix")};
-  GLint modelMatrixLoc{glGetUniformLocation(m_program, "modelMatrix")};
-  GLint normalMatrixLoc{glGetUniformLocation(m_program, "normalMatrix")};
-  GLint lightDirLoc{glGetUniformLocation(m_program, "lightDirWorldSpace")};
-  GLint shininessLoc{glGetUniformLocation(m_program, "shininess")};
-  GLint IaLoc{glGetUniformLocation(m_program, "Ia")};
-  GLint IdLoc{glGetUniformLocation(m_program, "Id")};
-  GLint IsLoc{glGetUniformLocation(m_program, "Is")};
-  GLint KaLoc{glGetUniformLocation(m_program, "Ka")};
-  GLint KdLoc{glGetUniformLocation(m_program, "Kd")};
-  GLint KsLoc{glGetUniformLocation(m_program, "Ks")};
-  GLint diffuseTexLoc{glGetUniformLocation(m_program, "diffuseTex")};
-  GLint normalTexLoc{glGetUniformLocation(m_program, "normalTex")};
-  GLint mappingModeLoc{glGetUniformLocation(m_program, "mappingMode")};
-
-  glUniformMatrix4fv(viewMatrixLoc, 1, GL_FALSE, &m_camera.m_viewMatrix[0][0]);
-  glUniformMatrix4fv(projMatrixLoc, 1, GL_FALSE, &m_camera.m_projMatrix[0][0]);
-  
-  glUniform1i(diffuseTexLoc, 0);
-  glUniform1i(normalTexLoc, 1);
-  glUniform1i(mappingModeLoc, 3);
-
-  glUniform4fv(lightDirLoc, 1, &m_lightDir.x);
-  glUniform4fv(IaLoc, 1, &m_Ia.x);
-  glUniform4fv(IdLoc, 1, &m_Id.x);
-  glUniform4fv(IsLoc, 1, &m_Is.x);
-
-  float mat[4] = {1.0f, 1.0f, 1.0f, 1.0f};
-  glUniform1f(shininessLoc, 5000.0f);
-  glUniform4fv(KaLoc, 1, mat);
-  glUniform4fv(KdLoc, 1, mat);
-  glUniform4fv(KsLoc, 1, mat);
-
-  // Sun
-  planets[9].m_modelMatrix = glm::mat4(1.0);
-  planets[9].m_modelMatrix = glm::translate(planets[9].m_modelMatrix, glm::vec3(-3.5f, 0.0f, 0.0f));
-  planets[9].m_modelMatrix = glm::rotate(planets[9].m_modelMatrix, glm::radians(0.005f * numberFramers), glm::vec3(0, 0, 1));
-  planets[9].m_modelMatrix = glm::scale(planets[9].m_modelMatrix, glm::vec3(2.0f));
-  glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &planets[9].m_modelMatrix[0][0]);
-
-  auto modelViewMatrix{glm::mat3(m_camera.m_viewMatrix * planets[9].m_modelMatrix)};
-  glm::mat3 normalMatrix{glm::inverseTranspose(modelViewMatrix)};
-  glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
-
-  planets[9].m_model.render(planets[9].m_trianglesToDraw);
-
-  //------
-
-  glUniform1f(shininessLoc, m_shininess);
-  glUniform4fv(KaLoc, 1, &m_Ka.x);
-  glUniform4fv(KdLoc, 1, &m_Kd.x);
-  glUniform4fv(KsLoc, 1, &m_Ks.x);
-
-  // Mercury
-  planets[0].m_modelMatrix = glm::mat4(1.0);
-  planets[0].m_modelMatrix = glm::translate(planets[0].m_modelMatrix, glm::vec3(-2.15f, 0.0f, 0.0f));
-  planets[0].m_modelMatrix = glm::rotate(planets[0].m_modelMatrix, glm::radians(0.1f * numberFramers), glm::vec3(0, 1, 0));
-  planets[0].m_modelMatrix = glm::scale(planets[0].m_modelMatrix, glm::vec3(0.2f));
-  glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &planets[0].m_modelMatrix[0][0]);
-
-  modelViewMatrix = glm::mat3(m_camera.m_viewMatrix * planets[0].m_modelMatrix);
-  normalMatrix = glm::inverseTranspose(modelViewMatrix);
-  glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
-
-  planets[0].m_model.render(planets[0].m_trianglesToDraw);
-  //------
-
-  // Venus
-  planets[1].m_modelMatrix = glm::mat4(1.0);
-  planets[1].m_modelMatrix = glm::translate(planets[1].m_modelMatrix, glm::vec3(-1.75f, 0.0f, 0.0f));
-  planets[1].m_modelMatrix = glm::rotate(planets[1].m_modelMatrix, glm::radians(0.03f * numberFramers), glm::vec3(0, 1, 0));
-  planets[1].m_modelMatrix = glm::scale(planets[1].m_modelMatrix, glm::vec3(0.35f));
-  glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &planets[1].m_modelMatrix[0][0]);
-
-  modelViewMatrix = glm::mat3(m_camera.m_viewMatrix * planets[1].m_modelMatrix);
-  normalMatrix = glm::inverseTranspose(modelViewMatrix);
-  glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
-
-  planets[1].m_model.render(planets[1].m_trianglesToDraw);
-  //------
-
-  // Earth
-  planets[2].m_modelMatrix = glm::mat4(1.0);
-  planets[2].m_modelMatrix = glm::translate(planets[2].m_modelMatrix, glm::vec3(-1.25f, 0.0f, 0.0f));
-  planets[2].m_modelMatrix = glm::rotate(planets[2].m_modelMatrix, glm::radians(0.05f * numberFramers), glm::vec3(0, 1, 0));
-  planets[2].m_modelMatrix = glm::scale(planets[2].m_modelMatrix, glm::vec3(0.4f));
-  glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &planets[2].m_modelMatrix[0][0]);
-
-  modelViewMatrix = glm::mat3(m_camera.m_viewMatrix * planets[2].m_modelMatrix);
-  normalMatrix = glm::inverseTranspose(modelViewMatrix);
-  glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
-
-  planets[2].m_model.render(planets[2].m_trianglesToDraw);
-  //------
-
-  // Mars
-  planets[3].m_modelMatrix = glm::mat4(1.0);
-  planets[3].m_modelMatrix = glm::translate(planets[3].m_modelMatrix, glm::vec3(-0.75f, 0.0f, 0.0f));
-  planets[3].m_modelMatrix = glm::rotate(planets[3].m_modelMatrix, glm::radians(90.0f), glm::vec3(1, 0, 0));
-  planets[3].m_modelMatrix = glm::rotate(planets[3].m_modelMatrix, glm::radians(0.12f * numberFramers), glm::vec3(0, 0, -1));
-  planets[3].m_modelMatrix = glm::scale(planets[3].m_modelMatrix, glm::vec3(0.35f));
-  glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &planets[3].m_modelMatrix[0][0]);
-
-  modelViewMatrix = glm::mat3(m_camera.m_viewMatrix * planets[3].m_modelMatrix);
-  normalMatrix = glm::inverseTranspose(modelViewMatrix);
-  glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
-
-  planets[3].m_model.render(planets[3].m_trianglesToDraw);
-  //------
-
-  // Jupyter
-  planets[4].m_modelMatrix = glm::mat4(1.0);
-  planets[4].m_modelMatrix = glm::translate(planets[4].m_modelMatrix, glm::vec3(0.11f, 0.0f, 0.0f));
-  planets[4].m_modelMatrix = glm::rotate(planets[4].m_modelMatrix, glm::radians(90.0f), glm::vec3(1, 0, 0));
-  planets[4].m_modelMatrix = glm::rotate(planets[4].m_modelMatrix, glm::radians(0.07f * numberFramers), glm::vec3(0, 0, -1));
-  planets[4].m_modelMatrix = glm::scale(planets[4].m_modelMatrix, glm::vec3(1.0f));
-  glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &planets[4].m_modelMatrix[0][0]);
-
-  modelViewMatrix = glm::mat3(m_camera.m_viewMatrix * planets[4].m_modelMatrix);
-  normalMatrix = glm::inverseTranspose(modelViewMatrix);
-  glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
-
-  planets[4].m_model.render(planets[4].m_trianglesToDraw);
-  //------
-
-  // Saturn
-  planets[5].m_modelMatrix = glm::mat4(1.0);
-  planets[5].m_modelMatrix = glm::translate(planets[5].m_modelMatrix, glm::vec3(1.5f, 0.0f, 0.0f));
-  planets[5].m_modelMatrix = glm::rotate(planets[5].m_modelMatrix, glm::radians(0.002f * numberFramers), glm::vec3(1, 0, 0));
-  planets[5].m_modelMatrix = glm::scale(planets[5].m_modelMatrix, glm::vec3(1.1f));
-  glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &planets[5].m_modelMatrix[0][0]);
-
-  modelViewMatrix = glm::mat3(m_camera.m_viewMatrix * planets[5].m_modelMatrix);
-  normalMatrix = glm::inverseTranspose(modelViewMatrix);
-  glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
-
-  planets[5].m_model.render(planets[5].m_trianglesToDraw);
-  //------
-
-  // Uranus
-  planets[6].m_modelMatrix = glm::mat4(1.0);
-  planets[6].m_modelMatrix = glm::translate(planets[6].m_modelMatrix, glm::vec3(2.5f, 0.0f, 0.0f));
-  planets[6].m_modelMatrix = glm::rotate(planets[6].m_modelMatrix, glm::radians(180.0f), glm::vec3(0, 1, 0));
-  planets[6].m_modelMatrix = glm::rotate(planets[6].m_modelMatrix, glm::radians(0.004f * numberFramers), glm::vec3(1, 0, 0));
-  planets[6].m_modelMatrix = glm::scale(planets[6].m_modelMatrix, glm::vec3(0.7f));
-  glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &planets[6].m_modelMatrix[0][0]);
-
-  modelViewMatrix = glm::mat3(m_camera.m_viewMatrix * planets[6].m_modelMatrix);
-  normalMatrix = glm::inverseTranspose(modelViewMatrix);
-  glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
-
-  planets[6].m_model.render(planets[6].m_trianglesToDraw);
-  //------
-
-  // Neptune
-  planets[7].m_modelMatrix = glm::mat4(1.0);
-  planets[7].m_modelMatrix = glm::translate(planets[7].m_modelMatrix, glm::vec3(3.2f, 0.0f, 0.0f));
-  planets[7].m_modelMatrix = glm::rotate(planets[7].m_modelMatrix, glm::radians(0.075f * numberFramers), glm::vec3(0, 1, 0));
-  planets[7].m_modelMatrix = glm::scale(planets[7].m_modelMatrix, glm::vec3(0.45f));
-  glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &planets[7].m_modelMatrix[0][0]);
-
-  modelViewMatrix = glm::mat3(m_camera.m_viewMatrix * planets[7].m_modelMatrix);
-  normalMatrix = glm::inverseTranspose(modelViewMatrix);
-  glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
-
-  planets[7].m_model.render(planets[7].m_trianglesToDraw);
-  //------
-  
-  // Pluto
-  planets[8].m_modelMatrix = glm::mat4(1.0);
-  planets[8].m_modelMatrix = glm::translate(planets[8].m_modelMatrix, glm::vec3(3.7f, 0.0f, 0.0f));
-  planets[8].m_modelMatrix = glm::rotate(planets[8].m_modelMatrix, glm::radians(0.4f * numberFramers), glm::vec3(0, 1, 0));
-  planets[8].m_modelMatrix = glm::scale(planets[8].m_modelMatrix, glm::vec3(0.15f));
-  glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &planets[8].m_modelMatrix[0][0]);
-
-  modelViewMatrix = glm::mat3(m_camera.m_viewMatrix * planets[8].m_modelMatrix);
-  normalMatrix = glm::inverseTranspose(modelViewMatrix);
-  glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
-
-  planets[8].m_model.render(planets[8].m_trianglesToDraw);
-  //------
+  auto& state{m_frameStates.at(slot)};
+  state.viewMatrix = m_camera.m_viewMatrix;
+  // Planet rotations interpolated between the last two simulation steps
+  state.ticks = static_cast<float>(numberFramers - 1) +
+                static_cast<float>(getInterpolationAlpha());
+  state.numAsteroids = m_showAsteroids ? m_numAsteroids : 0;
+}
 
-  numberFramers++;
-  glUseProgram(0);
+void OpenGLWindow::paintGL() {
+  const auto& state{m_frameStates.at(getPaintSlot())};
+  const auto ticks{state.ticks};
+
+  abcg::glEnable(GL_CULL_FACE);
+  abcg::glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  abcg::glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+
+  // Per-frame uniforms
+  FrameData frameData{};
+  frameData.viewMatrix = state.viewMatrix;
+  frameData.projMatrix = m_camera.m_projMatrix;
+  frameData.lightDirWorldSpace = m_lightDir;
+  frameData.Ia = m_Ia;
+  frameData.Id = m_Id;
+  frameData.Is = m_Is;
+
+  for (auto&& [planet, transform] : iter::zip(planets, bodyTransforms)) {
+    auto& modelMatrix{planet.m_modelMatrix};
+    modelMatrix = glm::translate(glm::mat4(1.0f), transform.position);
+    modelMatrix = glm::rotate(modelMatrix, glm::radians(transform.tiltAngle),
+                              transform.tiltAxis);
+    modelMatrix = glm::rotate(modelMatrix,
+                              glm::radians(transform.spinSpeed * ticks),
+                              transform.spinAxis);
+    modelMatrix = glm::scale(modelMatrix, glm::vec3(transform.scale));
+  }
+
+  // Per-instance attributes of the bodies, written to the instance buffer
+  // with a single copy. Each body samples its own layer of the maps
+  m_instances.clear();
+  for (auto&& [index, planet] : iter::enumerate(planets)) {
+    auto& instance{m_instances.emplace_back()};
+    instance.modelMatrix = planet.m_modelMatrix;
+    instance.normalMatrix = glm::inverseTranspose(
+        glm::mat3(state.viewMatrix * planet.m_modelMatrix));
+    instance.layer = static_cast<float>(index);
+  }
+
+  if (state.numAsteroids > 0) {
+    const auto& sunPosition{bodyTransforms.at(9).position};
+    for (const auto& asteroid :
+         iter::slice(m_asteroids, 0, state.numAsteroids)) {
+      auto modelMatrix{glm::translate(glm::mat4(1.0f), sunPosition)};
+      modelMatrix = glm::rotate(
+          modelMatrix,
+          glm::radians(asteroid.orbitAngle + asteroid.orbitSpeed * ticks),
+          glm::vec3(0, 1, 0));
+      modelMatrix = glm::translate(
+          modelMatrix,
+          glm::vec3(asteroid.orbitRadius, asteroid.height, 0.0f));
+      modelMatrix = glm::rotate(modelMatrix,
+                                glm::radians(asteroid.spinSpeed * ticks),
+                                asteroid.spinAxis);
+      modelMatrix = glm::scale(modelMatrix, glm::vec3(asteroid.scale));
+
+      // Asteroids use the sphere and the map of Mercury
+      auto& instance{m_instances.emplace_back()};
+      instance.modelMatrix = modelMatrix;
+      instance.normalMatrix =
+          glm::inverseTranspose(glm::mat3(state.viewMatrix * modelMatrix));
+      instance.layer = 0.0f;
+    }
+  }
+
+  m_instanceBuffer.beginFrame();
+  const auto instancesOffset{
+      m_instanceBuffer.push(std::span<const Instance>{m_instances})};
+  m_instanceBuffer.flush();
+
+  m_uniformBuffer.beginFrame();
+  const auto frameDataOffset{m_uniformBuffer.push(frameData)};
+
+  // Material of the sun, drawn as a bright emissive-like sphere, and of the
+  // other bodies, which share the material of the first loaded model
+  ObjectData sunData{};
+  sunData.Ka = glm::vec4(1.0f);
+  sunData.Kd = glm::vec4(1.0f);
+  sunData.Ks = glm::vec4(1.0f);
+  sunData.shininess = 5000.0f;
+  const auto sunDataOffset{m_uniformBuffer.push(sunData)};
+
+  ObjectData bodyData{};
+  bodyData.Ka = m_Ka;
+  bodyData.Kd = m_Kd;
+  bodyData.Ks = m_Ks;
+  bodyData.shininess = m_shininess;
+  const auto bodyDataOffset{m_uniformBuffer.push(bodyData)};
+
+  // A single buffer write for the whole frame
+  m_uniformBuffer.upload();
+
+  abcg::glUseProgram(m_program);
+  m_uniformBuffer.bindRange(m_frameDataBinding, frameDataOffset,
+                            sizeof(FrameData));
+
+  // One packet per body, in any order: the queue groups them by material
+  // and mesh, so that the sun and the other bodies take one submission
+  // each. The base instance of each packet is the position of its instance
+  // in m_instances
+  m_renderQueue.beginFrame();
+  // State shared by all packets
+  abcg::RenderQueue::Packet base{};
+  base.program = m_program;
+  base.textures.at(0) = {GL_TEXTURE_2D_ARRAY, m_diffuseMaps, m_sampler};
+  base.geometry = &m_geometry;
+  base.instanceBuffer = m_instanceBuffer.getBuffer();
+  base.instanceOffset = instancesOffset;
+  const auto objectData{[this](GLintptr offset) {
+    return abcg::RenderQueue::UniformRange{
+        m_objectDataBinding, m_uniformBuffer.getBuffer(), offset,
+        sizeof(ObjectData)};
+  }};
+  constexpr std::uint32_t sunMaterial{0};
+  constexpr std::uint32_t bodyMaterial{1};
+
+  for (auto&& [index, planet] : iter::enumerate(planets)) {
+    const auto isSun{index == 9};
+    auto packet{base};
+    packet.material = isSun ? sunMaterial : bodyMaterial;
+    packet.materialBlock = objectData(isSun ? sunDataOffset : bodyDataOffset);
+    packet.depth = -(state.viewMatrix * planet.m_modelMatrix[3]).z;
+    packet.mesh = m_geometry.getRange(m_meshes.at(planet.m_mesh));
+    packet.baseInstance = static_cast<GLuint>(index);
+    m_renderQueue.submit(packet);
+  }
+
+  // All asteroids in a single packet, with the sphere and the material of
+  // the planets, at the depth of the sun they orbit
+  auto asteroids{base};
+  asteroids.material = bodyMaterial;
+  asteroids.materialBlock = objectData(bodyDataOffset);
+  asteroids.depth = -(state.viewMatrix * planets[9].m_modelMatrix[3]).z;
+  asteroids.mesh = m_geometry.getRange(m_meshes.at(planets[0].m_mesh));
+  asteroids.instanceCount = static_cast<GLuint>(state.numAsteroids);
+  asteroids.baseInstance = static_cast<GLuint>(std::size(planets));
+  m_renderQueue.submit(asteroids);
+
+  {
+    abcg::GPUScope scope{getGPUProfiler(), "Bodies"};
+    m_renderQueue.execute();
+  }
 }
 
 void OpenGLWindow::paintUI() {
@@ -291,11 +398,6 @@ void OpenGLWindow::paintUI() {
 
     }
     */
-
-    {
-      auto aspect{static_cast<float>(m_viewportWidth) / static_cast<float>(m_viewportHeight)};
-      m_projMatrix = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 5.0f);
-    }
 }
 
 void OpenGLWindow::resizeGL(int width, int height) {
@@ -305,7 +407,13 @@ void OpenGLWindow::resizeGL(int width, int height) {
 }
 
 void OpenGLWindow::terminateGL() {
-  glDeleteProgram(m_program);
+  // m_program is owned by the window (see getProgramVariant)
+  m_uniformBuffer.destroy();
+  m_instanceBuffer.destroy();
+  m_renderQueue.destroy();
+  abcg::glDeleteTextures(1, &m_diffuseMaps);
+  m_geometry.destroy();
+  m_meshes.clear();
 }
 
 void OpenGLWindow::update() {
@@ -1,7 +1,9 @@
 #ifndef OPENGLWINDOW_HPP_
 #define OPENGLWINDOW_HPP_
 
+#include <array>
 #include <string_view>
+#include <vector>
 
 #include "abcg.hpp"
 #include "model.hpp"
@@ -12,16 +14,42 @@ class OpenGLWindow : public abcg::OpenGLWindow {
  protected:
   void handleEvent(SDL_Event& ev) override;
   void initializeGL() override;
+  void fixedUpdate(double timeStep) override;
+  void publishFrame(int slot) override;
   void paintGL() override;
   void paintUI() override;
   void resizeGL(int width, int height) override;
   void terminateGL() override;
 
  private:
+  // Per-frame uniform block (FrameData in texture.vert/texture.frag)
+  struct FrameData {
+    glm::mat4 viewMatrix{1.0f};
+    glm::mat4 projMatrix{1.0f};
+    glm::vec4 lightDirWorldSpace{};
+    glm::vec4 Ia{};
+    glm::vec4 Id{};
+    glm::vec4 Is{};
+  };
+
+  // Per-object uniform block (ObjectData in texture.vert/texture.frag)
+  struct ObjectData {
+    glm::mat4 modelMatrix{1.0f};
+    abcg::std140::Mat3 normalMatrix{};
+    glm::vec4 Ka{};
+    glm::vec4 Kd{};
+    glm::vec4 Ks{};
+    float shininess{};
+  };
+
+  // Uniform block binding points
+  constexpr static GLuint m_frameDataBinding{0};
+  constexpr static GLuint m_objectDataBinding{1};
+
   struct Planet
   {
-    Model m_model;
-    int m_trianglesToDraw{};
+    // Index of the mesh in m_meshes
+    std::size_t m_mesh{};
     glm::mat4 m_modelMatrix{1.0f};
   };
 
@@ -37,19 +65,46 @@ class OpenGLWindow : public abcg::OpenGLWindow {
 
   glm::vec4 m_lightDir{0.5f, 0.0f, 0.0f, 0.0f};
 
+  // Stress mode: asteroid belt around the sun, drawn with a single
+  // instanced draw (toggled with B, size changed with + and -)
+  struct Asteroid {
+    float orbitRadius{};
+    float orbitAngle{};
+    float orbitSpeed{};
+    float height{};
+    glm::vec3 spinAxis{0.0f, 1.0f, 0.0f};
+    float spinSpeed{};
+    float scale{};
+  };
+  constexpr static int m_maxAsteroids{32768};
+  std::vector<Asteroid> m_asteroids;
+  // Instances of the bodies in the order of filenames, followed by those of
+  // the asteroids
+  std::vector<Instance> m_instances;
+  bool m_showAsteroids{false};
+  int m_numAsteroids{4096};
+
   Planet planets[10];
+  // Venus, Neptune and the Sun use the sphere of Mercury (their .obj files
+  // differ from it only in scale), so that the four share one mesh
   std::string filenames[10][2] = {
     "mercury.obj", "mercury_map.jpg",
-    "venus.obj", "venus_map.jpg",
+    "mercury.obj", "venus_map.jpg",
     "earth.obj", "earth_map.png",
     "mars.obj", "mars_map.jpg",
     "jupyter.obj", "jupyter_map.jpg",
     "saturn.obj", "saturn_map.jpg",
     "uranus.obj", "uranus_map.jpg",
-    "neptune.obj", "neptune_map.jpg",
+    "mercury.obj", "neptune_map.jpg",
     "pluto.obj", "pluto_map.jpg",
-    "sun.obj", "sun_map.jpg"
+    "mercury.obj", "sun_map.jpg"
   };
+  // Distinct meshes of the bodies, each in a slice of m_geometry
+  abcg::GeometryBuffer m_geometry;
+  std::vector<abcg::GeometryBuffer::MeshID> m_meshes;
+  // Maps of all bodies, one layer per body in the order of filenames
+  GLuint m_diffuseMaps{};
+  GLuint m_sampler{};
 
   glm::mat4 m_viewMatrix{1.0f};
   glm::mat4 m_projMatrix{1.0f};
@@ -66,9 +121,27 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   GLuint m_program;
   int m_currentProgramIndex{};
 
+  // Ring-buffered UBO holding FrameData and all ObjectData blocks
+  abcg::UniformBuffer m_uniformBuffer;
+  // Per-instance attributes of all bodies, written every frame
+  abcg::StreamingBuffer m_instanceBuffer;
+  // Draws of the frame, sorted by material and mesh
+  abcg::RenderQueue m_renderQueue;
+
+  // Number of simulation steps (fixedUpdate runs at 60 Hz)
   unsigned long long int numberFramers{1};
 
+  // State read by paintGL, one per slot so that the main thread can update
+  // the camera while the render thread paints (see publishFrame)
+  struct FrameState {
+    glm::mat4 viewMatrix{1.0f};
+    float ticks{};
+    int numAsteroids{};
+  };
+  std::array<FrameState, 2> m_frameStates;
+
   void loadModel();
+  void createAsteroids();
   void update();
 };
 
@@ -0,0 +1,853 @@
+/**
+ * @file main.cpp
+ * @brief Replays an OpenGL trace recorded with ABCG_GL_CAPTURE.
+ *
+ * Usage: glreplay <trace> [--repeat N] [--finish]
+ *
+ * The setup section of the trace is executed once. Then all frames are
+ * executed N times into an offscreen framebuffer, and the CPU time of each
+ * frame is reported. With --finish, each frame waits for the GPU (glFinish)
+ * before the timer stops. Objects created by the frames and not deleted by
+ * them accumulate across repetitions.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <map>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "abcg.hpp"
+#include "abcg_glcapture.hpp"
+
+namespace {
+using abcg::opengl::GLFunction;
+using abcg::opengl::TraceReader;
+
+// Maps object names recorded in the trace to names created by the replay
+class NameMap {
+ public:
+  [[nodiscard]] GLuint get(GLuint recorded) const {
+    if (auto it{m_names.find(recorded)}; it != m_names.end()) {
+      return it->second;
+    }
+    return recorded;
+  }
+  void set(GLuint recorded, GLuint replayed) { m_names[recorded] = replayed; }
+  void erase(GLuint recorded) { m_names.erase(recorded); }
+
+ private:
+  std::unordered_map<GLuint, GLuint> m_names;
+};
+
+std::vector<GLuint> readNames(TraceReader &reader) {
+  const auto payload{reader.readPayload()};
+  std::vector<GLuint> names(payload.size() / sizeof(GLuint));
+  std::memcpy(names.data(), payload.data(), names.size() * sizeof(GLuint));
+  return names;
+}
+
+const void *toPointer(std::uint64_t value) {
+  return reinterpret_cast<const void *>(static_cast<std::uintptr_t>(value));
+}
+
+class Replayer {
+ public:
+  Replayer(TraceReader &reader, GLuint framebuffer) : m_reader{reader} {
+    // The default framebuffer of the recording is the offscreen framebuffer
+    m_framebuffers.set(0, framebuffer);
+  }
+
+  // Executes the records of one section. Returns false at the end of the trace
+  bool replaySection();
+
+ private:
+  TraceReader &m_reader;
+
+  NameMap m_buffers;
+  NameMap m_framebuffers;
+  NameMap m_programs;
+  NameMap m_renderbuffers;
+  NameMap m_samplers;
+  NameMap m_shaders;
+  NameMap m_textures;
+  NameMap m_vertexArrays;
+  // Locations and indices are per program, except attribute locations, which
+  // are used without a program
+  std::map<std::pair<GLuint, GLint>, GLint> m_uniformLocations;
+  std::map<std::pair<GLuint, GLuint>, GLuint> m_uniformBlockIndices;
+  std::unordered_map<GLint, GLint> m_attribLocations;
+  GLuint m_currentProgram{};
+
+  [[nodiscard]] GLint uniformLocation(GLint recorded) const;
+  [[nodiscard]] GLuint attribLocation(GLuint recorded) const;
+  void replayCall(GLFunction function);
+  void genNames(NameMap &map, void(GLAPIENTRY *gen)(GLsizei, GLuint *));
+  void deleteNames(NameMap &map,
+                   void(GLAPIENTRY *del)(GLsizei, const GLuint *));
+};
+
+bool Replayer::replaySection() {
+  while (!m_reader.atEnd()) {
+    const auto record{m_reader.readRecord()};
+    if (record == abcg::opengl::traceSetupEnd ||
+        record == abcg::opengl::traceFrameEnd) {
+      return true;
+    }
+    if (record >= abcg::opengl::numGLFunctions) {
+      throw abcg::Exception{abcg::Exception::Runtime(
+          fmt::format("Invalid record {} in trace", record))};
+    }
+    replayCall(static_cast<GLFunction>(record));
+  }
+  return false;
+}
+
+GLint Replayer::uniformLocation(GLint recorded) const {
+  if (auto it{m_uniformLocations.find({m_currentProgram, recorded})};
+      it != m_uniformLocations.end()) {
+    return it->second;
+  }
+  return recorded;
+}
+
+GLuint Replayer::attribLocation(GLuint recorded) const {
+  if (auto it{m_attribLocations.find(static_cast<GLint>(recorded))};
+      it != m_attribLocations.end()) {
+    return static_cast<GLuint>(it->second);
+  }
+  return recorded;
+}
+
+void Replayer::genNames(NameMap &map,
+                        void(GLAPIENTRY *gen)(GLsizei, GLuint *)) {
+  [[maybe_unused]] const auto n{m_reader.read<GLsizei>()};
+  [[maybe_unused]] const auto pointer{m_reader.read<std::uint64_t>()};
+  const auto recorded{readNames(m_reader)};
+  std::vector<GLuint> replayed(recorded.size());
+  gen(static_cast<GLsizei>(replayed.size()), replayed.data());
+  for (std::size_t index{}; index < recorded.size(); ++index) {
+    map.set(recorded.at(index), replayed.at(index));
+  }
+}
+
+void Replayer::deleteNames(NameMap &map,
+                           void(GLAPIENTRY *del)(GLsizei, const GLuint *)) {
+  [[maybe_unused]] const auto n{m_reader.read<GLsizei>()};
+  [[maybe_unused]] const auto pointer{m_reader.read<std::uint64_t>()};
+  auto names{readNames(m_reader)};
+  for (auto &name : names) {
+    const auto recorded{name};
+    name = map.get(recorded);
+    map.erase(recorded);
+  }
+  del(static_cast<GLsizei>(names.size()), names.data());
+}
+
+// Arguments are read into variables, in the order they were written, since
+// the evaluation order of function arguments is unspecified
+void Replayer::replayCall(GLFunction function) {
+  auto &r{m_reader};
+  switch (function) {
+    case GLFunction::ActiveTexture:
+      glActiveTexture(r.read<GLenum>());
+      break;
+    case GLFunction::AttachShader: {
+      const auto program{m_programs.get(r.read<GLuint>())};
+      const auto shader{m_shaders.get(r.read<GLuint>())};
+      glAttachShader(program, shader);
+      break;
+    }
+    case GLFunction::BindBuffer: {
+      const auto target{r.read<GLenum>()};
+      const auto buffer{m_buffers.get(r.read<GLuint>())};
+      glBindBuffer(target, buffer);
+      break;
+    }
+    case GLFunction::BindBufferBase: {
+      const auto target{r.read<GLenum>()};
+      const auto index{r.read<GLuint>()};
+      const auto buffer{m_buffers.get(r.read<GLuint>())};
+      glBindBufferBase(target, index, buffer);
+      break;
+    }
+    case GLFunction::BindBufferRange: {
+      const auto target{r.read<GLenum>()};
+      const auto index{r.read<GLuint>()};
+      const auto buffer{m_buffers.get(r.read<GLuint>())};
+      const auto offset{r.read<GLintptr>()};
+      const auto size{r.read<GLsizeiptr>()};
+      glBindBufferRange(target, index, buffer, offset, size);
+      break;
+    }
+#if !defined(__EMSCRIPTEN__)
+    case GLFunction::BindFragDataLocation: {
+      const auto program{m_programs.get(r.read<GLuint>())};
+      const auto colorNumber{r.read<GLuint>()};
+      [[maybe_unused]] const auto pointer{r.read<std::uint64_t>()};
+      const std::string name{r.readString()};
+      glBindFragDataLocation(program, colorNumber, name.c_str());
+      break;
+    }
+#endif
+    case GLFunction::BindFramebuffer: {
+      const auto target{r.read<GLenum>()};
+      const auto framebuffer{m_framebuffers.get(r.read<GLuint>())};
+      glBindFramebuffer(target, framebuffer);
+      break;
+    }
+    case GLFunction::BindRenderbuffer: {
+      const auto target{r.read<GLenum>()};
+      const auto renderbuffer{m_renderbuffers.get(r.read<GLuint>())};
+      glBindRenderbuffer(target, renderbuffer);
+      break;
+    }
+    case GLFunction::BindSampler: {
+      const auto unit{r.read<GLuint>()};
+      const auto sampler{m_samplers.get(r.read<GLuint>())};
+      glBindSampler(unit, sampler);
+      break;
+    }
+    case GLFunction::BindTexture: {
+      const auto target{r.read<GLenum>()};
+      const auto texture{m_textures.get(r.read<GLuint>())};
+      glBindTexture(target, texture);
+      break;
+    }
+    case GLFunction::BindVertexArray:
+      glBindVertexArray(m_vertexArrays.get(r.read<GLuint>()));
+      break;
+    case GLFunction::BlitFramebuffer: {
+      std::array<GLint, 8> coordinates{};
+      for (auto &coordinate : coordinates) coordinate = r.read<GLint>();
+      const auto mask{r.read<GLbitfield>()};
+      const auto filter{r.read<GLenum>()};
+      glBlitFramebuffer(coordinates[0], coordinates[1], coordinates[2],
+                        coordinates[3], coordinates[4], coordinates[5],
+                        coordinates[6], coordinates[7], mask, filter);
+      break;
+    }
+    case GLFunction::BufferData: {
+      const auto target{r.read<GLenum>()};
+      const auto size{r.read<GLsizeiptr>()};
+      [[maybe_unused]] const auto pointer{r.read<std::uint64_t>()};
+      const auto usage{r.read<GLenum>()};
+      const auto data{r.readPayload()};
+      glBufferData(target, size, data.empty() ? nullptr : data.data(), usage);
+      break;
+    }
+    case GLFunction::BufferSubData: {
+      const auto target{r.read<GLenum>()};
+      const auto offset{r.read<GLintptr>()};
+      const auto size{r.read<GLsizeiptr>()};
+      [[maybe_unused]] const auto pointer{r.read<std::uint64_t>()};
+      const auto data{r.readPayload()};
+      glBufferSubData(target, offset, size, data.data());
+      break;
+    }
+    case GLFunction::CheckFramebufferStatus: {
+      // Queries have no side effects
+      [[maybe_unused]] const auto target{r.read<GLenum>()};
+      break;
+    }
+    case GLFunction::Clear:
+      glClear(r.read<GLbitfield>());
+      break;
+    case GLFunction::ClearColor: {
+      const auto red{r.read<GLclampf>()};
+      const auto green{r.read<GLclampf>()};
+      const auto blue{r.read<GLclampf>()};
+      const auto alpha{r.read<GLclampf>()};
+      glClearColor(red, green, blue, alpha);
+      break;
+    }
+    case GLFunction::CompileShader:
+      glCompileShader(m_shaders.get(r.read<GLuint>()));
+      break;
+    case GLFunction::CopyBufferSubData: {
+      const auto readTarget{r.read<GLenum>()};
+      const auto writeTarget{r.read<GLenum>()};
+      const auto readOffset{r.read<GLintptr>()};
+      const auto writeOffset{r.read<GLintptr>()};
+      const auto size{r.read<GLsizeiptr>()};
+      glCopyBufferSubData(readTarget, writeTarget, readOffset, writeOffset,
+                          size);
+      break;
+    }
+    case GLFunction::CreateProgram:
+      m_programs.set(r.read<GLuint>(), glCreateProgram());
+      break;
+    case GLFunction::CreateShader: {
+      const auto shaderType{r.read<GLenum>()};
+      m_shaders.set(r.read<GLuint>(), glCreateShader(shaderType));
+      break;
+    }
+    case GLFunction::DeleteBuffers:
+      deleteNames(m_buffers, glDeleteBuffers);
+      break;
+    case GLFunction::DeleteFramebuffers:
+      deleteNames(m_framebuffers, glDeleteFramebuffers);
+      break;
+    case GLFunction::DeleteProgram: {
+      const auto program{r.read<GLuint>()};
+      glDeleteProgram(m_programs.get(program));
+      m_programs.erase(program);
+      break;
+    }
+    case GLFunction::DeleteRenderbuffers:
+      deleteNames(m_renderbuffers, glDeleteRenderbuffers);
+      break;
+    case GLFunction::DeleteSamplers:
+      deleteNames(m_samplers, glDeleteSamplers);
+      break;
+    case GLFunction::DeleteShader: {
+      const auto shader{r.read<GLuint>()};
+      glDeleteShader(m_shaders.get(shader));
+      m_shaders.erase(shader);
+      break;
+    }
+    case GLFunction::DeleteTextures:
+      deleteNames(m_textures, glDeleteTextures);
+      break;
+    case GLFunction::DeleteVertexArrays:
+      deleteNames(m_vertexArrays, glDeleteVertexArrays);
+      break;
+    case GLFunction::Disable:
+      glDisable(r.read<GLenum>());
+      break;
+    case GLFunction::DrawArrays: {
+      const auto mode{r.read<GLenum>()};
+      const auto first{r.read<GLint>()};
+      const auto count{r.read<GLsizei>()};
+      glDrawArrays(mode, first, count);
+      break;
+    }
+    case GLFunction::DrawBuffers: {
+      [[maybe_unused]] const auto n{r.read<GLsizei>()};
+      [[maybe_unused]] const auto pointer{r.read<std::uint64_t>()};
+      const auto payload{r.readPayload()};
+      std::vector<GLenum> buffers(payload.size() / sizeof(GLenum));
+      std::memcpy(buffers.data(), payload.data(),
+                  buffers.size() * sizeof(GLenum));
+      glDrawBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+      break;
+    }
+    case GLFunction::DrawElements: {
+      const auto mode{r.read<GLenum>()};
+      const auto count{r.read<GLsizei>()};
+      const auto type{r.read<GLenum>()};
+      // Offset into the bound element array buffer
+      const auto indices{toPointer(r.read<std::uint64_t>())};
+      glDrawElements(mode, count, type, indices);
+      break;
+    }
+    case GLFunction::DrawElementsInstanced: {
+      const auto mode{r.read<GLenum>()};
+      const auto count{r.read<GLsizei>()};
+      const auto type{r.read<GLenum>()};
+      const auto indices{toPointer(r.read<std::uint64_t>())};
+      const auto instanceCount{r.read<GLsizei>()};
+      glDrawElementsInstanced(mode, count, type, indices, instanceCount);
+      break;
+    }
+    case GLFunction::DrawElementsInstancedBaseVertex: {
+      const auto mode{r.read<GLenum>()};
+      const auto count{r.read<GLsizei>()};
+      const auto type{r.read<GLenum>()};
+      const auto indices{toPointer(r.read<std::uint64_t>())};
+      const auto instanceCount{r.read<GLsizei>()};
+      const auto baseVertex{r.read<GLint>()};
+      glDrawElementsInstancedBaseVertex(mode, count, type, indices,
+                                        instanceCount, baseVertex);
+      break;
+    }
+    case GLFunction::Enable:
+      glEnable(r.read<GLenum>());
+      break;
+    case GLFunction::EnableVertexAttribArray:
+      glEnableVertexAttribArray(attribLocation(r.read<GLuint>()));
+      break;
+    case GLFunction::FramebufferRenderbuffer: {
+      const auto target{r.read<GLenum>()};
+      const auto attachment{r.read<GLenum>()};
+      const auto renderbuffertarget{r.read<GLenum>()};
+      const auto renderbuffer{m_renderbuffers.get(r.read<GLuint>())};
+      glFramebufferRenderbuffer(target, attachment, renderbuffertarget,
+                                renderbuffer);
+      break;
+    }
+#if !defined(__EMSCRIPTEN__)
+    case GLFunction::FramebufferTexture: {
+      const auto target{r.read<GLenum>()};
+      const auto attachment{r.read<GLenum>()};
+      const auto texture{m_textures.get(r.read<GLuint>())};
+      const auto level{r.read<GLint>()};
+      glFramebufferTexture(target, attachment, texture, level);
+      break;
+    }
+#endif
+    case GLFunction::GenBuffers:
+      genNames(m_buffers, glGenBuffers);
+      break;
+    case GLFunction::GenFramebuffers:
+      genNames(m_framebuffers, glGenFramebuffers);
+      break;
+    case GLFunction::GenRenderbuffers:
+      genNames(m_renderbuffers, glGenRenderbuffers);
+      break;
+    case GLFunction::GenSamplers:
+      genNames(m_samplers, glGenSamplers);
+      break;
+    case GLFunction::GenTextures:
+      genNames(m_textures, glGenTextures);
+      break;
+    case GLFunction::GenVertexArrays:
+      genNames(m_vertexArrays, glGenVertexArrays);
+      break;
+    case GLFunction::GenerateMipmap:
+      glGenerateMipmap(r.read<GLenum>());
+      break;
+    case GLFunction::GetActiveUniformBlockiv: {
+      [[maybe_unused]] const auto program{r.read<GLuint>()};
+      [[maybe_unused]] const auto index{r.read<GLuint>()};
+      [[maybe_unused]] const auto pname{r.read<GLenum>()};
+      [[maybe_unused]] const auto params{r.read<std::uint64_t>()};
+      break;
+    }
+    case GLFunction::GetAttribLocation: {
+      const auto program{m_programs.get(r.read<GLuint>())};
+      [[maybe_unused]] const auto pointer{r.read<std::uint64_t>()};
+      const std::string name{r.readString()};
+      const auto recorded{r.read<GLint>()};
+      m_attribLocations[recorded] = glGetAttribLocation(program, name.c_str());
+      break;
+    }
+    case GLFunction::GetBooleanv:
+#if !defined(__EMSCRIPTEN__)
+    case GLFunction::GetDoublev:
+#endif
+    case GLFunction::GetFloatv:
+    case GLFunction::GetIntegerv: {
+      [[maybe_unused]] const auto pname{r.read<GLenum>()};
+      [[maybe_unused]] const auto params{r.read<std::uint64_t>()};
+      break;
+    }
+    case GLFunction::GetProgramiv:
+    case GLFunction::GetShaderiv: {
+      [[maybe_unused]] const auto object{r.read<GLuint>()};
+      [[maybe_unused]] const auto pname{r.read<GLenum>()};
+      [[maybe_unused]] const auto params{r.read<std::uint64_t>()};
+      break;
+    }
+    case GLFunction::GetString: {
+      [[maybe_unused]] const auto name{r.read<GLenum>()};
+      break;
+    }
+    case GLFunction::GetUniformBlockIndex: {
+      const auto recordedProgram{r.read<GLuint>()};
+      [[maybe_unused]] const auto pointer{r.read<std::uint64_t>()};
+      const std::string name{r.readString()};
+      const auto recorded{r.read<GLuint>()};
+      m_uniformBlockIndices[{recordedProgram, recorded}] =
+          glGetUniformBlockIndex(m_programs.get(recordedProgram),
+                                 name.c_str());
+      break;
+    }
+    case GLFunction::GetUniformLocation: {
+      const auto recordedProgram{r.read<GLuint>()};
+      [[maybe_unused]] const auto pointer{r.read<std::uint64_t>()};
+      const std::string name{r.readString()};
+      const auto recorded{r.read<GLint>()};
+      m_uniformLocations[{recordedProgram, recorded}] = glGetUniformLocation(
+          m_programs.get(recordedProgram), name.c_str());
+      break;
+    }
+    case GLFunction::LinkProgram:
+      glLinkProgram(m_programs.get(r.read<GLuint>()));
+      break;
+    case GLFunction::MultiDrawElementsIndirect: {
+      const auto mode{r.read<GLenum>()};
+      const auto type{r.read<GLenum>()};
+      // Offset into the bound draw indirect buffer
+      const auto indirect{toPointer(r.read<std::uint64_t>())};
+      const auto drawCount{r.read<GLsizei>()};
+      const auto stride{r.read<GLsizei>()};
+      glMultiDrawElementsIndirect(mode, type, indirect, drawCount, stride);
+      break;
+    }
+    case GLFunction::RenderbufferStorage: {
+      const auto target{r.read<GLenum>()};
+      const auto internalformat{r.read<GLenum>()};
+      const auto width{r.read<GLsizei>()};
+      const auto height{r.read<GLsizei>()};
+      glRenderbufferStorage(target, internalformat, width, height);
+      break;
+    }
+    case GLFunction::ShaderSource: {
+      const auto shader{m_shaders.get(r.read<GLuint>())};
+      const auto count{r.read<GLsizei>()};
+      [[maybe_unused]] const auto strings{r.read<std::uint64_t>()};
+      [[maybe_unused]] const auto lengths{r.read<std::uint64_t>()};
+      std::vector<const GLchar *> sources;
+      std::vector<GLint> sizes;
+      for (GLsizei index{}; index < count; ++index) {
+        const auto source{r.readString()};
+        sources.push_back(source.data());
+        sizes.push_back(static_cast<GLint>(source.size()));
+      }
+      glShaderSource(shader, count, sources.data(), sizes.data());
+      break;
+    }
+    case GLFunction::TexImage2D: {
+      const auto target{r.read<GLenum>()};
+      const auto level{r.read<GLint>()};
+      const auto internalformat{r.read<GLint>()};
+      const auto width{r.read<GLsizei>()};
+      const auto height{r.read<GLsizei>()};
+      const auto border{r.read<GLint>()};
+      const auto format{r.read<GLenum>()};
+      const auto type{r.read<GLenum>()};
+      [[maybe_unused]] const auto pointer{r.read<std::uint64_t>()};
+      const auto data{r.readPayload()};
+      glTexImage2D(target, level, internalformat, width, height, border,
+                   format, type, data.empty() ? nullptr : data.data());
+      break;
+    }
+#if !defined(__EMSCRIPTEN__)
+    case GLFunction::TexImage2DMultisample: {
+      const auto target{r.read<GLenum>()};
+      const auto samples{r.read<GLsizei>()};
+      const auto internalformat{r.read<GLenum>()};
+      const auto width{r.read<GLsizei>()};
+      const auto height{r.read<GLsizei>()};
+      const auto fixedsamplelocations{r.read<GLboolean>()};
+      glTexImage2DMultisample(target, samples, internalformat, width, height,
+                              fixedsamplelocations);
+      break;
+    }
+#endif
+    case GLFunction::SamplerParameterf: {
+      const auto sampler{m_samplers.get(r.read<GLuint>())};
+      const auto pname{r.read<GLenum>()};
+      const auto param{r.read<GLfloat>()};
+      glSamplerParameterf(sampler, pname, param);
+      break;
+    }
+    case GLFunction::SamplerParameteri: {
+      const auto sampler{m_samplers.get(r.read<GLuint>())};
+      const auto pname{r.read<GLenum>()};
+      const auto param{r.read<GLint>()};
+      glSamplerParameteri(sampler, pname, param);
+      break;
+    }
+    case GLFunction::TexImage3D: {
+      const auto target{r.read<GLenum>()};
+      const auto level{r.read<GLint>()};
+      const auto internalformat{r.read<GLint>()};
+      const auto width{r.read<GLsizei>()};
+      const auto height{r.read<GLsizei>()};
+      const auto depth{r.read<GLsizei>()};
+      const auto border{r.read<GLint>()};
+      const auto format{r.read<GLenum>()};
+      const auto type{r.read<GLenum>()};
+      [[maybe_unused]] const auto pointer{r.read<std::uint64_t>()};
+      const auto data{r.readPayload()};
+      glTexImage3D(target, level, internalformat, width, height, depth, border,
+                   format, type, data.empty() ? nullptr : data.data());
+      break;
+    }
+    case GLFunction::TexParameteri: {
+      const auto target{r.read<GLenum>()};
+      const auto pname{r.read<GLenum>()};
+      const auto param{r.read<GLint>()};
+      glTexParameteri(target, pname, param);
+      break;
+    }
+    case GLFunction::TexSubImage3D: {
+      const auto target{r.read<GLenum>()};
+      const auto level{r.read<GLint>()};
+      const auto xoffset{r.read<GLint>()};
+      const auto yoffset{r.read<GLint>()};
+      const auto zoffset{r.read<GLint>()};
+      const auto width{r.read<GLsizei>()};
+      const auto height{r.read<GLsizei>()};
+      const auto depth{r.read<GLsizei>()};
+      const auto format{r.read<GLenum>()};
+      const auto type{r.read<GLenum>()};
+      [[maybe_unused]] const auto pointer{r.read<std::uint64_t>()};
+      const auto pixels{r.readPayload()};
+      glTexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height,
+                      depth, format, type, pixels.data());
+      break;
+    }
+    case GLFunction::Uniform1f: {
+      const auto location{uniformLocation(r.read<GLint>())};
+      glUniform1f(location, r.read<GLfloat>());
+      break;
+    }
+    case GLFunction::Uniform1i: {
+      const auto location{uniformLocation(r.read<GLint>())};
+      glUniform1i(location, r.read<GLint>());
+      break;
+    }
+    case GLFunction::Uniform3fv:
+    case GLFunction::Uniform4fv: {
+      const auto location{uniformLocation(r.read<GLint>())};
+      const auto count{r.read<GLsizei>()};
+      [[maybe_unused]] const auto pointer{r.read<std::uint64_t>()};
+      const auto *value{
+          reinterpret_cast<const GLfloat *>(r.readPayload().data())};
+      if (function == GLFunction::Uniform3fv) {
+        glUniform3fv(location, count, value);
+      } else {
+        glUniform4fv(location, count, value);
+      }
+      break;
+    }
+    case GLFunction::UniformBlockBinding: {
+      const auto recordedProgram{r.read<GLuint>()};
+      const auto recordedIndex{r.read<GLuint>()};
+      const auto binding{r.read<GLuint>()};
+      auto index{recordedIndex};
+      if (auto it{m_uniformBlockIndices.find({recordedProgram, recordedIndex})};
+          it != m_uniformBlockIndices.end()) {
+        index = it->second;
+      }
+      glUniformBlockBinding(m_programs.get(recordedProgram), index, binding);
+      break;
+    }
+    case GLFunction::UniformMatrix3fv:
+    case GLFunction::UniformMatrix4fv: {
+      const auto location{uniformLocation(r.read<GLint>())};
+      const auto count{r.read<GLsizei>()};
+      const auto transpose{r.read<GLboolean>()};
+      [[maybe_unused]] const auto pointer{r.read<std::uint64_t>()};
+      const auto *value{
+          reinterpret_cast<const GLfloat *>(r.readPayload().data())};
+      if (function == GLFunction::UniformMatrix3fv) {
+        glUniformMatrix3fv(location, count, transpose, value);
+      } else {
+        glUniformMatrix4fv(location, count, transpose, value);
+      }
+      break;
+    }
+    case GLFunction::UseProgram:
+      m_currentProgram = r.read<GLuint>();
+      glUseProgram(m_programs.get(m_currentProgram));
+      break;
+    case GLFunction::VertexAttribDivisor: {
+      const auto index{attribLocation(r.read<GLuint>())};
+      glVertexAttribDivisor(index, r.read<GLuint>());
+      break;
+    }
+    case GLFunction::VertexAttribPointer: {
+      const auto index{attribLocation(r.read<GLuint>())};
+      const auto size{r.read<GLint>()};
+      const auto type{r.read<GLenum>()};
+      const auto normalized{r.read<GLboolean>()};
+      const auto stride{r.read<GLsizei>()};
+      // Offset into the bound array buffer
+      const auto pointer{toPointer(r.read<std::uint64_t>())};
+      glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+      break;
+    }
+    case GLFunction::Viewport: {
+      const auto x{r.read<GLint>()};
+      const auto y{r.read<GLint>()};
+      const auto width{r.read<GLsizei>()};
+      const auto height{r.read<GLsizei>()};
+      glViewport(x, y, width, height);
+      break;
+    }
+    case GLFunction::Count:
+      break;
+  }
+}
+
+// Offscreen color and depth/stencil targets with the size of the recording
+class OffscreenTarget {
+ public:
+  void create(GLsizei width, GLsizei height) {
+    glGenRenderbuffers(static_cast<GLsizei>(m_renderbuffers.size()),
+                       m_renderbuffers.data());
+    glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, m_renderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                              GL_RENDERBUFFER, m_renderbuffers[1]);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      throw abcg::Exception{
+          abcg::Exception::Runtime("Failed to create offscreen framebuffer")};
+    }
+  }
+
+  void destroy() {
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteRenderbuffers(static_cast<GLsizei>(m_renderbuffers.size()),
+                          m_renderbuffers.data());
+  }
+
+  [[nodiscard]] GLuint getFramebuffer() const noexcept {
+    return m_framebuffer;
+  }
+
+ private:
+  GLuint m_framebuffer{};
+  std::array<GLuint, 2> m_renderbuffers{};
+};
+
+SDL_Window *createContextWindow(const abcg::opengl::TraceHeader &header,
+                                SDL_GLContext &context) {
+  auto majorVersion{header.majorVersion};
+  auto minorVersion{header.minorVersion};
+  switch (static_cast<abcg::OpenGLProfile>(header.profile)) {
+    case abcg::OpenGLProfile::Core:
+      SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS,
+                          SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG);
+      SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
+                          SDL_GL_CONTEXT_PROFILE_CORE);
+      break;
+    case abcg::OpenGLProfile::Compatibility:
+      SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
+                          SDL_GL_CONTEXT_PROFILE_COMPATIBILITY);
+      break;
+    case abcg::OpenGLProfile::ES:
+      majorVersion = 3;
+      minorVersion = 0;
+      SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
+                          SDL_GL_CONTEXT_PROFILE_ES);
+      break;
+  }
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, majorVersion);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, minorVersion);
+
+  auto *window{SDL_CreateWindow("glreplay", SDL_WINDOWPOS_CENTERED,
+                                SDL_WINDOWPOS_CENTERED, header.width,
+                                header.height,
+                                SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN)};
+  if (window == nullptr) {
+    throw abcg::Exception{abcg::Exception::SDL("SDL_CreateWindow failed")};
+  }
+  context = SDL_GL_CreateContext(window);
+  if (context == nullptr) {
+    throw abcg::Exception{abcg::Exception::SDL("SDL_GL_CreateContext failed")};
+  }
+  SDL_GL_SetSwapInterval(0);
+  if (GLenum err{glewInit()}; GLEW_OK != err) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to initialize OpenGL loader: {}",
+                    reinterpret_cast<const char *>(glewGetErrorString(err))))};
+  }
+  return window;
+}
+
+void printReport(std::vector<double> frameTimes) {
+  if (frameTimes.empty()) {
+    fmt::print("No frames replayed\n");
+    return;
+  }
+  const auto total{std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0)};
+  std::sort(frameTimes.begin(), frameTimes.end());
+  const auto percentile{[&](double p) {
+    const auto index{static_cast<std::size_t>(
+        p * static_cast<double>(frameTimes.size() - 1) + 0.5)};
+    return frameTimes.at(index);
+  }};
+  fmt::print("Frames.........: {}\n", frameTimes.size());
+  fmt::print("CPU time (ms)..: avg {:.3f} min {:.3f} median {:.3f} "
+             "p95 {:.3f} max {:.3f}\n",
+             total / static_cast<double>(frameTimes.size()), frameTimes.front(),
+             percentile(0.5), percentile(0.95), frameTimes.back());
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  const std::vector<std::string_view> args(argv, argv + argc);
+  if (args.size() < 2) {
+    fmt::print(stderr, "Usage: {} <trace> [--repeat N] [--finish]\n",
+               args.at(0));
+    return -1;
+  }
+
+  int repeat{1};
+  bool finish{false};
+  for (std::size_t index{2}; index < args.size(); ++index) {
+    if (args.at(index) == "--repeat" && index + 1 < args.size()) {
+      repeat = std::max(1, std::stoi(std::string{args.at(++index)}));
+    } else if (args.at(index) == "--finish") {
+      finish = true;
+    }
+  }
+
+  SDL_Window *window{};
+  SDL_GLContext context{};
+  try {
+    TraceReader reader;
+    reader.open(std::string{args.at(1)});
+    const auto &header{reader.getHeader()};
+
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+      throw abcg::Exception{abcg::Exception::SDL("SDL_Init failed")};
+    }
+    window = createContextWindow(header, context);
+    fmt::print("OpenGL renderer: {}\n", glGetString(GL_RENDERER));
+    fmt::print("Trace..........: {}x{}, {} frames\n", header.width,
+               header.height, header.frames);
+
+    OffscreenTarget target;
+    target.create(header.width, header.height);
+
+    // Pixel data is recorded with tightly packed rows
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    // The setup section runs once and is not timed
+    glBindFramebuffer(GL_FRAMEBUFFER, target.getFramebuffer());
+    Replayer replayer{reader, target.getFramebuffer()};
+    replayer.replaySection();
+    glFinish();
+    const auto framesOffset{reader.tell()};
+
+    std::vector<double> frameTimes;
+    for (int pass{}; pass < repeat; ++pass) {
+      reader.seek(framesOffset);
+      abcg::ElapsedTimer timer;
+      while (!reader.atEnd()) {
+        timer.restart();
+        replayer.replaySection();
+        if (finish) glFinish();
+        frameTimes.push_back(timer.elapsed() * 1000.0);
+      }
+      glFinish();
+    }
+    printReport(frameTimes);
+
+    target.destroy();
+  } catch (abcg::Exception &exception) {
+    fmt::print(stderr, "{}\n", exception.what());
+    if (context != nullptr) SDL_GL_DeleteContext(context);
+    if (window != nullptr) SDL_DestroyWindow(window);
+    SDL_Quit();
+    return -1;
+  }
+
+  SDL_GL_DeleteContext(context);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  return 0;
+}